@@ -0,0 +1,224 @@
+//*****************************************************************************
+// ファイル名       HalHost.c
+// 対象             ホストPC (Linux)
+// ファイル内容     ハードウェア抽象化 (シミュレータ用の模擬ハードウェア)
+//*****************************************************************************
+// GPIOは配列、PWMはレベルを覚えるだけ。処理時間計測はCLOCK_MONOTONIC。LCDはバスに出たニブル列をHD44780として
+// 解釈し (8ビット/4ビットモード切替、DDRAMアドレス、表示クリア)、表示内容を再現する。
+// 送信は即時完了扱いで、待ち時間は全て0。
+// フラッシュはRAM上の配列で、消去で0xFF、書き込みはビットを落とすだけ (NORフラッシュと同じ)。
+//=============================================================================
+//include
+//=============================================================================
+#include <string.h>
+#include <time.h>
+#include "HalHost.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+bool     host_gpio[HAL_HOST_GPIO_NUM];
+uint16_t host_pwm[HAL_HOST_GPIO_NUM];
+uint8_t  host_flash[HAL_FLASH_DATA_SIZE];
+hal_flash_hook_t host_flash_pause;
+hal_flash_hook_t host_flash_resume;
+
+struct {
+    char     ddram[0x80];       // 表示データRAM
+    uint8_t  address;           // アドレスカウンタ
+    bool     mode8;             // 8ビットモード (電源投入直後)
+    bool     upper_done;        // 4ビットモードで上位ニブル受信済み
+    uint8_t  upper;
+    uint32_t nibbles;           // 受け取ったニブル数
+    char     line[HAL_HOST_LCD_ROWS][HAL_HOST_LCD_COLS + 1];
+} host_lcd;
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void host_lcd_byte(bool rs, uint8_t data);
+
+//*****************************************************************************
+// 模擬ハードウェア初期化 (入力は全てH = スイッチOFF)
+//*****************************************************************************
+void hal_host_init(void) {
+    int i;
+
+    for (i = 0; i < HAL_HOST_GPIO_NUM; i++) {
+        host_gpio[i] = true;
+        host_pwm[i] = 0;
+    }
+    memset(host_flash, 0xff, sizeof(host_flash));
+    memset(host_lcd.ddram, ' ', sizeof(host_lcd.ddram));
+    host_lcd.address = 0;
+    host_lcd.mode8 = true;
+    host_lcd.upper_done = false;
+    host_lcd.nibbles = 0;
+}
+
+void hal_host_gpio_set(unsigned int pin, bool value) {
+    if (pin < HAL_HOST_GPIO_NUM) host_gpio[pin] = value;
+}
+
+uint16_t hal_host_pwm_level(unsigned int pin) {
+    return pin < HAL_HOST_GPIO_NUM ? host_pwm[pin] : 0;
+}
+
+//*****************************************************************************
+// 模擬LCDの表示内容 (1行分)
+//*****************************************************************************
+const char *hal_host_lcd_line(int y) {
+    static const uint8_t row_address[4] = {0x00, 0x40, 0x14, 0x54};
+
+    memcpy(host_lcd.line[y], &host_lcd.ddram[row_address[y]], HAL_HOST_LCD_COLS);
+    host_lcd.line[y][HAL_HOST_LCD_COLS] = '\0';
+    return host_lcd.line[y];
+}
+
+uint32_t hal_host_lcd_nibbles(void) {
+    return host_lcd.nibbles;
+}
+
+//*****************************************************************************
+// HAL: GPIO・PWM・時間
+//*****************************************************************************
+bool hal_gpio_get(unsigned int pin) {
+    return pin < HAL_HOST_GPIO_NUM ? host_gpio[pin] : false;
+}
+
+void hal_gpio_put(unsigned int pin, bool value) {
+    hal_host_gpio_set(pin, value);
+}
+
+void hal_pwm_init(unsigned int pin, uint16_t wrap) {
+    (void)wrap;
+    if (pin < HAL_HOST_GPIO_NUM) host_pwm[pin] = 0;
+}
+
+void hal_pwm_set_level(unsigned int pin, uint16_t level) {
+    if (pin < HAL_HOST_GPIO_NUM) host_pwm[pin] = level;
+}
+
+void hal_sleep_ms(uint32_t ms) {
+    (void)ms;
+}
+
+//*****************************************************************************
+// HAL: 処理時間計測 (ナノ秒)
+//*****************************************************************************
+void hal_cycle_init(void) {
+}
+
+uint32_t hal_cycle_count(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+uint32_t hal_cycle_elapsed(uint32_t start) {
+    return hal_cycle_count() - start;
+}
+
+uint32_t hal_cycle_hz(void) {
+    return 1000000000u;
+}
+
+uint32_t hal_irq_save(void) {
+    return 0;
+}
+
+void hal_irq_restore(uint32_t status) {
+    (void)status;
+}
+
+//*****************************************************************************
+// HAL: フラッシュ データ領域 (範囲外・境界違反は無視)
+//*****************************************************************************
+const uint8_t *hal_flash_data(uint32_t offset) {
+    return &host_flash[offset];
+}
+
+void hal_flash_guard(hal_flash_hook_t pause, hal_flash_hook_t resume) {
+    host_flash_pause = pause;
+    host_flash_resume = resume;
+}
+
+void hal_flash_erase(uint32_t offset, uint32_t size) {
+    if (offset % HAL_FLASH_SECTOR_SIZE || size % HAL_FLASH_SECTOR_SIZE || offset + size > HAL_FLASH_DATA_SIZE) return;
+    if (host_flash_pause != NULL) host_flash_pause();
+    memset(&host_flash[offset], 0xff, size);
+    if (host_flash_resume != NULL) host_flash_resume();
+}
+
+void hal_flash_program(uint32_t offset, const uint8_t *data, uint32_t size) {
+    uint32_t i;
+
+    if (offset % HAL_FLASH_PAGE_SIZE || size % HAL_FLASH_PAGE_SIZE || offset + size > HAL_FLASH_DATA_SIZE) return;
+    if (host_flash_pause != NULL) host_flash_pause();
+    for (i = 0; i < size; i++) host_flash[offset + i] &= data[i];
+    if (host_flash_resume != NULL) host_flash_resume();
+}
+
+//*****************************************************************************
+// HAL: LCD 4ビットバス (ビット配置 bit0-3:D4-D7, bit5:RS)
+//*****************************************************************************
+void hal_lcd_bus_init(unsigned int pin_base, unsigned int pin_e) {
+    (void)pin_base;
+    (void)pin_e;
+}
+
+void hal_lcd_bus_put(uint8_t nibble) {
+    bool rs = (nibble & 0x20) != 0;
+    uint8_t data = nibble & 0x0f;
+
+    host_lcd.nibbles++;
+
+    // 8ビットモードではD4-D7が上位4ビット、下位は0として1回で受け取る
+    if (host_lcd.mode8) {
+        host_lcd_byte(rs, (uint8_t)(data << 4));
+        return;
+    }
+
+    if (!host_lcd.upper_done) {
+        host_lcd.upper = data;
+        host_lcd.upper_done = true;
+    } else {
+        host_lcd.upper_done = false;
+        host_lcd_byte(rs, (uint8_t)((host_lcd.upper << 4) | data));
+    }
+}
+
+void hal_lcd_bus_write(const uint8_t *stream, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) hal_lcd_bus_put(stream[i]);
+}
+
+bool hal_lcd_bus_busy(void) {
+    return false;
+}
+
+//*****************************************************************************
+// HD44780 命令・データ 1バイト
+//*****************************************************************************
+static void host_lcd_byte(bool rs, uint8_t data) {
+    if (rs) {
+        host_lcd.ddram[host_lcd.address & 0x7f] = (char)data;
+        host_lcd.address = (host_lcd.address + 1) & 0x7f;
+    } else if (data & 0x80) {       // DDRAMアドレス設定
+        host_lcd.address = data & 0x7f;
+    } else if (data & 0x20) {       // ファンクションセット (DL=bit4)
+        host_lcd.mode8 = (data & 0x10) != 0;
+        host_lcd.upper_done = false;
+    } else if (data == 0x01) {      // 表示クリア
+        memset(host_lcd.ddram, ' ', sizeof(host_lcd.ddram));
+        host_lcd.address = 0;
+    } else if ((data & 0xfe) == 0x02) { // カーソルホーム
+        host_lcd.address = 0;
+    }
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,32 @@
+//*****************************************************************************
+// ファイル名       HalHost.h
+// 対象             ホストPC (Linux)
+// ファイル内容     ハードウェア抽象化 (シミュレータ用の模擬ハードウェア)
+//*****************************************************************************
+#ifndef HALHOST_H_
+#define HALHOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Hal.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define HAL_HOST_GPIO_NUM       30      // GPIO本数
+#define HAL_HOST_LCD_COLS       16      // 模擬LCDの表示文字数
+#define HAL_HOST_LCD_ROWS       2
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void        hal_host_init(void);
+void        hal_host_gpio_set(unsigned int pin, bool value);   // 入力ピンの状態を与える
+uint16_t    hal_host_pwm_level(unsigned int pin);
+const char *hal_host_lcd_line(int y);                           // 模擬LCDの表示内容
+uint32_t    hal_host_lcd_nibbles(void);                         // バスに出たニブル数
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,119 @@
+//*****************************************************************************
+// ファイル名       TelemetryReader.c
+// 対象             ホストPC (Linux)
+// ファイル内容     USBテレメトリ フレーム切り出し
+//*****************************************************************************
+// 同期バイトを探してフレームを切り出し、CRC不一致なら1バイトずらして再同期する。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include "TelemetryReader.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+TelemetryReaderStats telemetry_reader_stats;
+
+uint8_t  rx_buff[TELEMETRY_MAX_FRAME * 4];
+size_t   rx_len;
+bool     seq_valid;
+uint16_t seq_next;
+bool     reader_stop;           // 受け取り関数から終了を要求された
+
+//*****************************************************************************
+// 入力を開く (NULLまたは"-"なら標準入力)
+//*****************************************************************************
+FILE *telemetry_reader_open(const char *path) {
+    FILE *fp;
+
+    if (path == NULL || strcmp(path, "-") == 0) return stdin;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) perror(path);
+    return fp;
+}
+
+//*****************************************************************************
+// 受信バッファからフレームを取り出す
+//*****************************************************************************
+static void parse_buffer(telemetry_frame_handler_t handler) {
+    TelemetryReaderStats *st = &telemetry_reader_stats;
+    size_t pos = 0;
+    size_t size;
+    uint16_t crc, seq;
+    const uint8_t *frame;
+
+    while (!reader_stop && rx_len - pos >= TELEMETRY_HEADER_SIZE) {
+        frame = &rx_buff[pos];
+        if (frame[0] != TELEMETRY_SYNC0 || frame[1] != TELEMETRY_SYNC1) {
+            pos++;
+            st->skipped_bytes++;
+            continue;
+        }
+
+        size = TELEMETRY_HEADER_SIZE + frame[3] + TELEMETRY_CRC_SIZE;
+        if (rx_len - pos < size) break; // 続きを待つ
+
+        crc = telemetry_crc16(&frame[2], size - 2 - TELEMETRY_CRC_SIZE, 0xFFFF);
+        if (crc != telemetry_get_u16(&frame[size - TELEMETRY_CRC_SIZE])) {
+            st->crc_errors++;
+            pos++;  // 偶然の同期バイトかもしれないので1バイトずつ探し直す
+            st->skipped_bytes++;
+            continue;
+        }
+
+        // シーケンス欠落 (送信側で捨てたフレームを含む)
+        seq = telemetry_get_u16(&frame[4]);
+        if (seq_valid && seq != seq_next) {
+            st->seq_lost += (uint16_t)(seq - seq_next);
+        }
+        seq_valid = true;
+        seq_next = seq + 1;
+        st->frames++;
+
+        handler(frame[2], seq, telemetry_get_u32(&frame[6]), &frame[TELEMETRY_HEADER_SIZE], frame[3]);
+        pos += size;
+    }
+
+    memmove(rx_buff, &rx_buff[pos], rx_len - pos);
+    rx_len -= pos;
+}
+
+//*****************************************************************************
+// 入力が終わるまで (または telemetry_reader_stop まで) フレームを読む
+//*****************************************************************************
+void telemetry_reader_run(FILE *fp, telemetry_frame_handler_t handler) {
+    ssize_t n;
+
+    // シリアルポートでも届いた分ずつ処理できるよう read() を使う
+    reader_stop = false;
+    while (!reader_stop && (n = read(fileno(fp), &rx_buff[rx_len], sizeof(rx_buff) - rx_len)) > 0) {
+        rx_len += (size_t)n;
+        parse_buffer(handler);
+        fflush(stdout);
+    }
+}
+
+//*****************************************************************************
+// 読み込み終了 (受け取り関数から呼ぶ, 今のバッファを処理し終えたら戻る)
+//*****************************************************************************
+void telemetry_reader_stop(void) {
+    reader_stop = true;
+}
+
+//*****************************************************************************
+// 受信統計を標準エラーへ出力
+//*****************************************************************************
+void telemetry_reader_print_stats(void) {
+    TelemetryReaderStats *st = &telemetry_reader_stats;
+
+    fprintf(stderr, "frames=%u crc_errors=%u seq_lost=%u skipped_bytes=%u\n",
+            st->frames, st->crc_errors, st->seq_lost, st->skipped_bytes);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,40 @@
+//*****************************************************************************
+// ファイル名       TelemetryReader.h
+// 対象             ホストPC (Linux)
+// ファイル内容     USBテレメトリ フレーム切り出し
+//*****************************************************************************
+#ifndef TELEMETRYREADER_H_
+#define TELEMETRYREADER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "TelemetryProtocol.h"
+
+//=============================================================================
+// 受信統計
+//=============================================================================
+typedef struct {
+    uint32_t frames;            // 正常に受け取ったフレーム数
+    uint32_t crc_errors;        // CRC不一致
+    uint32_t seq_lost;          // シーケンス番号の欠落数
+    uint32_t skipped_bytes;     // 同期を探して読み飛ばしたバイト数
+} TelemetryReaderStats;
+
+// フレーム受け取り関数
+typedef void (*telemetry_frame_handler_t)(uint8_t type, uint16_t seq, uint32_t timestamp,
+                                          const uint8_t *payload, uint8_t len);
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+FILE *telemetry_reader_open(const char *path);
+void  telemetry_reader_run(FILE *fp, telemetry_frame_handler_t handler);
+void  telemetry_reader_stop(void);
+void  telemetry_reader_print_stats(void);
+
+extern TelemetryReaderStats telemetry_reader_stats;
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,255 @@
+//*****************************************************************************
+// ファイル名       command_test.c
+// 対象             ホストPC (Linux)
+// ファイル内容     USBコマンド解釈 (CommandParser) の確認
+//*****************************************************************************
+// ファームウェアの CommandParser.c を試験用のコマンド表で動かし、次を確認する
+// (ctest から実行)。
+//   ・ヘッダーの短縮形・完全形 (MEAS:POT? と MEASure:POTential?) が同じコマンドになり、
+//     段数の違うヘッダー (TRIG:PEAK:RES) を短い方 (TRIG:PEAK) と取り違えないか
+//   ・';' で続けたコマンドを順に実行し、最初のエラーで残りを止めるか
+//   ・小数・整数の引数の範囲外と読めない値のエラー、-2147483648 を読めるか
+//   ・小数付きの値の応答の書式
+//   ・受信リングのあふれと長すぎる行がエラーになり、次の行から元に戻るか
+// 全て合格なら0、不合格があれば1で終了する。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "CommandParser.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define CHECK(cond)     check((cond), #cond, __LINE__)
+#define TEST_POTENTIAL  1234        // MEASure:POTential? の応答
+#define TEST_LEVEL_MAX  1000        // LEVel の上限 [0.1]
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+char     response[CMD_RESPONSE_SIZE + 1];   // 最後の応答
+uint32_t responses;                         // 応答の回数
+
+int32_t  level;                             // LEVel の設定値 [0.1]
+int32_t  count;                             // COUNt の設定値
+uint32_t peak_calls;                        // TRIGger:PEAK? の実行回数
+uint32_t peak_resets;                       // TRIGger:PEAK:RESet の実行回数
+bool     pass = true;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+static void cmd_potential(const char *args, bool query);
+static void cmd_level(const char *args, bool query);
+static void cmd_count(const char *args, bool query);
+static void cmd_format(const char *args, bool query);
+static void cmd_peak(const char *args, bool query);
+static void cmd_peak_reset(const char *args, bool query);
+
+//=============================================================================
+// 試験用のコマンド表 (ファームウェアの表と同じ書式)
+//=============================================================================
+static const CmdEntry test_commands[] = {
+    {"MEASure:POTential",           CMD_QUERY,           cmd_potential},
+    {"LEVel",                       CMD_SET | CMD_QUERY, cmd_level},
+    {"COUNt",                       CMD_SET | CMD_QUERY, cmd_count},
+    {"FORMat",                      CMD_QUERY,           cmd_format},
+    {"TRIGger:PEAK",                CMD_QUERY,           cmd_peak},
+    {"TRIGger:PEAK:RESet",          CMD_SET,             cmd_peak_reset},
+    {NULL, 0, NULL}
+};
+
+//*****************************************************************************
+// 判定 (不合格なら行番号と条件を出力)
+//*****************************************************************************
+static void check(bool ok, const char *text, int line) {
+    if (ok) return;
+    printf("line %d: %s (response \"%s\")\n", line, text, response);
+    pass = false;
+}
+
+//*****************************************************************************
+// 応答の受け取り (cmd_init で渡す)
+//*****************************************************************************
+static void respond(const char *text, uint32_t len) {
+    memcpy(response, text, len);
+    response[len] = '\0';
+    responses++;
+}
+
+//*****************************************************************************
+// 1行送って実行し、応答を返す
+//*****************************************************************************
+static const char *run(const char *line) {
+    response[0] = '\0';
+    while (*line != '\0') cmd_receive(*line++);
+    cmd_receive('\r');
+    cmd_receive('\n');
+    while (cmd_process()) {
+    }
+    return response;
+}
+
+//*****************************************************************************
+// 応答が指定のエラーか
+//*****************************************************************************
+static bool is_error(const char *text, int code) {
+    char head[16];
+
+    snprintf(head, sizeof(head), "ERR %d,\"", code);
+    return strncmp(text, head, strlen(head)) == 0;
+}
+
+//=============================================================================
+// 試験用のコマンド
+//=============================================================================
+static void cmd_potential(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_int(TEST_POTENTIAL);
+}
+
+static void cmd_level(const char *args, bool query) {
+    int32_t value;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_fixed(level, 1);
+        return;
+    }
+    if (!cmd_arg_fixed(&args, 1, &value) || !cmd_arg_end(args)) return;
+    if (value < 0 || value > TEST_LEVEL_MAX) {
+        cmd_error(CMD_ERR_RANGE);
+        return;
+    }
+    level = value;
+}
+
+static void cmd_count(const char *args, bool query) {
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_int(count);
+        return;
+    }
+    if (!cmd_arg_int(&args, &count) || !cmd_arg_end(args)) return;
+}
+
+static void cmd_format(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_fixed(5, 2);
+    cmd_reply_fixed(-5, 2);
+    cmd_reply_fixed(12345, 3);
+    cmd_reply_fixed(0, 1);
+    cmd_reply_fixed(-10, 1);
+    cmd_reply_fixed(INT32_MIN, 0);
+    cmd_reply_fixed(INT32_MAX, 3);
+}
+
+static void cmd_peak(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    peak_calls++;
+    cmd_reply_int(-5);
+    cmd_reply_int(7);
+}
+
+static void cmd_peak_reset(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    peak_resets++;
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(void) {
+    uint32_t i, n;
+
+    cmd_init(test_commands, respond);
+
+    // ヘッダーの短縮形・完全形 (大文字小文字, 先頭の ':' は問わない)
+    CHECK(strcmp(run("MEAS:POT?"), "1234") == 0);
+    CHECK(strcmp(run("MEASure:POTential?"), "1234") == 0);
+    CHECK(strcmp(run(":measure:pot?"), "1234") == 0);
+    CHECK(is_error(run("MEASU:POT?"), CMD_ERR_UNDEFINED));
+    CHECK(is_error(run("MEAS?"), CMD_ERR_UNDEFINED));
+    CHECK(is_error(run("MEAS:POT"), CMD_ERR_UNDEFINED));    // 問い合わせ専用
+    CHECK(is_error(run("MEAS:POT? 1"), CMD_ERR_PARAM_NOT_ALLOWED));
+
+    // 段数の違うヘッダーを取り違えない
+    CHECK(strcmp(run("TRIG:PEAK?"), "-5,7") == 0 && peak_calls == 1);
+    CHECK(strcmp(run("TRIG:PEAK:RES"), "OK") == 0 && peak_resets == 1 && peak_calls == 1);
+    CHECK(strcmp(run("TRIGger:PEAK:RESet"), "OK") == 0 && peak_resets == 2);
+    CHECK(is_error(run("TRIG:PEAK:RES?"), CMD_ERR_UNDEFINED) && peak_calls == 1);
+    CHECK(is_error(run("TRIG:PEAK"), CMD_ERR_UNDEFINED) && peak_resets == 2);
+    CHECK(is_error(run("TRIG:PEAK:RES:X"), CMD_ERR_UNDEFINED) && peak_resets == 2);
+
+    // ';' で続けたコマンド (応答は ';' 区切り, 問い合わせが無ければ "OK")
+    CHECK(strcmp(run("LEV 12.5;LEV?;MEAS:POT?;TRIG:PEAK?"), "12.5;1234;-5,7") == 0);
+    CHECK(strcmp(run("LEV 1;COUN 3;"), "OK") == 0 && level == 10 && count == 3);
+    CHECK(is_error(run("LEV 2;BOGUS;LEV 3"), CMD_ERR_UNDEFINED) && level == 20);
+    CHECK(is_error(run("LEV?;LEV 200;LEV 4"), CMD_ERR_RANGE) && level == 20);
+    CHECK(is_error(run("LEV 5;:"), CMD_ERR_SYNTAX) && level == 50);
+
+    // 小数の引数 (範囲外・読めない値, 下の桁は切り捨て)
+    CHECK(strcmp(run("LEV 100.0"), "OK") == 0 && level == TEST_LEVEL_MAX);
+    CHECK(is_error(run("LEV 100.1"), CMD_ERR_RANGE) && level == TEST_LEVEL_MAX);
+    CHECK(is_error(run("LEV -0.1"), CMD_ERR_RANGE) && level == TEST_LEVEL_MAX);
+    CHECK(strcmp(run("LEV 12.34"), "OK") == 0 && level == 123);
+    CHECK(strcmp(run("LEV +.5"), "OK") == 0 && level == 5);
+    CHECK(is_error(run("LEV 99999999999"), CMD_ERR_RANGE));
+    CHECK(is_error(run("LEV 214748364.8"), CMD_ERR_RANGE));
+    CHECK(is_error(run("LEV abc"), CMD_ERR_DATA_TYPE));
+    CHECK(is_error(run("LEV 1.2.3"), CMD_ERR_DATA_TYPE));
+    CHECK(is_error(run("LEV -"), CMD_ERR_DATA_TYPE));
+    CHECK(is_error(run("LEV 1e3"), CMD_ERR_DATA_TYPE));
+    CHECK(is_error(run("LEV"), CMD_ERR_MISSING_PARAM));
+    CHECK(is_error(run("LEV 1,2"), CMD_ERR_PARAM_NOT_ALLOWED));
+    CHECK(level == 5);
+
+    // 整数の引数の端 (-2147483648 は読め、それを超えると範囲外)
+    CHECK(strcmp(run("COUN -2147483648;COUN?"), "-2147483648") == 0 && count == INT32_MIN);
+    CHECK(strcmp(run("COUN 2147483647;COUN?"), "2147483647") == 0 && count == INT32_MAX);
+    CHECK(is_error(run("COUN 2147483648"), CMD_ERR_RANGE) && count == INT32_MAX);
+    CHECK(is_error(run("COUN -2147483649"), CMD_ERR_RANGE) && count == INT32_MAX);
+    CHECK(strcmp(run("COUN 1.5"), "OK") == 0 && count == 1);     // 小数点以下は切り捨て
+
+    // 小数付きの値の応答の書式
+    CHECK(strcmp(run("FORM?"), "0.05,-0.05,12.345,0.0,-1.0,-2147483648,2147483.647") == 0);
+
+    // 長すぎる行はエラーにして捨て、次の行は普通に実行する
+    for (i = 0; i < CMD_LINE_SIZE + 10; i++) {
+        cmd_receive('A');
+        cmd_process();
+    }
+    CHECK(is_error(run(""), CMD_ERR_TOO_LONG));
+    CHECK(strcmp(run("MEAS:POT?"), "1234") == 0);
+
+    // ちょうど CMD_LINE_SIZE 文字の行は受け付ける
+    n = (uint32_t)strlen("COUN 1");
+    for (i = 0; i < CMD_LINE_SIZE - n; i++) cmd_receive(' ');
+    CHECK(strcmp(run("COUN 1"), "OK") == 0 && count == 1);
+
+    // 受信リングのあふれ (cmd_process を呼ばずに受信し続ける) は次の行でエラー
+    n = 0;
+    for (i = 0; i < CMD_RX_SIZE + 10; i++) {
+        if (cmd_receive(i % 8 == 7 ? '\n' : 'X')) n++;
+    }
+    CHECK(n == CMD_RX_SIZE && cmd_rx_free() == 0);
+    CHECK(cmd_process() && is_error(response, CMD_ERR_OVERRUN));
+    responses = 0;
+    while (cmd_process()) {
+    }
+    CHECK(responses == CMD_RX_SIZE / 8 - 1 && is_error(response, CMD_ERR_UNDEFINED));
+    CHECK(strcmp(run("MEAS:POT?"), "1234") == 0);
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
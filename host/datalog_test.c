@@ -0,0 +1,234 @@
+//*****************************************************************************
+// ファイル名       datalog_test.c
+// 対象             ホストPC (Linux)
+// ファイル内容     フラッシュログ (DataLog) の確認
+//*****************************************************************************
+// 模擬フラッシュ (HalHost) の上でファームウェアの DataLog.c をそのまま動かし、
+// 次を確認する (ctest から実行)。
+//   ・一周して古いセクタを消しながら書き続け、読み出しが古い順 (ページ番号順) か
+//   ・再起動しても続きのページ番号・次の起動回数で書くか
+//   ・書きかけで壊れたページは飛ばし、セクタに空きが無ければ次のセクタの先頭から書くか
+//   ・読み出し中はフラッシュを書き換えず、終わってから埋まったページを書くか
+// 全て合格なら0、不合格があれば1で終了する。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "HalHost.h"
+#include "Telemetry.h"
+#include "DataLog.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define CHECK(cond)     check((cond), #cond, __LINE__)
+#define PAGE_OFFSET(n)  (LOG_FIRST_SECTOR * HAL_FLASH_SECTOR_SIZE + (n) * HAL_FLASH_PAGE_SIZE)
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+// 読み出しで受け取ったページ (フレーム2個で1ページ)
+uint8_t  dump_pages[LOG_PAGES + 1][TELEMETRY_LOG_PAGE_SIZE];
+uint32_t dump_frames;
+uint32_t dump_total;
+bool     dump_order_ok;
+bool     send_enabled = true;   // falseならテレメトリの送信リングが満杯
+
+uint32_t flash_writes;          // 消去・書き込みの回数 (hal_flash_guard の再開処理で数える)
+uint32_t now_ms;
+bool     pass = true;
+
+//*****************************************************************************
+// 判定 (不合格なら行番号と条件を出力)
+//*****************************************************************************
+static void check(bool ok, const char *text, int line) {
+    if (ok) return;
+    printf("line %d: %s\n", line, text);
+    pass = false;
+}
+
+//*****************************************************************************
+// テレメトリ送信 (DataLog.c から呼ばれる, 読み出しのフレームを受け取る)
+//*****************************************************************************
+bool telemetry_send(uint8_t type, const uint8_t *payload, uint8_t len) {
+    uint16_t index = telemetry_get_u16(&payload[0]);
+    uint16_t total = telemetry_get_u16(&payload[2]);
+
+    if (type != TELEMETRY_TYPE_LOG) return false;
+    if (index != dump_frames || (dump_frames > 0 && total != dump_total)) dump_order_ok = false;
+    dump_total = total;
+    if (len == TELEMETRY_LOG_SIZE && index / 2 < LOG_PAGES + 1) {
+        memcpy(&dump_pages[index / 2][(index % 2) * TELEMETRY_LOG_CHUNK_SIZE], &payload[4],
+               TELEMETRY_LOG_CHUNK_SIZE);
+    }
+    dump_frames++;
+    return true;
+}
+
+uint32_t telemetry_free(void) {
+    return send_enabled ? TELEMETRY_BUFF_SIZE : 0;
+}
+
+//*****************************************************************************
+// フラッシュ書き換えの前後 (ADCの一時停止の代わりに回数を数える)
+//*****************************************************************************
+static void flash_pause(void) {
+}
+
+static void flash_resume(void) {
+    flash_writes++;
+}
+
+//*****************************************************************************
+// 1ページ分記録する (時刻は記録間隔ずつ進める)
+//*****************************************************************************
+static void write_page(void) {
+    int i;
+
+    for (i = 0; i < TELEMETRY_LOG_RECORDS; i++) {
+        now_ms += LOG_INTERVAL_MS;
+        log_result((int32_t)now_ms, 1);
+        if (log_due(now_ms)) log_record(now_ms, 250, 500, 0);
+        log_process();
+    }
+}
+
+//*****************************************************************************
+// 全部読み出して、古い順に並んでいるか確かめる (戻り値はページ数)
+//*****************************************************************************
+static uint32_t dump_all(uint16_t boot_last, uint32_t seq_last) {
+    TelemetryLogPage h, prev_h;
+    TelemetryLogRecord r, prev;
+    uint32_t n, k;
+    int count;
+
+    dump_frames = 0;
+    dump_total = 0;
+    dump_order_ok = true;
+    log_dump_start();
+    while (log_dumping()) log_process();
+
+    CHECK(dump_order_ok);
+    CHECK(dump_frames == dump_total && dump_total % 2 == 0);
+    memset(&prev, 0, sizeof(prev));
+    memset(&prev_h, 0, sizeof(prev_h));
+    for (n = 0; n < dump_total / 2; n++) {
+        count = telemetry_check_log_page(dump_pages[n], &h);
+        CHECK(count > 0);
+        if (count <= 0) return 0;
+        if (n == dump_total / 2 - 1) {
+            CHECK(h.page_seq == seq_last);
+            CHECK(h.boot == boot_last);
+        }
+        for (k = 0; k < (uint32_t)count; k++) {
+            telemetry_unpack_log_record(&dump_pages[n][TELEMETRY_LOG_HEADER_SIZE + k * TELEMETRY_LOG_RECORD_SIZE], &r);
+            // 時刻は起動毎に0から。同じ起動の中では増え続け、電位は記録間隔の平均
+            if (k > 0 || (n > 0 && h.boot == prev_h.boot)) CHECK(r.time_ms > prev.time_ms);
+            CHECK(r.potential_mv == (int32_t)r.time_ms);
+            prev = r;
+        }
+        if (n > 0) CHECK(h.page_seq == prev_h.page_seq + 1);
+        prev_h = h;
+    }
+    return dump_total / 2;
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(void) {
+    uint8_t torn[HAL_FLASH_PAGE_SIZE];
+    TelemetryLogPage h;
+    uint32_t i, pages, writes;
+
+    hal_host_init();
+    hal_flash_guard(flash_pause, flash_resume);
+
+    // 空のログ: フレーム数0を1つだけ送る
+    log_init();
+    CHECK(log_pages() == 0);
+    dump_frames = 0;
+    dump_total = 1;
+    log_dump_start();
+    CHECK(dump_frames == 1 && dump_total == 0);
+    CHECK(!log_dumping());
+
+    // 一周して4ページ余分に書く (最初のセクタは消して書き直し中)
+    now_ms = 0;
+    for (i = 0; i < LOG_PAGES + 4; i++) write_page();
+    CHECK(log_pages() == LOG_PAGES - LOG_PAGES_PER_SECTOR + 4);
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(3)), &h) > 0 && h.page_seq == LOG_PAGES + 3);
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(4)), &h) == 0);
+
+    // 1件だけRAMに残して読み出す: 一番古いのは2番目のセクタの先頭, 最後は書きかけ
+    now_ms += LOG_INTERVAL_MS;
+    log_result((int32_t)now_ms, 1);
+    log_record(now_ms, 250, 500, 0);
+    pages = dump_all(0, LOG_PAGES + 4);
+    CHECK(pages == LOG_PAGES - LOG_PAGES_PER_SECTOR + 4 + 1);
+    CHECK(telemetry_check_log_page(dump_pages[0], &h) > 0 && h.page_seq == LOG_PAGES_PER_SECTOR);
+
+    // 再起動: 続きのページ番号・次の起動回数で書く (RAMの1件は失われる)
+    log_init();
+    now_ms = 0;
+    write_page();
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(4)), &h) > 0);
+    CHECK(h.page_seq == LOG_PAGES + 4 && h.boot == 1);
+
+    // 書きかけで壊れたページ (ヘッダーだけ書けてCRCが合わない) の後で再起動: 次の空きへ
+    memset(torn, 0xff, sizeof(torn));
+    telemetry_put_u32(&torn[0], TELEMETRY_LOG_MAGIC);
+    telemetry_put_u32(&torn[4], LOG_PAGES + 5);
+    torn[10] = 1;
+    torn[11] = TELEMETRY_LOG_VERSION;
+    hal_flash_program(PAGE_OFFSET(5), torn, sizeof(torn));
+    log_init();
+    now_ms = 0;
+    write_page();
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(5)), &h) < 0);
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(6)), &h) > 0);
+    CHECK(h.page_seq == LOG_PAGES + 5 && h.boot == 2);
+
+    // セクタの残りが全部書きかけ: 次のセクタの先頭 (消してから) へ飛ばす
+    for (i = 7; i < LOG_PAGES_PER_SECTOR; i++) hal_flash_program(PAGE_OFFSET(i), torn, sizeof(torn));
+    log_init();
+    now_ms = 0;
+    write_page();
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(LOG_PAGES_PER_SECTOR)), &h) > 0);
+    CHECK(h.page_seq == LOG_PAGES + 6 && h.boot == 3);
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(LOG_PAGES_PER_SECTOR + 1)), &h) == 0);
+
+    // 読み出しは2番目のセクタの残り (消した) を飛ばして3番目のセクタから、ページ番号順
+    pages = dump_all(3, LOG_PAGES + 6);
+    CHECK(pages == (LOG_PAGES - 2 * LOG_PAGES_PER_SECTOR) + 6 + 1);
+    CHECK(telemetry_check_log_page(dump_pages[0], &h) > 0 && h.page_seq == 2 * LOG_PAGES_PER_SECTOR);
+
+    // 読み出し中 (送信リング満杯で止まっている間) はページが埋まっても書かない
+    send_enabled = false;
+    dump_frames = 0;
+    dump_total = 0;
+    dump_order_ok = true;
+    log_dump_start();
+    writes = flash_writes;
+    write_page();
+    write_page();
+    CHECK(flash_writes == writes);
+    CHECK(!log_due(now_ms + LOG_INTERVAL_MS));
+    send_enabled = true;
+    while (log_dumping()) log_process();
+    CHECK(dump_order_ok && dump_frames == dump_total);
+    log_process();
+    CHECK(flash_writes == writes + 1);
+    CHECK(telemetry_check_log_page(hal_flash_data(PAGE_OFFSET(LOG_PAGES_PER_SECTOR + 1)), &h) > 0);
+    CHECK(h.page_seq == LOG_PAGES + 7 && h.count == TELEMETRY_LOG_RECORDS);
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
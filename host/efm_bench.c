@@ -0,0 +1,56 @@
+//*****************************************************************************
+// ファイル名       efm_bench.c
+// 対象             ホストPC (Linux)
+// ファイル内容     処理時間ベンチマーク (ホストPC用)
+//*****************************************************************************
+// 使い方: efm_bench [-n 計測回数] [-o 出力ファイル]
+// 実機用 (ElectrostaticFieldMillBench) と同じ項目・同じJSON形式で出力する。
+// 時間の単位はナノ秒 (tick_hz = 1000000000)。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "HalHost.h"
+#include "LcdControl.h"
+#include "SwitchControl.h"
+#include "BuzzerControl.h"
+#include "Bench.h"
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    uint32_t iterations = BENCH_ITERATIONS * 100;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:o:")) != -1) {
+        switch (c) {
+            case 'n':
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                if (freopen(optarg, "w", stdout) == NULL) {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-o output.json]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    hal_host_init();
+    lcd_init();
+    switch_init();
+    init_beep();
+
+    bench_run("host", iterations);
+    return 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
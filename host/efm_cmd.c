@@ -0,0 +1,87 @@
+//*****************************************************************************
+// ファイル名       efm_cmd.c
+// 対象             ホストPC (Linux)
+// ファイル内容     USBコマンドの送信 (応答を標準出力へ)
+//*****************************************************************************
+// 使い方: efm_cmd <シリアルポート> <コマンド> [<コマンド> ...]
+//   例) stty -F /dev/ttyACM0 raw && efm_cmd /dev/ttyACM0 "*IDN?" "MOT:DUTY 20" "MEAS:ALL?"
+// コマンド1個を1行として送り、応答フレームが届くまで待ってから次を送る。
+// 応答が "ERR" で始まったら終了コード 3 を返す (残りのコマンドも送る)。
+// コマンドの一覧は CommandHandlers.c の usb_commands を参照。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TelemetryProtocol.h"
+#include "TelemetryReader.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+bool     response_error;        // 応答にエラーがあった
+bool     response_seen;         // 今のコマンドの応答を受け取った
+
+//*****************************************************************************
+// 応答フレームを受け取る (他の種類は読み捨てる)
+//*****************************************************************************
+static void receive_frame(uint8_t type, uint16_t seq, uint32_t timestamp,
+                          const uint8_t *payload, uint8_t len) {
+    (void)seq;
+    (void)timestamp;
+    if (type != TELEMETRY_TYPE_RESPONSE) return;
+
+    printf("%.*s\n", len, (const char *)payload);
+    fflush(stdout);
+    if (len >= 3 && memcmp(payload, "ERR", 3) == 0) response_error = true;
+    response_seen = true;
+    telemetry_reader_stop();
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    FILE *fp;
+    int fd, i;
+    size_t len;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <port> <command> [<command> ...]\n", argv[0]);
+        return 2;
+    }
+
+    fp = telemetry_reader_open(argv[1]);
+    if (fp == NULL) return 1;
+    fd = open(argv[1], O_WRONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    for (i = 2; i < argc; i++) {
+        len = strlen(argv[i]);
+        if (write(fd, argv[i], len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+            perror(argv[1]);
+            return 1;
+        }
+        response_seen = false;
+        telemetry_reader_run(fp, receive_frame);
+        if (!response_seen) {
+            fprintf(stderr, "no response to \"%s\"\n", argv[i]);
+            return 3;
+        }
+    }
+    close(fd);
+    fclose(fp);
+
+    return response_error ? 3 : 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
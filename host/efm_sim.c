@@ -0,0 +1,411 @@
+//*****************************************************************************
+// ファイル名       efm_sim.c
+// 対象             ホストPC (Linux)
+// ファイル内容     計測パイプラインのシミュレータ
+//*****************************************************************************
+// 模擬ADC・シャッターのサンプル列を生成して同期検波に通し、1ms毎にスイッチ・
+// ブザー・LCD処理を回す。終了時に次を確認して結果を出力する。
+//   ・検波出力の平均・直流オフセットが理論値 (サンプル点での信号と矩形参照の相関) と一致するか
+//   ・基準シャッター周波数への換算値が 理論値 × 基準周波数 / シャッター周波数 になるか
+//   ・直流オフセット (-d) を追従し、検波出力に影響しないか (許容誤差はQ8の丸め+ノイズ分)
+//   ・模擬LCD (HD44780) の表示がlcd_printfで書いた内容と一致するか
+//   ・スイッチの短押し/長押しでフラグとブザーが期待通り動くか
+//   ・(-m) 模擬モーターが目標回転数に落ち着くか (途中で電源電圧を20%下げる)
+// 全て合格なら0、不合格があれば1で終了する。
+//
+// 使い方: efm_sim [-t 秒] [-a 振幅] [-p 位相遅れ[deg]] [-f シャッター周波数[Hz]]
+//                 [-r サンプリング周波数[Hz]] [-n ノイズ[ADC値rms]] [-j 周期ゆらぎ[%]]
+//                 [-d 直流オフセット[ADC値]] [-w square|sine] [-A] [-m] [-q]
+//   -A: 適応窓 (窓の長さの平均・範囲も出力する)
+//   -m: シャッター周波数を固定せず、速度制御した模擬モーターで回す (-t 5 程度で)
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "HalHost.h"
+#include "AdcControl.h"
+#include "SyncDemod.h"
+#include "LcdControl.h"
+#include "SwitchControl.h"
+#include "BuzzerControl.h"
+#include "MotorControl.h"
+#include "Calibration.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define SIM_BUZZER_PIN      21      // BuzzerControl.c と同じ
+#define SIM_SW1_PIN         13      // SW_1
+#define SIM_SW2_PIN         12      // SW_2
+#define SIM_MOTOR_PIN       22      // モーターPWM (本体と同じ)
+#define SIM_MOTOR_WRAP      6249    // モーターPWMラップ値 (20kHz)
+#define SIM_MOTOR_GAIN      5.0     // 模擬モーターの定常回転数 [rpm/PWMレベル]
+#define SIM_MOTOR_TAU       0.2     // 模擬モーターの時定数 [s]
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+struct {
+    double   seconds;           // シミュレーション時間 [s]
+    double   amplitude;         // 信号振幅 [ADC値] (負なら逆極性)
+    double   phase_deg;         // シャッターに対する信号の遅れ [deg]
+    double   shutter_hz;        // シャッター周波数 [Hz]
+    double   sample_hz;         // サンプリング周波数 [Hz]
+    double   noise;             // ガウスノイズ [ADC値rms]
+    double   jitter;            // 1周期毎の周期ゆらぎ [%]
+    double   offset;            // 直流オフセット [ADC値]
+    bool     sine;              // 正弦波信号 (falseなら矩形波)
+    bool     adaptive;          // 適応窓
+    bool     motor;             // 模擬モーターで回す
+    bool     quiet;             // 結果のみ出力
+} opt = {2.0, 100.0, 0.0, 200.0, ADC_SAMPLE_FREQ_HZ, 0.0, 0.0, 0.0, false, false, false, false};
+
+// 模擬シャッター・信号の状態
+struct {
+    double   period;            // 現在の周期 [サンプル]
+    double   rise;              // 現在の周期の立ち上がり時刻 [サンプル]
+    bool     level;             // 直前のサンプルでのシャッター状態
+    uint64_t index;             // 次のサンプル番号
+    uint64_t rng;               // 乱数状態
+    uint32_t rises;             // 立ち上がりの累計
+    uint32_t rise_period_us;    // 直近の周期 [us]
+    double   rpm;               // 模擬モーターの回転数 [rpm]
+} sim;
+
+//*****************************************************************************
+// 乱数 (再現性のため固定シードの64ビットLCG)
+//*****************************************************************************
+static double sim_uniform(void) {
+    sim.rng = sim.rng * 6364136223846793005ull + 1442695040888963407ull;
+    return ((sim.rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double sim_gauss(void) {
+    return sqrt(-2.0 * log(sim_uniform())) * cos(2.0 * M_PI * sim_uniform());
+}
+
+//*****************************************************************************
+// 信号波形 (x: シャッター立ち上がりからの位相 [周期], 遅れ込み)
+//*****************************************************************************
+static double sim_wave(double x) {
+    x -= floor(x);
+    if (opt.sine) return sin(2.0 * M_PI * x);
+    return x < 0.5 ? 1.0 : -1.0;
+}
+
+//*****************************************************************************
+// 理論値: サンプル点での信号と矩形参照 (同相・直交) の相関
+// sim_block と同じサンプル時刻・ADC値の丸めで周期ゆらぎ・ノイズなしの列を作り、
+// 参照の +1/-1 の数の差で残る直流分を自動ゼロと同じく差し引く。同相参照はシャッター
+// 状態そのものだが、直交参照は位相増分 (切り捨て) の積算なので、切り替わりがサンプル
+// 時刻と重なる時は手前側になる (xr)。周期のサンプル数が整数でなくても平均が揃うよう、
+// 十分な周期数で平均する。dc_expは直流オフセット
+// (信号自体の直流分を含む) の理論値
+//*****************************************************************************
+static void sim_expected(double *i_exp, double *q_exp, double *dc_exp) {
+    const int periods = 1000;
+    double period = opt.sample_hz / opt.shutter_hz;
+    double delay = opt.phase_deg / 360.0;
+    double x, xr, v, ri, rq, si = 0, sq = 0, sv = 0, bi = 0, bq = 0;
+    long t, count;
+
+    if (opt.motor) period = 10000.0;    // 周期が一定でないので連続に近い細かい格子で
+    count = (long)(periods * period);
+    for (t = 1; t <= count; t++) {
+        x = (t - 0.25) / period;
+        x -= floor(x);
+        v = lround(ADC_MID_VALUE + opt.offset + opt.amplitude * sim_wave(x - delay)) - ADC_MID_VALUE;
+        xr = x - 1e-9;
+        ri = x < 0.5 ? 1.0 : -1.0;
+        rq = (xr >= 0.25 && xr < 0.75) ? 1.0 : -1.0;
+        si += v * ri;
+        sq += v * rq;
+        sv += v;
+        bi += ri;
+        bq += rq;
+    }
+    *dc_exp = sv / count;
+    *i_exp = (si - *dc_exp * bi) / count;
+    *q_exp = (sq - *dc_exp * bq) / count;
+}
+
+//*****************************************************************************
+// 模擬ADCブロック生成 (AdcControl.c と同じサンプルデータ形式)
+//*****************************************************************************
+static void sim_block(uint32_t *samples, uint32_t count) {
+    double delay = opt.phase_deg / 360.0;
+    double t, x, edge, lag, v;
+    uint32_t k, word;
+    bool level;
+
+    for (k = 0; k < count; k++) {
+        t = (double)sim.index++;
+
+        // 周期の終わりを越えたら次の周期へ (周期ゆらぎを付ける)
+        while (t >= sim.rise + sim.period) {
+            sim.rise += sim.period;
+            sim.rise_period_us = (uint32_t)lround(sim.period * 1e6 / opt.sample_hz);
+            sim.rises++;
+            if (opt.motor) continue;    // 周期は模擬モーターが決める
+            sim.period = opt.sample_hz / opt.shutter_hz
+                       * (1.0 + opt.jitter / 100.0 * (2.0 * sim_uniform() - 1.0));
+        }
+        x = (t - sim.rise) / sim.period;
+        level = x < 0.5;
+
+        // 前のサンプルとの間のエッジ時刻からの遅れ (Q16サンプル)
+        word = 0;
+        if (level != sim.level) {
+            edge = level ? sim.rise : sim.rise + sim.period * 0.5;
+            lag = t - edge;
+            if (lag >= 0.0 && lag < 1.0) {
+                word |= ADC_SAMPLE_EDGE_BIT | ((uint32_t)(lag * 65536.0) << ADC_SAMPLE_LAG_SHIFT);
+            }
+            sim.level = level;
+        }
+
+        v = ADC_MID_VALUE + opt.offset + opt.amplitude * sim_wave(x - delay) + opt.noise * sim_gauss();
+        if (v < 0) v = 0;
+        if (v > ADC_SAMPLE_VALUE_MASK) v = ADC_SAMPLE_VALUE_MASK;
+        word |= (uint32_t)lround(v);
+        if (level) word |= ADC_SAMPLE_SHUTTER_BIT;
+        samples[k] = word;
+    }
+}
+
+//*****************************************************************************
+// 模擬モーター (1ms毎, 一次遅れ。電源電圧の変化はゲインで表す)
+//*****************************************************************************
+static void sim_motor(double gain) {
+    sim.rpm += (gain * hal_host_pwm_level(SIM_MOTOR_PIN) - sim.rpm) * 0.001 / SIM_MOTOR_TAU;
+    opt.shutter_hz = sim.rpm * MOTOR_CYCLES_PER_REV / 60.0;
+
+    // 回転中の周期も回転数に合わせて伸び縮みさせる (止まっている間は十分長く)
+    sim.period = (opt.shutter_hz > 0.1) ? opt.sample_hz / opt.shutter_hz : 1e12;
+}
+
+//*****************************************************************************
+// 経過時間 [s]
+//*****************************************************************************
+static double sim_clock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//*****************************************************************************
+// オプション解析
+//*****************************************************************************
+static int sim_options(int argc, char *argv[]) {
+    int c;
+
+    while ((c = getopt(argc, argv, "t:a:p:f:r:n:j:d:w:Amq")) != -1) {
+        switch (c) {
+            case 't': opt.seconds = atof(optarg); break;
+            case 'a': opt.amplitude = atof(optarg); break;
+            case 'p': opt.phase_deg = atof(optarg); break;
+            case 'f': opt.shutter_hz = atof(optarg); break;
+            case 'r': opt.sample_hz = atof(optarg); break;
+            case 'n': opt.noise = atof(optarg); break;
+            case 'j': opt.jitter = atof(optarg); break;
+            case 'd': opt.offset = atof(optarg); break;
+            case 'w': opt.sine = strcmp(optarg, "sine") == 0; break;
+            case 'A': opt.adaptive = true; break;
+            case 'm': opt.motor = true; break;
+            case 'q': opt.quiet = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-t sec] [-a amp] [-p deg] [-f shutter_hz] "
+                                "[-r sample_hz] [-n noise] [-j jitter%%] [-d offset] [-w square|sine] [-A] [-m] [-q]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (opt.seconds <= 0 || opt.shutter_hz <= 0 || opt.sample_hz < 4 * opt.shutter_hz) {
+        fprintf(stderr, "invalid parameters\n");
+        return -1;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    static uint32_t samples[ADC_BLOCK_SAMPLES];
+    SyncDemodState demod;
+    DemodResult result;
+    uint32_t pos, used, tick_samples, tick_next;
+    uint64_t total, n;
+    double i_exp, q_exp, dc_exp, t0, demod_time = 0, wall;
+    double i_sum = 0, q_sum = 0, i_sq = 0, n_sum = 0, n_exp, tol, dc_tol, period;
+    uint32_t results = 0, ms = 0, sw1 = 0, sw2 = 0, beep_ms = 0;
+    uint32_t win_min = UINT32_MAX, win_max = 0;
+    uint64_t win_sum = 0;
+    char expect[HAL_HOST_LCD_ROWS][32];     // 桁あふれも書ける大きさ (比較はLCDの幅で切る)
+    bool pass = true, lcd_ok, motor_ok = true;
+    int32_t mv, shown = 0, shown_norm = 0;
+
+    if (sim_options(argc, argv) < 0) return 2;
+
+    hal_host_init();
+    cal_init();     // フラッシュは消去状態なので既定の校正になる
+    lcd_init();
+    switch_init();
+    init_beep();
+    sync_demod_init(&demod);
+    sync_demod_set_adaptive(&demod, opt.adaptive);
+    demod.sample_hz = (uint32_t)opt.sample_hz;
+    motor_init(SIM_MOTOR_PIN, SIM_MOTOR_WRAP);
+    if (opt.motor) {
+        motor_start();
+        opt.shutter_hz = 0;
+    }
+    memset(&result, 0, sizeof(result));
+
+    sim.period = opt.motor ? 1e12 : opt.sample_hz / opt.shutter_hz;
+    sim.rise = 0.25;            // 最初の立ち上がりはサンプルの間
+    sim.level = false;
+    sim.index = 1;
+    sim.rng = 12345;
+
+    total = (uint64_t)(opt.seconds * opt.sample_hz);
+    tick_samples = (uint32_t)(opt.sample_hz / 1000.0);
+    tick_next = tick_samples;
+    if (tick_samples == 0) tick_samples = 1;
+
+    wall = sim_clock();
+    for (n = 0; n < total; n += ADC_BLOCK_SAMPLES) {
+        sim_block(samples, ADC_BLOCK_SAMPLES);
+
+        // 同期検波 (コア1相当)
+        t0 = sim_clock();
+        for (pos = 0; pos < ADC_BLOCK_SAMPLES; pos += used) {
+            if (!sync_demod_process(&demod, &samples[pos], ADC_BLOCK_SAMPLES - pos, &used, &result)) continue;
+
+            // 最初の0.5秒は位相同期・周期測定が落ち着くまで除外
+            if (n < (uint64_t)opt.sample_hz / 2) continue;
+            i_sum += result.average / 256.0;
+            q_sum += result.quadrature / 256.0;
+            i_sq += (result.average / 256.0) * (result.average / 256.0);
+            n_sum += result.normalized / 256.0;
+            win_sum += result.shutter_count;
+            if (result.shutter_count < win_min) win_min = result.shutter_count;
+            if (result.shutter_count > win_max) win_max = result.shutter_count;
+            results++;
+        }
+        demod_time += sim_clock() - t0;
+
+        // 1ms毎の処理 (タイマー割り込み相当)
+        while (n + ADC_BLOCK_SAMPLES >= tick_next) {
+            tick_next += tick_samples;
+            ms++;
+
+            // スイッチ操作: 500msからSW1を150ms (1回), 1000msからSW2を1000ms (リピート)
+            hal_host_gpio_set(SIM_SW1_PIN, !(ms >= 500 && ms < 650));
+            hal_host_gpio_set(SIM_SW2_PIN, !(ms >= 1000 && ms < 2000));
+
+            switch_process();
+            beep_process();
+            lcd_process();
+            motor_process(sim.rises, sim.rise_period_us);
+            if (opt.motor) sim_motor(ms < opt.seconds * 600 ? SIM_MOTOR_GAIN : SIM_MOTOR_GAIN * 0.8);
+
+            if (get_sw_flag(SW_1)) { sw1++; set_beep_pattern(0xA); }
+            if (get_sw_flag(SW_2)) { sw2++; }
+            if (hal_host_pwm_level(SIM_BUZZER_PIN) != 0) beep_ms++;
+
+            // 表示 (100ms毎, 本体の1ページ目・2ページ目と同じ書式)
+            if (ms % 100 == 0) {
+                shown = result.average;
+                shown_norm = result.normalized;
+                mv = cal_convert(shown_norm);
+                lcd_position(0, 0);
+                lcd_printf("   = %+6.2q [kV]", (mv + (mv < 0 ? -5000 : 5000)) / 10000);
+                lcd_position(0, 1);
+                lcd_printf("         = %+5d", shown / (1 << DEMOD_FRAC_BITS));
+            }
+        }
+    }
+    wall = sim_clock() - wall;
+    lcd_process();
+
+    // === 判定 ===
+    sim_expected(&i_exp, &q_exp, &dc_exp);
+    if (results > 0) {
+        i_sum /= results;
+        q_sum /= results;
+        n_sum /= results;
+        i_sq = sqrt(fmax(i_sq / results - i_sum * i_sum, 0.0));
+    }
+    // 許容誤差: 理論値はサンプル点で計算済みなので、Q8の切り捨て分 + ノイズの平均化残り
+    // (判定に使ったサンプル数で)。周期ゆらぎ・模擬モーターでは周期毎にサンプル点が
+    // ずれて理論値の端数 (振幅/周期サンプル数 程度) が平均されるので、その分を足す
+    period = result.shutter_mhz > 0 ? opt.sample_hz * 1000.0 / result.shutter_mhz : 1.0;
+    tol = 0.02 + 6.0 * opt.noise / sqrt(fmax((double)total - opt.sample_hz / 2, 1.0));
+    if (opt.jitter > 0 || opt.motor) tol += 2.0 * fabs(opt.amplitude) / period;
+
+    if (results == 0 || fabs(i_sum - i_exp) > tol || fabs(q_sum - q_exp) > tol) pass = false;
+
+    // 直流オフセット (最後の値で見る。追従は約 2^DEMOD_DC_SHIFT 周期の平均)
+    dc_tol = 0.02 + 6.0 * opt.noise / sqrt(period * (1u << DEMOD_DC_SHIFT));
+    if (opt.jitter > 0 || opt.motor) dc_tol += 2.0 * fabs(opt.amplitude) / period;
+    if (fabs(result.dc_offset / 256.0 - dc_exp) > dc_tol) pass = false;
+
+    // 周波数換算 (模擬モーターでは周波数が変わるので対象外)
+    n_exp = i_exp * DEMOD_REF_FREQ_HZ / opt.shutter_hz;
+    if (!opt.motor && fabs(n_sum - n_exp) > tol * DEMOD_REF_FREQ_HZ / opt.shutter_hz) pass = false;
+
+    // 模擬LCDの表示と最後に書いた内容を比較 (既定の校正は 10.28mV/ADC値 の直線)
+    mv = (int32_t)(((int64_t)shown_norm * 10280) >> DEMOD_FRAC_BITS);
+    snprintf(expect[0], sizeof(expect[0]), "   = %+6.2f [kV]", ((mv + (mv < 0 ? -5000 : 5000)) / 10000) / 100.0);
+    snprintf(expect[1], sizeof(expect[1]), "         = %+5d ", shown / (1 << DEMOD_FRAC_BITS));
+    expect[0][HAL_HOST_LCD_COLS] = '\0';    // LCDは16桁を超えた分を表示しない
+    expect[1][HAL_HOST_LCD_COLS] = '\0';
+    lcd_ok = strcmp(hal_host_lcd_line(0), expect[0]) == 0 && strcmp(hal_host_lcd_line(1), expect[1]) == 0;
+    if (!lcd_ok) pass = false;
+
+    // モーター: 定速制御に入り、電圧を下げた後も目標の1%以内
+    if (opt.motor) {
+        motor_ok = motor_state() == MOTOR_RUN
+                && fabs(sim.rpm - motor_target()) < motor_target() * 0.01
+                && abs((int)motor_rpm() - (int)motor_target()) < (int)motor_target() / 100;
+        if (!motor_ok) pass = false;
+    }
+
+    // スイッチ: 短押しは1回、1秒押し続けるとON + リピート
+    if (opt.seconds >= 2.0 && (sw1 != 1 || sw2 < 2 || beep_ms == 0)) pass = false;
+
+    if (!opt.quiet) {
+        printf("samples         %llu (%.0f s at %.0f Hz)\n", (unsigned long long)total, opt.seconds, opt.sample_hz);
+        printf("results         %u\n", results);
+        printf("in-phase        %.3f (expected %.3f, tol %.3f, sd %.3f)\n", i_sum, i_exp, tol, i_sq);
+        printf("quadrature      %.3f (expected %.3f)\n", q_sum, q_exp);
+        printf("dc offset       %.3f (expected %.3f, tol %.3f)\n", result.dc_offset / 256.0, dc_exp, dc_tol);
+        printf("normalized      %.3f (expected %.3f at %d Hz)\n", n_sum, opt.motor ? NAN : n_exp, DEMOD_REF_FREQ_HZ);
+        if (results > 0) {
+            printf("window          %.1f (min %u, max %u)\n", (double)win_sum / results, win_min, win_max);
+        }
+        printf("demod speed     %.1f Msample/s\n", total / demod_time / 1e6);
+        printf("total speed     %.1f Msample/s (x%.0f realtime)\n", total / wall / 1e6, opt.seconds / wall);
+        printf("lcd             [%s] [%s] %s (%u nibbles)\n",
+               hal_host_lcd_line(0), hal_host_lcd_line(1), lcd_ok ? "ok" : "MISMATCH", hal_host_lcd_nibbles());
+        printf("switch          SW1=%u SW2=%u beep=%ums\n", sw1, sw2, beep_ms);
+        if (opt.motor) {
+            printf("motor           %.1f rpm (measured %u, target %u, level %u, state %d) %s\n",
+                   sim.rpm, motor_rpm(), motor_target(), motor_level(), (int)motor_state(),
+                   motor_ok ? "ok" : "NG");
+        }
+    }
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    return pass ? 0 : 1;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,177 @@
+//*****************************************************************************
+// ファイル名       log_dump.c
+// 対象             ホストPC (Linux)
+// ファイル内容     フラッシュログの読み出し (CSV出力)
+//*****************************************************************************
+// 使い方: log_dump <入力> [出力CSV]   (入力に"-"を指定すると標準入力, 出力省略時は標準出力)
+//   例) stty -F /dev/ttyACM0 raw && log_dump /dev/ttyACM0 log.csv
+// 入力がシリアルポートなら読み出し要求 "LOG:DUMP" を送ってから受け取り、全フレームが
+// 揃った時点で終わる。ページはページ番号順に並べ替え、記録を古い順に出す。
+// 時刻は起動毎の経過時間なので、起動回数 (boot) と組にして使う。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TelemetryProtocol.h"
+#include "TelemetryReader.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define USB_CMD_LOG_DUMP    "LOG:DUMP\n" // 本体への読み出し要求 (1行のコマンド)
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint8_t  *chunk_data;           // 受け取ったフレームのデータ (順番の位置に置く)
+bool     *chunk_seen;
+uint32_t chunk_total;           // 送られてくるフレーム数
+uint32_t chunk_count;           // 受け取ったフレーム数 (重複を除く)
+bool     dump_started;
+
+//*****************************************************************************
+// ログ読み出しフレームを受け取る
+//*****************************************************************************
+static void receive_frame(uint8_t type, uint16_t seq, uint32_t timestamp,
+                          const uint8_t *payload, uint8_t len) {
+    uint32_t index, total;
+
+    (void)seq;
+    (void)timestamp;
+    if (type != TELEMETRY_TYPE_LOG || len < 4) return;
+
+    index = telemetry_get_u16(&payload[0]);
+    total = telemetry_get_u16(&payload[2]);
+
+    // 順番0から受け直す (前の読み出しの残りは捨てる)
+    if (index == 0) {
+        free(chunk_data);
+        free(chunk_seen);
+        chunk_data = calloc(total ? total : 1, TELEMETRY_LOG_CHUNK_SIZE);
+        chunk_seen = calloc(total ? total : 1, sizeof(bool));
+        if (chunk_data == NULL || chunk_seen == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        chunk_total = total;
+        chunk_count = 0;
+        dump_started = true;
+    }
+    if (!dump_started || total != chunk_total) return;
+
+    if (total == 0) {
+        telemetry_reader_stop();
+        return;
+    }
+    if (index >= total || len < TELEMETRY_LOG_SIZE) {
+        fprintf(stderr, "bad log frame (index=%u total=%u len=%u)\n", index, total, len);
+        return;
+    }
+
+    if (!chunk_seen[index]) {
+        memcpy(&chunk_data[index * TELEMETRY_LOG_CHUNK_SIZE], &payload[4], TELEMETRY_LOG_CHUNK_SIZE);
+        chunk_seen[index] = true;
+        chunk_count++;
+    }
+    if (chunk_count == chunk_total) telemetry_reader_stop();
+}
+
+//*****************************************************************************
+// ページをページ番号順に並べる
+//*****************************************************************************
+static int compare_page(const void *a, const void *b) {
+    uint32_t sa = telemetry_get_u32((const uint8_t *)a + 4);
+    uint32_t sb = telemetry_get_u32((const uint8_t *)b + 4);
+
+    return sa < sb ? -1 : sa > sb ? 1 : 0;
+}
+
+//*****************************************************************************
+// 読み出し要求を送る (シリアルポートの時だけ)
+//*****************************************************************************
+static void request_dump(FILE *fp, const char *path) {
+    const char *cmd = USB_CMD_LOG_DUMP;
+    int fd;
+
+    if (fp == stdin || !isatty(fileno(fp))) return;
+
+    fd = open(path, O_WRONLY | O_NOCTTY);
+    if (fd < 0 || write(fd, cmd, strlen(cmd)) != (ssize_t)strlen(cmd)) perror(path);
+    if (fd >= 0) close(fd);
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    FILE *fp, *out_fp = stdout;
+    TelemetryLogPage h;
+    TelemetryLogRecord r;
+    uint32_t pages, i, missing = 0, bad = 0, records = 0;
+    int n, k;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <input|-> [output.csv]\n", argv[0]);
+        return 2;
+    }
+
+    fp = telemetry_reader_open(argv[1]);
+    if (fp == NULL) return 1;
+
+    if (argc > 2) {
+        out_fp = fopen(argv[2], "w");
+        if (out_fp == NULL) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+
+    request_dump(fp, argv[1]);
+    telemetry_reader_run(fp, receive_frame);
+    if (fp != stdin) fclose(fp);
+
+    if (!dump_started) {
+        fprintf(stderr, "no log frames received\n");
+        return 3;
+    }
+
+    // 欠けたフレームのあるページは使わない (CRCで弾かれる)
+    for (i = 0; i < chunk_total; i++) {
+        if (!chunk_seen[i]) missing++;
+    }
+    pages = chunk_total / 2;
+    qsort(chunk_data, pages, TELEMETRY_LOG_PAGE_SIZE, compare_page);
+
+    fprintf(out_fp, "boot,page,time_ms,potential_mv,sign,temperature_c,humidity_rh,flags\n");
+    for (i = 0; i < pages; i++) {
+        const uint8_t *page = &chunk_data[i * TELEMETRY_LOG_PAGE_SIZE];
+
+        n = telemetry_check_log_page(page, &h);
+        if (n <= 0) {
+            bad++;
+            continue;
+        }
+        for (k = 0; k < n; k++) {
+            telemetry_unpack_log_record(&page[TELEMETRY_LOG_HEADER_SIZE + k * TELEMETRY_LOG_RECORD_SIZE], &r);
+            fprintf(out_fp, "%u,%u,%u,%ld,%d,%.1f,%.1f,0x%02X\n",
+                    h.boot, h.page_seq, r.time_ms, (long)r.potential_mv, r.sign,
+                    r.temperature / 10.0, r.humidity / 10.0, r.flags);
+            records++;
+        }
+    }
+    if (out_fp != stdout) fclose(out_fp);
+
+    telemetry_reader_print_stats();
+    fprintf(stderr, "pages=%u records=%u bad_pages=%u missing_frames=%u\n", pages, records, bad, missing);
+    return (bad != 0 || missing != 0) ? 3 : 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,102 @@
+//*****************************************************************************
+// ファイル名       raw_capture.c
+// 対象             ホストPC (Linux)
+// ファイル内容     生サンプルキャプチャの復元 (CSV出力)
+//*****************************************************************************
+// 使い方: raw_capture <入力> <出力CSV>   (入力に"-"を指定すると標準入力)
+//   例) stty -F /dev/ttyACM0 raw && raw_capture /dev/ttyACM0 capture.csv
+// 本体のSW0でキャプチャを開始・停止する。
+// 出力は「通し番号,ADC値,シャッター状態」。欠落した区間は標準エラーへ出す。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "TelemetryProtocol.h"
+#include "TelemetryReader.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+FILE     *out_fp;
+bool     index_valid;
+uint32_t index_next;            // 次に来るはずのサンプル番号
+uint32_t sample_total;          // 書き出したサンプル数
+uint32_t gap_total;             // 欠落したサンプル数
+uint32_t sample_rate;           // サンプリング周波数 [Hz]
+
+//*****************************************************************************
+// 生サンプルフレームを書き出す
+//*****************************************************************************
+static void write_frame(uint8_t type, uint16_t seq, uint32_t timestamp,
+                        const uint8_t *payload, uint8_t len) {
+    TelemetryRawHeader h;
+    uint16_t values[TELEMETRY_RAW_MAX_SAMPLES];
+    uint8_t shutter[TELEMETRY_RAW_MAX_SAMPLES];
+    int i, n;
+
+    (void)seq;
+    (void)timestamp;
+    if (type != TELEMETRY_TYPE_RAW) return;
+
+    n = telemetry_unpack_raw(payload, len, &h, values, shutter);
+    if (n < 0) {
+        fprintf(stderr, "bad raw frame (len=%u)\n", len);
+        return;
+    }
+
+    if (sample_rate != h.sample_rate_hz) {
+        sample_rate = h.sample_rate_hz;
+        fprintf(out_fp, "# sample_rate_hz=%u\n", sample_rate);
+    }
+
+    // 通し番号の飛びで欠落を検出 (キャプチャ再開時も飛ぶ)
+    if (index_valid && h.first_index != index_next) {
+        fprintf(stderr, "gap: samples %u-%u missing (device dropped %u in total)\n",
+                index_next, h.first_index - 1, h.dropped);
+        gap_total += h.first_index - index_next;
+    }
+    index_valid = true;
+    index_next = h.first_index + (uint32_t)n;
+
+    for (i = 0; i < n; i++) {
+        fprintf(out_fp, "%u,%u,%u\n", h.first_index + (uint32_t)i, values[i], shutter[i]);
+    }
+    sample_total += (uint32_t)n;
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    FILE *fp;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <input|-> <output.csv>\n", argv[0]);
+        return 2;
+    }
+
+    fp = telemetry_reader_open(argv[1]);
+    if (fp == NULL) return 1;
+
+    out_fp = fopen(argv[2], "w");
+    if (out_fp == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(out_fp, "index,adc,shutter\n");
+    telemetry_reader_run(fp, write_frame);
+
+    if (fp != stdin) fclose(fp);
+    fclose(out_fp);
+
+    telemetry_reader_print_stats();
+    fprintf(stderr, "samples=%u gaps=%u\n", sample_total, gap_total);
+    return gap_total != 0 ? 3 : 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,125 @@
+//*****************************************************************************
+// ファイル名       telemetry_decode.c
+// 対象             ホストPC (Linux)
+// ファイル内容     USBテレメトリ デコーダ (CSV出力)
+//*****************************************************************************
+// 使い方: telemetry_decode [キャプチャファイル]   (省略時は標準入力)
+//   例) stty -F /dev/ttyACM0 raw && telemetry_decode /dev/ttyACM0
+// 統計 (フレーム数・CRCエラー・シーケンス欠落) は終了時に標準エラーへ出す。
+// 生サンプルフレームは概要のみ出力する (展開は raw_capture を使う)。
+// 動作状況は SYST:DIAG を送ると返ってくる (例: efm_cmd /dev/ttyACM0 SYST:DIAG)。
+// フラッシュのログ (LOG:DUMP で読み出し) は概要のみ出力する (展開は log_dump を使う)。
+// トリガーで記録した波形 (TRIG:DUMP で読み出し) は1記録1行で出力する。
+// コマンドの応答はそのまま1行で出力する。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include "TelemetryProtocol.h"
+#include "TelemetryReader.h"
+
+//*****************************************************************************
+// フレーム1個を出力
+//*****************************************************************************
+static void print_frame(uint8_t type, uint16_t seq, uint32_t timestamp,
+                        const uint8_t *payload, uint8_t len) {
+    TelemetryMeasurement m;
+    TelemetryRawHeader h;
+    TelemetryDiagnostics d;
+    unsigned int first, i;
+
+    switch (type) {
+        case TELEMETRY_TYPE_MEASUREMENT:
+            if (len < TELEMETRY_MEASUREMENT_SIZE) break;
+            telemetry_unpack_measurement(payload, &m);
+            printf("M,%u,%u,%ld,%d,%.3f,%.3f,%u,%lu,%u,%.1f,%.1f,%u,%.3f,%.3f,%u,%ld,%lu,%ld,%ld,%ld,%lu,%ld,%ld,%u\n",
+                   seq, timestamp, (long)m.potential_mv, m.sign,
+                   m.average_q8 / 256.0, m.quadrature_q8 / 256.0, m.phase_q16,
+                   (unsigned long)m.sample_count, m.shutter_count,
+                   m.temperature / 10.0, m.humidity / 10.0, m.dht11_status, m.shutter_mhz / 1000.0,
+                   m.dc_offset_q8 / 256.0, m.stats_window_s, (long)m.stats_mean_mv,
+                   (unsigned long)m.stats_stddev_mv, (long)m.stats_min_mv, (long)m.stats_max_mv,
+                   (long)m.total_mean_mv, (unsigned long)m.total_stddev_mv, (long)m.total_min_mv,
+                   (long)m.total_max_mv, m.flags);
+            break;
+
+        case TELEMETRY_TYPE_RAW:
+            if (len < TELEMETRY_RAW_HEADER_SIZE) break;
+            h.first_index = telemetry_get_u32(&payload[0]);
+            h.dropped = telemetry_get_u32(&payload[4]);
+            printf("R,%u,%u,first=%u,count=%u,dropped=%u\n",
+                   seq, timestamp, h.first_index, payload[12], h.dropped);
+            break;
+
+        case TELEMETRY_TYPE_DIAG:
+            if (len < TELEMETRY_DIAG_SIZE) break;
+            telemetry_unpack_diag(payload, &d);
+            printf("D,%u,%u,idle=%.1f%%,loop=%u/s,isr_timer=%u/%uus/%.1f%%,isr_adc=%u/%uus/%.1f%%,"
+                   "isr_gpio=%u/%uus/%.1f%%,late_max=%uus,late_hist=%u/%u/%u/%u/%u/%u,"
+                   "adc_overrun=%u,adc_error=%u,adc_late=%u,queue_max=%u,queue_drop=%u,tx_drop=%u\n",
+                   seq, timestamp, d.idle / 10.0, d.loop_rate,
+                   d.isr_count[0], d.isr_max_us[0], d.isr_load[0] / 10.0,
+                   d.isr_count[1], d.isr_max_us[1], d.isr_load[1] / 10.0,
+                   d.isr_count[2], d.isr_max_us[2], d.isr_load[2] / 10.0,
+                   d.timer_late_max_us, d.timer_late[0], d.timer_late[1], d.timer_late[2],
+                   d.timer_late[3], d.timer_late[4], d.timer_late[5],
+                   d.adc_overrun, d.adc_error, d.adc_late, d.sample_queue_max,
+                   d.sample_queue_dropped, d.telemetry_dropped);
+            break;
+
+        case TELEMETRY_TYPE_LOG:
+            if (len < 4) break;
+            printf("L,%u,%u,index=%u,total=%u\n",
+                   seq, timestamp, telemetry_get_u16(&payload[0]), telemetry_get_u16(&payload[2]));
+            break;
+
+        case TELEMETRY_TYPE_EVENT:
+            if (len < TELEMETRY_EVENT_HEADER_SIZE || len < TELEMETRY_EVENT_SIZE(payload[7])) break;
+            first = telemetry_get_u16(&payload[0]);
+            if (payload[7] == 0) {
+                printf("E,%u,%u,total=0\n", seq, timestamp);
+                break;
+            }
+            for (i = 0; i < payload[7]; i++) {
+                const uint8_t *p = &payload[TELEMETRY_EVENT_HEADER_SIZE + i * 8];
+                printf("E,%u,%u,index=%u,total=%u,trigger=%u,mode=%u,level_mv=%ld,time_us=%u,potential_mv=%ld\n",
+                       seq, timestamp, first + i, telemetry_get_u16(&payload[2]), telemetry_get_u16(&payload[4]),
+                       payload[6], (long)(int32_t)telemetry_get_u32(&payload[8]), telemetry_get_u32(p),
+                       (long)(int32_t)telemetry_get_u32(p + 4));
+            }
+            break;
+
+        case TELEMETRY_TYPE_RESPONSE:
+            printf("A,%u,%u,%.*s\n", seq, timestamp, len, (const char *)payload);
+            break;
+
+        default:
+            printf("?,%u,%u,type=0x%02X,len=%u\n", seq, timestamp, type, len);
+            break;
+    }
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(int argc, char *argv[]) {
+    FILE *fp = telemetry_reader_open(argc > 1 ? argv[1] : NULL);
+
+    if (fp == NULL) return 1;
+
+    printf("type,seq,timestamp_us,potential_mv,sign,average,quadrature,phase_q16,"
+           "sample_count,shutter_count,temperature_c,humidity_rh,dht11_status,shutter_hz,dc_offset,"
+           "stats_window_s,stats_mean_mv,stats_stddev_mv,stats_min_mv,stats_max_mv,"
+           "total_mean_mv,total_stddev_mv,total_min_mv,total_max_mv,flags\n");
+
+    telemetry_reader_run(fp, print_frame);
+    if (fp != stdin) fclose(fp);
+
+    telemetry_reader_print_stats();
+    return 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
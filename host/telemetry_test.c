@@ -0,0 +1,169 @@
+//*****************************************************************************
+// ファイル名       telemetry_test.c
+// 対象             ホストPC (Linux)
+// ファイル内容     テレメトリ受信 (フレーム切り出し・再同期) の確認
+//*****************************************************************************
+// 決まったバイト列を TelemetryReader に通し、次を確認する (ctest から実行)。
+//   ・同期バイトの前のゴミを読み飛ばし、最初のフレームを取り出せるか
+//   ・計測結果フレームの各項目がファームウェアで詰めた値と一致するか
+//   ・CRC不一致のフレームを捨て、次のフレームで再同期できるか
+//   ・シーケンス番号の欠落 (捨てたフレーム分・送信側で飛んだ分) を数えるか
+// 全て合格なら0、不合格があれば1で終了する。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "TelemetryProtocol.h"
+#include "TelemetryReader.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define CHECK(cond)     check((cond), #cond, __LINE__)
+#define TEST_FRAMES     8
+#define TEST_TYPE_OTHER 0x7F    // 計測結果以外の種別
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+// 受け取ったフレーム (受け取った時点の欠落数も残す)
+struct {
+    uint8_t  type;
+    uint16_t seq;
+    uint32_t timestamp;
+    uint8_t  payload[TELEMETRY_MAX_PAYLOAD];
+    uint8_t  len;
+    uint32_t seq_lost;
+} received[TEST_FRAMES];
+int received_num;
+
+bool pass = true;
+
+//*****************************************************************************
+// 判定 (不合格なら行番号と条件を出力)
+//*****************************************************************************
+static void check(bool ok, const char *text, int line) {
+    if (ok) return;
+    printf("line %d: %s\n", line, text);
+    pass = false;
+}
+
+//*****************************************************************************
+// フレームを受け取る
+//*****************************************************************************
+static void receive_frame(uint8_t type, uint16_t seq, uint32_t timestamp,
+                          const uint8_t *payload, uint8_t len) {
+    if (received_num >= TEST_FRAMES) return;
+    received[received_num].type = type;
+    received[received_num].seq = seq;
+    received[received_num].timestamp = timestamp;
+    memcpy(received[received_num].payload, payload, len);
+    received[received_num].len = len;
+    received[received_num].seq_lost = telemetry_reader_stats.seq_lost;
+    received_num++;
+}
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(void) {
+    static const uint8_t garbage[] = {0x00, TELEMETRY_SYNC0, 0x13, 0xFF, TELEMETRY_SYNC1};
+    uint8_t stream[4 * TELEMETRY_MAX_FRAME];
+    uint8_t payload[TELEMETRY_MEASUREMENT_SIZE];
+    TelemetryMeasurement m, got;
+    size_t len = 0, bad_size;
+    FILE *fp;
+
+    // 1: 同期の前にゴミ → 計測結果 (seq 100)
+    memset(&m, 0, sizeof(m));
+    m.potential_mv = -1234;
+    m.average_q8 = 25600;
+    m.quadrature_q8 = -77;
+    m.phase_q16 = 300;
+    m.sign = -1;
+    m.sample_count = 12500;
+    m.shutter_count = 20;
+    m.temperature = 231;
+    m.humidity = 456;
+    m.shutter_mhz = 200000;
+    m.dc_offset_q8 = -12;
+    m.flags = TELEMETRY_MEAS_FLAG_GAP;
+    telemetry_pack_measurement(payload, &m);
+    memcpy(&stream[len], garbage, sizeof(garbage));
+    len += sizeof(garbage);
+    len += telemetry_build_frame(&stream[len], TELEMETRY_TYPE_MEASUREMENT, 100, 1000000,
+                                 payload, TELEMETRY_MEASUREMENT_SIZE);
+
+    // 2: CRC不一致 (seq 101, ペイロードを1バイト壊す) → 捨てられて欠落1
+    bad_size = telemetry_build_frame(&stream[len], TEST_TYPE_OTHER, 101, 1000100,
+                                     (const uint8_t *)"OK", 2);
+    stream[len + TELEMETRY_HEADER_SIZE] ^= 0x01;
+    len += bad_size;
+
+    // 3: 正常なフレーム (seq 102)
+    len += telemetry_build_frame(&stream[len], TEST_TYPE_OTHER, 102, 1000200,
+                                 (const uint8_t *)"*IDN", 4);
+
+    // 4: 送信側で2フレーム飛んだ (seq 105)
+    len += telemetry_build_frame(&stream[len], TEST_TYPE_OTHER, 105, 1000500,
+                                 (const uint8_t *)"0", 1);
+
+    fp = tmpfile();
+    if (fp == NULL || fwrite(stream, 1, len, fp) != len) {
+        perror("tmpfile");
+        return 1;
+    }
+    rewind(fp);
+    telemetry_reader_run(fp, receive_frame);
+    fclose(fp);
+
+    // 受け取ったフレーム
+    CHECK(received_num == 3);
+    if (received_num == 3) {
+        CHECK(received[0].type == TELEMETRY_TYPE_MEASUREMENT);
+        CHECK(received[0].seq == 100);
+        CHECK(received[0].timestamp == 1000000);
+        CHECK(received[0].len == TELEMETRY_MEASUREMENT_SIZE);
+        CHECK(received[0].seq_lost == 0);
+        telemetry_unpack_measurement(received[0].payload, &got);
+        CHECK(got.potential_mv == -1234);
+        CHECK(got.average_q8 == 25600);
+        CHECK(got.quadrature_q8 == -77);
+        CHECK(got.phase_q16 == 300);
+        CHECK(got.sign == -1);
+        CHECK(got.sample_count == 12500);
+        CHECK(got.shutter_count == 20);
+        CHECK(got.temperature == 231);
+        CHECK(got.humidity == 456);
+        CHECK(got.shutter_mhz == 200000);
+        CHECK(got.dc_offset_q8 == -12);
+        CHECK(got.flags == TELEMETRY_MEAS_FLAG_GAP);
+
+        CHECK(received[1].type == TEST_TYPE_OTHER);
+        CHECK(received[1].seq == 102);
+        CHECK(received[1].timestamp == 1000200);
+        CHECK(received[1].len == 4 && memcmp(received[1].payload, "*IDN", 4) == 0);
+        CHECK(received[1].seq_lost == 1);
+
+        CHECK(received[2].seq == 105);
+        CHECK(received[2].len == 1 && received[2].payload[0] == '0');
+        CHECK(received[2].seq_lost == 3);
+    }
+
+    // 統計: ゴミと壊れたフレームは1バイトずつ読み飛ばす
+    CHECK(telemetry_reader_stats.frames == 3);
+    CHECK(telemetry_reader_stats.crc_errors == 1);
+    CHECK(telemetry_reader_stats.seq_lost == 3);
+    CHECK(telemetry_reader_stats.skipped_bytes == sizeof(garbage) + bad_size);
+
+    telemetry_reader_print_stats();
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
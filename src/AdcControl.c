@@ -0,0 +1,220 @@
+//*****************************************************************************
+// ファイル名       AdcControl.c
+// 対象マイコン     RP2040
+// ファイル内容     ADC DMAピンポン取り込みライブラリ
+//*****************************************************************************
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "AdcControl.h"
+#include "ShutterControl.h"
+#include "Diagnostics.h"
+#include "RawCapture.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint16_t            adc_buffer[2][ADC_RAW_BLOCK_SAMPLES];   // ピンポンバッファ (ADC変換値)
+uint16_t            adc_decim_block[ADC_BLOCK_SAMPLES];     // 間引き後のADC値
+uint32_t            adc_sample_block[ADC_BLOCK_SAMPLES];// シャッター情報付きサンプル
+int                 adc_dma_chan[2];                    // DMAチャネル番号
+int                 adc_next_buffer;                    // 次に完了するバッファ
+uint32_t            adc_block_count;                    // 完了ブロック数
+uint32_t            adc_start_time;                     // 変換開始時刻 [us]
+bool                adc_running;                        // 取り込み中
+bool                adc_paused;                         // 一時停止中
+uint32_t            adc_gaps;                           // 一時停止した回数 (取り込みの途切れ)
+bool                adc_gap_mark;                       // 次のブロックに途切れの印を付ける
+adc_block_handler_t adc_block_handler;                  // ブロック受け取り関数
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void adc_dma_irq_handler(void);
+static void adc_check_error(uint16_t *buff);
+
+//*****************************************************************************
+// ADC・DMA 初期化
+//*****************************************************************************
+void adc_control_init(unsigned int adc_pin, adc_block_handler_t handler) {
+    int i;
+
+    adc_block_handler = handler;
+    adc_next_buffer = 0;
+    adc_block_count = 0;
+    adc_running = false;
+    adc_paused = false;
+    adc_gaps = 0;
+    adc_gap_mark = false;
+    adc_decimate_init();
+
+    adc_init();
+    adc_set_clkdiv((ADC_CLOCK_FREQ / ADC_RAW_FREQ_HZ) - 1.0f); // 25kHz × デシメーション比
+    adc_gpio_init(adc_pin);
+    adc_select_input(adc_pin - 26);
+    adc_set_round_robin(0);         // ラウンドロビン無効
+    adc_fifo_setup(true, true, 1, true, false); // 1サンプル毎にDREQ, bit15に変換エラー
+
+    // 2チャネルを互いにチェインし、バッファを交互に埋める
+    adc_dma_chan[0] = dma_claim_unused_channel(true);
+    adc_dma_chan[1] = dma_claim_unused_channel(true);
+    for (i = 0; i < 2; i++) {
+        dma_channel_config c = dma_channel_get_default_config(adc_dma_chan[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, adc_dma_chan[i ^ 1]);
+        dma_channel_configure(adc_dma_chan[i], &c, adc_buffer[i], &adc_hw->fifo,
+                              ADC_RAW_BLOCK_SAMPLES, false);
+        dma_channel_set_irq0_enabled(adc_dma_chan[i], true);
+    }
+
+    irq_set_exclusive_handler(DMA_IRQ_0, adc_dma_irq_handler);
+    irq_set_priority(DMA_IRQ_0, 0x40); // 他の割り込み (既定 0x80) より高優先
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+//*****************************************************************************
+// ADCフリーラン開始
+//*****************************************************************************
+void adc_control_start(void) {
+    dma_channel_start(adc_dma_chan[0]);
+    adc_start_time = time_us_32();
+    adc_run(true);
+    adc_running = true;
+}
+
+//*****************************************************************************
+// 取り込みの一時停止 (フラッシュ書き換えの前に呼ぶ)
+// 割り込みを止めたままDMAを回すと、書き込み先を戻せずにバッファの後ろを壊すので
+// ADCとDMAを止めて、完了済みで未処理のブロックも捨てる
+//*****************************************************************************
+void adc_control_pause(void) {
+    int i;
+
+    if (!adc_running) return;
+
+    irq_set_enabled(DMA_IRQ_0, false);
+    adc_run(false);
+    for (i = 0; i < 2; i++) {
+        // 中止で割り込みフラグが立つことがあるので、割り込みを外してから中止してクリア
+        dma_channel_set_irq0_enabled(adc_dma_chan[i], false);
+        dma_channel_abort(adc_dma_chan[i]);
+        dma_hw->ints0 = 1u << adc_dma_chan[i];
+    }
+    adc_fifo_drain();
+    adc_running = false;
+    adc_paused = true;
+}
+
+//*****************************************************************************
+// 取り込みの再開 (一時停止していた時だけ)
+// 両バッファの先頭から取り込み直し、ブロックの時刻も再開した時刻から数え直す
+// 止めていた間 (捨てたブロックを含む) のサンプル数は生サンプルの通し番号に足す
+// 間引きフィルタも空から始め、落ち着くまでの最初のブロックには途切れの印を付ける
+//*****************************************************************************
+void adc_control_resume(void) {
+    int32_t lost;
+    int i;
+
+    if (!adc_paused) return;
+
+    lost = (int32_t)((time_us_32() - adc_start_time) / ADC_SAMPLE_PERIOD_US
+                     - adc_block_count * ADC_BLOCK_SAMPLES);
+    if (lost > 0) raw_capture_gap((uint32_t)lost);
+
+    for (i = 0; i < 2; i++) {
+        dma_channel_set_write_addr(adc_dma_chan[i], adc_buffer[i], false);
+        dma_channel_set_trans_count(adc_dma_chan[i], ADC_RAW_BLOCK_SAMPLES, false);
+        dma_channel_set_irq0_enabled(adc_dma_chan[i], true);
+    }
+    adc_next_buffer = 0;
+    adc_block_count = 0;
+    adc_decimate_init();
+    adc_gap_mark = true;
+    adc_paused = false;
+    adc_gaps++;
+    irq_set_enabled(DMA_IRQ_0, true);
+    adc_control_start();
+}
+
+//*****************************************************************************
+// 取り込みが途切れた回数
+//*****************************************************************************
+uint32_t adc_control_gaps(void) {
+    return adc_gaps;
+}
+
+//*****************************************************************************
+// DMAブロック完了割り込み処理
+//*****************************************************************************
+static void adc_dma_irq_handler(void) {
+    uint32_t diag = diag_isr_enter();
+    uint32_t mask, blocks = 0;
+    uint32_t i;
+
+    // FIFOが溢れていたら記録してクリア (書き込みで0になるビット)
+    if (adc_hw->fcs & ADC_FCS_OVER_BITS) {
+        hw_set_bits(&adc_hw->fcs, ADC_FCS_OVER_BITS);
+        diag_adc_overrun();
+    }
+
+    // 割り込みが遅れて両方完了していても、ブロック順に処理する
+    while (dma_hw->ints0 & (mask = 1u << adc_dma_chan[adc_next_buffer])) {
+        dma_hw->ints0 = mask;
+        uint16_t *buff = adc_buffer[adc_next_buffer];
+        const uint16_t *values = buff;
+        adc_check_error(buff);
+
+        // オーバーサンプリング時は間引いてから渡す
+        if (ADC_DECIM_RATIO > 1) {
+            adc_decimate(buff, adc_decim_block);
+            values = adc_decim_block;
+        }
+
+        // サンプル時刻はADCクロックとタイマが同じ水晶由来なので開始時刻から一意に決まる
+        // (間引き後はフィルタの遅れ分だけ前の時刻のシャッター状態を付ける)
+        adc_pack_shutter(values, adc_sample_block,
+                         adc_start_time + adc_block_count * ADC_BLOCK_SAMPLES * ADC_SAMPLE_PERIOD_US
+                         - ADC_DECIM_DELAY_US);
+        if (adc_gap_mark) {
+            for (i = 0; i < ADC_BLOCK_SAMPLES; i++) adc_sample_block[i] |= ADC_SAMPLE_GAP_BIT;
+            adc_gap_mark = false;
+        }
+        adc_block_handler(adc_sample_block, ADC_BLOCK_SAMPLES);
+
+        // 次にチェインされた時のために書き込み先を戻す
+        dma_channel_set_write_addr(adc_dma_chan[adc_next_buffer], buff, false);
+        adc_block_count++;
+        adc_next_buffer ^= 1;
+        blocks++;
+    }
+
+    if (blocks > 1) diag_adc_late();
+    diag_isr_exit(DIAG_ISR_ADC, diag);
+}
+
+//*****************************************************************************
+// 変換エラーのサンプルを数えて、エラービットを落とす
+//*****************************************************************************
+static void adc_check_error(uint16_t *buff) {
+    uint32_t i, any = 0, count = 0;
+
+    for (i = 0; i < ADC_RAW_BLOCK_SAMPLES; i++) any |= buff[i];
+    if (!(any & ADC_FIFO_ERROR_BIT)) return;
+
+    for (i = 0; i < ADC_RAW_BLOCK_SAMPLES; i++) {
+        if (buff[i] & ADC_FIFO_ERROR_BIT) count++;
+        buff[i] &= ADC_SAMPLE_VALUE_MASK;
+    }
+    diag_adc_error(count);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
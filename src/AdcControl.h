@@ -0,0 +1,61 @@
+//*****************************************************************************
+// ファイル名       AdcControl.h
+// 対象マイコン     RP2040
+// ファイル内容     ADC DMAピンポン取り込みライブラリ
+//*****************************************************************************
+#ifndef ADCCONTROL_H_
+#define ADCCONTROL_H_
+
+#include <stdint.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define ADC_CLOCK_FREQ          48000000    // ADCクロック周波数 (48MHz)
+#define ADC_SAMPLE_FREQ_HZ      25000       // ADCサンプリング周波数 (25kHz)
+#define ADC_SAMPLE_PERIOD_US    (1000000 / ADC_SAMPLE_FREQ_HZ)  // サンプル周期 [us]
+#define ADC_BLOCK_SAMPLES       64          // 1ブロックのサンプル数 (割り込み1回分)
+
+// オーバーサンプリング: ADCを比の倍の速さで回し、CICで ADC_SAMPLE_FREQ_HZ に間引く
+// (1で無効。ビルド時に -DADC_DECIM_RATIO=n で変更可)
+#ifndef ADC_DECIM_RATIO
+#define ADC_DECIM_RATIO         16          // デシメーション比 (400kHz → 25kHz)
+#endif
+#define ADC_MAX_FREQ_HZ         500000      // ADCの最大変換速度
+#define ADC_RAW_FREQ_HZ         (ADC_SAMPLE_FREQ_HZ * ADC_DECIM_RATIO)  // ADC変換速度
+#define ADC_RAW_BLOCK_SAMPLES   (ADC_BLOCK_SAMPLES * ADC_DECIM_RATIO)   // 1ブロックの変換数
+// 間引き後のサンプルの中心の遅れ [us] (CIC: (R-1)/2 変換周期, 補償FIR: 1サンプル周期)
+#define ADC_DECIM_DELAY_US      ((ADC_DECIM_RATIO > 1) ? \
+        (ADC_SAMPLE_PERIOD_US * (3 * ADC_DECIM_RATIO - 1) + ADC_DECIM_RATIO) / (2 * ADC_DECIM_RATIO) : 0)
+
+#if ADC_DECIM_RATIO < 1 || ADC_DECIM_RATIO > 32 || ADC_RAW_FREQ_HZ > ADC_MAX_FREQ_HZ
+#error "ADC_DECIM_RATIO must be 1..32 and keep ADC_RAW_FREQ_HZ within ADC_MAX_FREQ_HZ"
+#endif
+#define ADC_FIFO_ERROR_BIT      0x8000      // FIFOのサンプルの変換エラービット
+
+// サンプルデータ(32ビット)のビット配置
+#define ADC_SAMPLE_VALUE_MASK   0x0fff      // ADC値 (12ビット)
+#define ADC_SAMPLE_SHUTTER_BIT  (0x01 << 12)// シャッター状態 (1:開)
+#define ADC_SAMPLE_EDGE_BIT     (0x01 << 13)// 前サンプルからの間にシャッターエッジあり
+#define ADC_SAMPLE_GAP_BIT      (0x01 << 14)// 取り込みが途切れた直後 (再開後の最初のブロック)
+#define ADC_SAMPLE_LAG_SHIFT    16          // エッジからサンプルまでの遅れ (Q16サンプル)
+
+// ブロック受け取り関数 (DMA割り込み内から呼ばれる)
+typedef void (*adc_block_handler_t)(const uint32_t *samples, uint32_t count);
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void adc_control_init(unsigned int adc_pin, adc_block_handler_t handler);
+void adc_control_start(void);
+void adc_control_pause(void);
+void adc_control_resume(void);
+uint32_t adc_control_gaps(void);
+void adc_pack_shutter(const uint16_t *raw, uint32_t *samples, uint32_t block_time);
+void adc_decimate_init(void);
+void adc_decimate(const uint16_t *raw, uint16_t *out);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,81 @@
+//*****************************************************************************
+// ファイル名       AdcDecimate.c
+// 対象マイコン     RP2040
+// ファイル内容     ADCオーバーサンプリング用 CICデシメーション
+//*****************************************************************************
+// ADC_RAW_FREQ_HZ で取り込んだサンプルを3段CIC (差分遅延1) で 1/ADC_DECIM_RATIO に
+// 間引き、3タップFIR [-1, 10, -1]/8 で通過域の減衰を補償して12ビットに戻す。
+// CICの積分器は32ビットの桁あふれをそのまま使う (差分後の値は正しく戻る)。
+// 出力の中心は (3R-1)/2R サンプル周期だけ遅れる (ADC_DECIM_DELAY_US)。
+// SDKに依存しないので、ホストPCのベンチマークでもそのままビルドできる。
+//=============================================================================
+//include
+//=============================================================================
+#include "AdcControl.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define ADC_CIC_GAIN    (ADC_DECIM_RATIO * ADC_DECIM_RATIO * ADC_DECIM_RATIO) // CICの直流利得 R^3
+#define ADC_FIR_GAIN    8       // 補償FIRの係数の分母
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t adc_cic_integ[3];      // 積分器
+uint32_t adc_cic_delay[3];      // 差分器の1つ前の入力
+int32_t  adc_fir_hist[2];       // 補償FIRの過去2出力 (CIC出力)
+
+//*****************************************************************************
+// デシメーション 状態初期化
+//*****************************************************************************
+void adc_decimate_init(void) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        adc_cic_integ[i] = 0;
+        adc_cic_delay[i] = 0;
+    }
+    adc_fir_hist[0] = 0;
+    adc_fir_hist[1] = 0;
+}
+
+//*****************************************************************************
+// 1ブロック分 (ADC_RAW_BLOCK_SAMPLES → ADC_BLOCK_SAMPLES) を間引く
+// (DMA割り込みから呼ばれる)
+//*****************************************************************************
+void adc_decimate(const uint16_t *raw, uint16_t *out) {
+    uint32_t i1 = adc_cic_integ[0], i2 = adc_cic_integ[1], i3 = adc_cic_integ[2];
+    uint32_t c1, c2, c3, k, j;
+    int32_t  y;
+
+    for (k = 0; k < ADC_BLOCK_SAMPLES; k++) {
+        // 積分器 (入力レート)
+        for (j = 0; j < ADC_DECIM_RATIO; j++) {
+            i1 += *raw++;
+            i2 += i1;
+            i3 += i2;
+        }
+
+        // 差分器 (出力レート)
+        c1 = i3 - adc_cic_delay[0]; adc_cic_delay[0] = i3;
+        c2 = c1 - adc_cic_delay[1]; adc_cic_delay[1] = c1;
+        c3 = c2 - adc_cic_delay[2]; adc_cic_delay[2] = c2;
+
+        // 補償FIR (1サンプル遅れ) と利得の正規化 (四捨五入, 12ビットに制限)
+        y = 10 * adc_fir_hist[1] - adc_fir_hist[0] - (int32_t)c3;
+        adc_fir_hist[0] = adc_fir_hist[1];
+        adc_fir_hist[1] = (int32_t)c3;
+
+        y = (y < 0) ? 0 : (y + ADC_CIC_GAIN * ADC_FIR_GAIN / 2) / (ADC_CIC_GAIN * ADC_FIR_GAIN);
+        out[k] = (uint16_t)((y > ADC_SAMPLE_VALUE_MASK) ? ADC_SAMPLE_VALUE_MASK : y);
+    }
+
+    adc_cic_integ[0] = i1;
+    adc_cic_integ[1] = i2;
+    adc_cic_integ[2] = i3;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,54 @@
+//*****************************************************************************
+// ファイル名       AdcPack.c
+// 対象マイコン     RP2040
+// ファイル内容     ADCサンプルへのシャッター情報埋め込み
+//*****************************************************************************
+// SDKに依存しないので、ホストPCのベンチマークでもそのままビルドできる。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdbool.h>
+#include "AdcControl.h"
+#include "ShutterControl.h"
+
+//*****************************************************************************
+// エッジ時刻からサンプル毎のシャッター状態とエッジ位置をビットに埋め込む
+// (block_timeはブロック先頭サンプルの時刻 [us], DMA割り込みから呼ばれる)
+//*****************************************************************************
+void adc_pack_shutter(const uint16_t *raw, uint32_t *samples, uint32_t block_time) {
+    uint32_t edge_time, lag;
+    uint32_t edge_bits = 0;
+    uint32_t i = 0, next;
+    int32_t  offset;
+    bool     edge_level;
+
+    while (i < ADC_BLOCK_SAMPLES) {
+        next = ADC_BLOCK_SAMPLES;
+        if (shutter_edge_peek(&edge_time, &edge_level)) {
+            offset = (int32_t)(edge_time - block_time);
+            next = (offset <= 0) ? 0 : (offset + ADC_SAMPLE_PERIOD_US - 1) / ADC_SAMPLE_PERIOD_US;
+            if (next <= i) {
+                // エッジ後最初のサンプルにエッジからの遅れを記録 (1サンプル未満に制限)
+                shutter_edge_pop();
+                lag = i * ADC_SAMPLE_PERIOD_US - offset;
+                lag = (lag < ADC_SAMPLE_PERIOD_US) ? (lag << 16) / ADC_SAMPLE_PERIOD_US : 0xffff;
+                edge_bits = ADC_SAMPLE_EDGE_BIT | (lag << ADC_SAMPLE_LAG_SHIFT);
+                continue;
+            }
+            if (next > ADC_BLOCK_SAMPLES) next = ADC_BLOCK_SAMPLES;
+        }
+
+        // 次のエッジまでは同じ状態
+        samples[i] = raw[i] | (shutter_level() ? ADC_SAMPLE_SHUTTER_BIT : 0) | edge_bits;
+        edge_bits = 0;
+        if (shutter_level()) {
+            for (i++; i < next; i++) samples[i] = raw[i] | ADC_SAMPLE_SHUTTER_BIT;
+        } else {
+            for (i++; i < next; i++) samples[i] = raw[i];
+        }
+    }
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,319 @@
+//*****************************************************************************
+// ファイル名       Bench.c
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     処理時間ベンチマーク
+//*****************************************************************************
+// 各処理を単独で繰り返し呼び、1回あたりの最小・平均・最大をJSONで出力する。
+// 時間は hal_cycle_count() の単位 (実機はCPUクロック数, ホストPCはナノ秒)。
+// 1回ずつ割り込み禁止で計測し、空呼び出しの最小値(計測の手間)を差し引く。
+// 入力データの準備は計測の外 (setup) で行う。
+//
+// 出力例:
+// {"target":"rp2040","tick_hz":125000000,"overhead":12,"kernels":[
+//  {"name":"sync_demod_process","items":64,"iterations":1000,"min":..,"mean":..,"max":..,
+//   "mean_ns":..,"ns_per_item":..}, ...]}
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Hal.h"
+#include "AdcControl.h"
+#include "SyncDemod.h"
+#include "LcdControl.h"
+#include "SwitchControl.h"
+#include "BuzzerControl.h"
+#include "TelemetryProtocol.h"
+#include "ShutterControl.h"
+#include "MotorControl.h"
+#include "Calibration.h"
+#include "BenchShutter.h"
+#include "Bench.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define BENCH_SHUTTER_PERIOD_US 5000    // 模擬シャッター周期 (200Hz)
+#define BENCH_RAW_SAMPLES       128     // 生サンプルフレームのサンプル数
+#define BENCH_MOTOR_PIN         22      // モーターPWMピン (本体と同じ)
+#define BENCH_MOTOR_WRAP        6249    // モーターPWMラップ値 (20kHz)
+
+//=============================================================================
+// 計測項目
+//=============================================================================
+typedef struct {
+    const char *name;           // 項目名
+    uint32_t    items;          // 1回で処理する要素数 (サンプル数・文字数など)
+    uint32_t    divisor;        // 計測回数を減らす割合 (1:標準)
+    void        (*setup)(void); // 計測外の準備 (NULL可)
+    void        (*run)(void);   // 計測する処理
+} BenchKernel;
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint16_t        bench_raw[ADC_BLOCK_SAMPLES];           // 模擬ADC値
+uint16_t        bench_oversampled[ADC_RAW_BLOCK_SAMPLES];// 模擬ADC変換値 (間引き前)
+uint16_t        bench_decimated[ADC_BLOCK_SAMPLES];     // 間引き後のADC値
+uint32_t        bench_samples[ADC_BLOCK_SAMPLES];       // シャッター情報付きサンプル
+uint32_t        bench_block_time;                       // ブロック先頭時刻 [us]
+uint32_t        bench_edge_next;                        // 次の模擬エッジ時刻 [us]
+bool            bench_edge_next_level;
+SyncDemodState  bench_demod;
+DemodResult     bench_result;
+int32_t         bench_value;
+uint8_t         bench_frame[TELEMETRY_MAX_FRAME];
+uint32_t        bench_raw_words[BENCH_RAW_SAMPLES];
+uint32_t        bench_motor_ms;                         // 模擬時刻 [ms] (モーター処理用)
+uint32_t        bench_cal_ms;                           // 模擬時刻 [ms] (温湿度補正用)
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void bench_empty(void);
+static void bench_adc_setup(void);
+static void bench_adc_run(void);
+static void bench_decimate_run(void);
+static void bench_demod_setup(void);
+static void bench_demod_run(void);
+static void bench_printf_setup(void);
+static void bench_printf_run(void);
+static void bench_lcd_full_setup(void);
+static void bench_lcd_run(void);
+static void bench_switch_run(void);
+static void bench_beep_setup(void);
+static void bench_beep_run(void);
+static void bench_motor_run(void);
+static void bench_cal_setup(void);
+static void bench_cal_run(void);
+static void bench_measurement_run(void);
+static void bench_raw_run(void);
+
+const BenchKernel bench_kernels[] = {
+    {"adc_pack_shutter",     ADC_BLOCK_SAMPLES,  1, bench_adc_setup,      bench_adc_run},
+    {"adc_decimate",         ADC_RAW_BLOCK_SAMPLES, 1, NULL,              bench_decimate_run},
+    {"sync_demod_process",   ADC_BLOCK_SAMPLES,  1, bench_demod_setup,    bench_demod_run},
+    {"lcd_printf_page",      LCD_MAX_X * 2,      1, bench_printf_setup,   bench_printf_run},
+    {"lcd_process_full",     LCD_MAX_X * 2,      5, bench_lcd_full_setup, bench_lcd_run},
+    {"lcd_process_idle",     1,                  1, NULL,                 bench_lcd_run},
+    {"switch_process",       1,                  1, NULL,                 bench_switch_run},
+    {"beep_process",         1,                  1, bench_beep_setup,     bench_beep_run},
+    {"motor_process",        1,                  1, NULL,                 bench_motor_run},
+    {"cal_compensate_convert",1,                 1, bench_cal_setup,      bench_cal_run},
+    {"telemetry_measurement",1,                  1, NULL,                 bench_measurement_run},
+    {"telemetry_raw",        BENCH_RAW_SAMPLES,  1, NULL,                 bench_raw_run},
+};
+
+//*****************************************************************************
+// 1項目の計測 (min/max/sumを返す)
+//*****************************************************************************
+static void bench_measure(const BenchKernel *k, uint32_t iterations, uint32_t overhead,
+                          uint32_t *min, uint32_t *max, uint64_t *sum) {
+    uint32_t n, start, t, status;
+
+    *min = UINT32_MAX;
+    *max = 0;
+    *sum = 0;
+
+    for (n = 0; n < iterations; n++) {
+        if (k->setup) k->setup();
+
+        status = hal_irq_save();
+        start = hal_cycle_count();
+        k->run();
+        t = hal_cycle_elapsed(start);
+        hal_irq_restore(status);
+
+        t = (t > overhead) ? t - overhead : 0;
+        if (t < *min) *min = t;
+        if (t > *max) *max = t;
+        *sum += t;
+    }
+}
+
+//*****************************************************************************
+// 全項目を計測してJSONで出力
+//*****************************************************************************
+void bench_run(const char *target, uint32_t iterations) {
+    static const BenchKernel empty = {"empty", 1, 1, NULL, bench_empty};
+    uint32_t overhead, min, max, count, hz, i;
+    uint64_t sum;
+    double mean, mean_ns;
+
+    hal_cycle_init();
+    hz = hal_cycle_hz();
+
+    // 入力データ
+    for (i = 0; i < ADC_BLOCK_SAMPLES; i++) bench_raw[i] = (uint16_t)(ADC_MID_VALUE + ((i * 37) & 0xff));
+    for (i = 0; i < ADC_RAW_BLOCK_SAMPLES; i++) bench_oversampled[i] = (uint16_t)(ADC_MID_VALUE + ((i * 37) & 0xff));
+    adc_decimate_init();
+    motor_init(BENCH_MOTOR_PIN, BENCH_MOTOR_WRAP);
+    motor_start();
+    bench_motor_ms = 0;
+    shutter_init(0);
+    sync_demod_init(&bench_demod);
+    bench_block_time = 0;
+    bench_edge_next = BENCH_SHUTTER_PERIOD_US / 4;
+    bench_edge_next_level = true;
+
+    // 計測の手間 (空呼び出しの最小値)
+    bench_measure(&empty, iterations, 0, &overhead, &max, &sum);
+
+    printf("{\"target\":\"%s\",\"tick_hz\":%lu,\"overhead\":%lu,\"kernels\":[\n",
+           target, (unsigned long)hz, (unsigned long)overhead);
+
+    for (i = 0; i < sizeof(bench_kernels) / sizeof(bench_kernels[0]); i++) {
+        const BenchKernel *k = &bench_kernels[i];
+
+        count = iterations / k->divisor;
+        if (count == 0) count = 1;
+        bench_measure(k, count, overhead, &min, &max, &sum);
+
+        mean = (double)sum / count;
+        mean_ns = mean * 1e9 / hz;
+        printf(" {\"name\":\"%s\",\"items\":%lu,\"iterations\":%lu,\"min\":%lu,\"mean\":%.1f,"
+               "\"max\":%lu,\"mean_ns\":%.1f,\"ns_per_item\":%.2f}%s\n",
+               k->name, (unsigned long)k->items, (unsigned long)count, (unsigned long)min, mean,
+               (unsigned long)max, mean_ns, mean_ns / k->items,
+               (i + 1 < sizeof(bench_kernels) / sizeof(bench_kernels[0])) ? "," : "");
+    }
+    printf("]}\n");
+}
+
+//*****************************************************************************
+// 空呼び出し
+//*****************************************************************************
+static void bench_empty(void) {
+}
+
+//*****************************************************************************
+// ADCブロックへのシャッター情報埋め込み (DMA割り込みの処理)
+//*****************************************************************************
+static void bench_adc_setup(void) {
+    // このブロックまでの模擬エッジを積む (200Hzなら1ブロック2.56msに0～1個)
+    bench_block_time += ADC_BLOCK_SAMPLES * ADC_SAMPLE_PERIOD_US;
+    while ((int32_t)(bench_edge_next - (bench_block_time + ADC_BLOCK_SAMPLES * ADC_SAMPLE_PERIOD_US)) < 0) {
+        bench_shutter_edge(bench_edge_next, bench_edge_next_level);
+        bench_edge_next += BENCH_SHUTTER_PERIOD_US / 2;
+        bench_edge_next_level = !bench_edge_next_level;
+    }
+}
+
+static void bench_adc_run(void) {
+    adc_pack_shutter(bench_raw, bench_samples, bench_block_time);
+}
+
+//*****************************************************************************
+// オーバーサンプリングの間引き (DMA割り込みの処理, itemsは変換数)
+//*****************************************************************************
+static void bench_decimate_run(void) {
+    adc_decimate(bench_oversampled, bench_decimated);
+}
+
+//*****************************************************************************
+// 同期検波 (コア1の1ブロック分)
+//*****************************************************************************
+static void bench_demod_setup(void) {
+    bench_adc_setup();
+    adc_pack_shutter(bench_raw, bench_samples, bench_block_time);
+}
+
+static void bench_demod_run(void) {
+    uint32_t pos, used;
+
+    for (pos = 0; pos < ADC_BLOCK_SAMPLES; pos += used) {
+        sync_demod_process(&bench_demod, &bench_samples[pos], ADC_BLOCK_SAMPLES - pos, &used, &bench_result);
+    }
+}
+
+//*****************************************************************************
+// 表示1ページ分の書式化 (display_processの1ページ目と同じ)
+//*****************************************************************************
+static void bench_printf_setup(void) {
+    bench_value = (bench_value + 1234567) % 2000000 - 1000000;
+}
+
+static void bench_printf_run(void) {
+    lcd_position(0, 0);
+    lcd_printf("Surf. Potential ");
+    lcd_position(0, 1);
+    lcd_printf("   = %+6.2q [kV]", (bench_value + (bench_value < 0 ? -5000 : 5000)) / 10000);
+}
+
+//*****************************************************************************
+// LCD表示処理 (全セル書き換え / 変化なし)
+//*****************************************************************************
+static void bench_lcd_full_setup(void) {
+    static bool flip;
+
+    while (hal_lcd_bus_busy()) ;    // 前回の送信完了を待つ
+    flip = !flip;
+    lcd_position(0, 0);
+    lcd_printf(flip ? "ABCDEFGHIJKLMNOPabcdefghijklmnop" : "0123456789012345ponmlkjihgfedcba");
+}
+
+static void bench_lcd_run(void) {
+    lcd_process();
+}
+
+//*****************************************************************************
+// スイッチ・ブザー処理 (1ms周期の処理)
+//*****************************************************************************
+static void bench_switch_run(void) {
+    switch_process();
+}
+
+static void bench_beep_setup(void) {
+    set_beep_pattern(0xA);
+}
+
+static void bench_beep_run(void) {
+    beep_process();
+}
+
+//*****************************************************************************
+// モーター速度制御 (1ms周期の処理, 5ms毎に模擬の立ち上がり)
+//*****************************************************************************
+static void bench_motor_run(void) {
+    motor_process(++bench_motor_ms / 5, BENCH_SHUTTER_PERIOD_US);
+}
+
+//*****************************************************************************
+// 温湿度補正と校正テーブル変換 (計測毎の処理, 補間中の状態で計測)
+//*****************************************************************************
+static void bench_cal_setup(void) {
+    cal_init();
+    cal_comp_sensor(CAL_COMP_REF_TEMP, CAL_COMP_REF_HUM, 0);
+    cal_comp_sensor(CAL_COMP_REF_TEMP + 50, CAL_COMP_REF_HUM + 200, 2000);
+    bench_cal_ms = 2000;
+}
+
+static void bench_cal_run(void) {
+    bench_value = cal_convert(cal_compensate(bench_result.normalized, ++bench_cal_ms));
+}
+
+//*****************************************************************************
+// テレメトリフレーム生成
+//*****************************************************************************
+static void bench_measurement_run(void) {
+    TelemetryMeasurement m = {0};
+    uint8_t payload[TELEMETRY_MEASUREMENT_SIZE];
+
+    m.average_q8 = bench_result.average;
+    m.quadrature_q8 = bench_result.quadrature;
+    telemetry_pack_measurement(payload, &m);
+    telemetry_build_frame(bench_frame, TELEMETRY_TYPE_MEASUREMENT, 0, 0, payload, TELEMETRY_MEASUREMENT_SIZE);
+}
+
+static void bench_raw_run(void) {
+    uint8_t payload[TELEMETRY_RAW_SIZE(BENCH_RAW_SAMPLES)];
+    TelemetryRawHeader h = {0, 0, ADC_SAMPLE_FREQ_HZ, BENCH_RAW_SAMPLES};
+
+    telemetry_pack_raw(payload, &h, bench_raw_words);
+    telemetry_build_frame(bench_frame, TELEMETRY_TYPE_RAW, 0, 0, payload, TELEMETRY_RAW_SIZE(BENCH_RAW_SAMPLES));
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
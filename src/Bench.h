@@ -0,0 +1,24 @@
+//*****************************************************************************
+// ファイル名       Bench.h
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     処理時間ベンチマーク
+//*****************************************************************************
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define BENCH_ITERATIONS        1000    // 1項目あたりの計測回数 (標準)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void bench_run(const char *target, uint32_t iterations);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,66 @@
+//*****************************************************************************
+// ファイル名       BenchMain.c
+// 対象マイコン     RP2040
+// ファイル内容     処理時間ベンチマーク (実機用ファームウェア)
+//*****************************************************************************
+// ElectrostaticFieldMillBench.uf2 として別にビルドする。
+// USBシリアルが接続されると計測を行い、結果をJSONで出力する (以後10秒毎に繰り返し)。
+// 計測中はタイマー割り込みを使わないので、各処理を単独で計測できる。
+//=============================================================================
+//include
+//=============================================================================
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "Hal.h"
+#include "LcdControl.h"
+#include "SwitchControl.h"
+#include "BuzzerControl.h"
+#include "Bench.h"
+
+//=============================================================================
+// マクロ定義
+//=============================================================================
+#define BENCH_REPEAT_MS     10000   // 計測の繰り返し間隔 [ms]
+
+//*****************************************************************************
+// メイン
+//*****************************************************************************
+int main(void) {
+    int i;
+
+    stdio_init_all();
+
+    // LCD (GPIO0-5) とスイッチ (GPIO10-14) は本体と同じ配置
+    for (i = 0; i < 6; i++) {
+        gpio_init(i);
+        gpio_set_dir(i, GPIO_OUT);
+    }
+    for (i = 10; i < 15; i++) {
+        gpio_init(i);
+        gpio_set_dir(i, GPIO_IN);
+    }
+
+    lcd_init();
+    switch_init();
+    init_beep();
+
+    while (true) {
+        lcd_position(0, 0);
+        lcd_printf("Benchmark       ");
+        lcd_position(0, 1);
+        lcd_printf(stdio_usb_connected() ? "running...      " : "waiting for USB ");
+        lcd_process();
+
+        if (stdio_usb_connected()) {
+            bench_run("rp2040", BENCH_ITERATIONS);
+            sleep_ms(BENCH_REPEAT_MS);
+        } else {
+            sleep_ms(100);
+        }
+    }
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,60 @@
+//*****************************************************************************
+// ファイル名       BenchShutter.c
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     ベンチマーク用 模擬シャッターエッジ
+//*****************************************************************************
+// ShutterControl.c の代わりにリンクし、bench_shutter_edge() で積んだエッジを
+// 同じインターフェースで返す。リングバッファの読み出しは実物と同程度の処理量。
+//=============================================================================
+//include
+//=============================================================================
+#include "ShutterControl.h"
+#include "BenchShutter.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t    bench_edge_time[SHUTTER_EDGE_BUFF_SIZE];
+bool        bench_edge_level[SHUTTER_EDGE_BUFF_SIZE];
+uint32_t    bench_edge_wr;
+uint32_t    bench_edge_rd;
+bool        bench_level;
+
+//*****************************************************************************
+// 模擬エッジ追加
+//*****************************************************************************
+void bench_shutter_edge(uint32_t time_us, bool level) {
+    bench_edge_time[bench_edge_wr & (SHUTTER_EDGE_BUFF_SIZE - 1)] = time_us;
+    bench_edge_level[bench_edge_wr & (SHUTTER_EDGE_BUFF_SIZE - 1)] = level;
+    bench_edge_wr++;
+}
+
+//*****************************************************************************
+// ShutterControl.h と同じインターフェース
+//*****************************************************************************
+void shutter_init(unsigned int pin) {
+    (void)pin;
+    bench_edge_wr = 0;
+    bench_edge_rd = 0;
+    bench_level = false;
+}
+
+bool shutter_edge_peek(uint32_t *time_us, bool *level) {
+    if (bench_edge_rd == bench_edge_wr) return false;
+    *time_us = bench_edge_time[bench_edge_rd & (SHUTTER_EDGE_BUFF_SIZE - 1)];
+    *level = bench_edge_level[bench_edge_rd & (SHUTTER_EDGE_BUFF_SIZE - 1)];
+    return true;
+}
+
+void shutter_edge_pop(void) {
+    bench_level = bench_edge_level[bench_edge_rd & (SHUTTER_EDGE_BUFF_SIZE - 1)];
+    bench_edge_rd++;
+}
+
+bool shutter_level(void) {
+    return bench_level;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,20 @@
+//*****************************************************************************
+// ファイル名       BenchShutter.h
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     ベンチマーク用 模擬シャッターエッジ
+//*****************************************************************************
+#ifndef BENCHSHUTTER_H_
+#define BENCHSHUTTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void bench_shutter_edge(uint32_t time_us, bool level);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -6,8 +6,7 @@
 //=============================================================================
 //include
 //=============================================================================
-#include "hardware/gpio.h"
-#include "hardware/pwm.h"
+#include "Hal.h"
 #include "BuzzerControl.h"
 
 //=============================================================================
@@ -16,18 +15,12 @@
 unsigned long   beep_timer;     // ブザー用タイマ
 unsigned int    beep_pattern;   // ブザーパターン
 int             beep_mode;      // ブザーの処理状態
-uint            slice_num_gpio21;
 
 //*****************************************************************************
 // PWMの初期化
 //*****************************************************************************
 void init_pwm(void) {
-    gpio_set_function(21, GPIO_FUNC_PWM);
-    slice_num_gpio21 = pwm_gpio_to_slice_num(21);
-    pwm_set_output_polarity(slice_num_gpio21, PWM_CHAN_B, true);
-    pwm_set_wrap(slice_num_gpio21, 31249);  // 4kHz
-    pwm_set_chan_level(slice_num_gpio21, PWM_CHAN_B, 0);
-    pwm_set_enabled(slice_num_gpio21, true);
+    hal_pwm_init(21, 31249);    // 4kHz
 }
 
 //*****************************************************************************
@@ -46,9 +39,9 @@ void init_beep(void) {
 //*****************************************************************************
 void beep_out(int f) {
     if (f) {
-        pwm_set_chan_level(slice_num_gpio21, PWM_CHAN_B, 15625);
+        hal_pwm_set_level(21, 15625);
     } else {
-        pwm_set_chan_level(slice_num_gpio21, PWM_CHAN_B, 0);
+        hal_pwm_set_level(21, 0);
     }
 }
 
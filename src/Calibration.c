@@ -0,0 +1,435 @@
+//*****************************************************************************
+// ファイル名       Calibration.c
+// 対象マイコン     RP2040
+// ファイル内容     表面電位の多点校正 (フラッシュ保存・折れ線変換テーブル)
+//*****************************************************************************
+// 校正点 (同相成分 → 基準電圧) を極性毎に最大 CAL_MAX_POINTS 個、フラッシュの
+// データ領域の1セクタに版数・CRC付きで保存する。起動時に読み込んで等間隔の
+// 変換テーブルを作っておき、計測毎の変換は表引き1回と直線補間で済ませる。
+// 原点 (0, 0) は常に校正点に含め、最後の点より外側は最後の区間を延長する。
+// 校正手順は基準電圧を順にかけて確定 (SW3) ・飛ばす (SW4) を繰り返し、
+// 最後の点の後で保存する。有効な点が無い極性は前の校正をそのまま使う。
+// 温湿度補正の係数も同じ記録に入れる。補正の入力はDHT11の読み取り毎に
+// 目標値を計算しておき、次の読み取りまでの間に直線で近づける (読み取り毎の
+// 段差を出さない)。計測毎の処理は掛け算3回で、割り算は読み取り毎だけ。
+//=============================================================================
+//include
+//=============================================================================
+#include <stddef.h>
+#include <string.h>
+#include "Hal.h"
+#include "SyncDemod.h"
+#include "TelemetryProtocol.h"
+#include "Calibration.h"
+
+//=============================================================================
+//シンボル定義(ローカル)
+//=============================================================================
+#define CAL_DEFAULT_COUNTS      1000        // 校正が無い時の点 (ADC値, 原点との直線になる)
+
+// フラッシュ上の形式 (リトルエンディアン, crcはcrcより前の全体)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                              // sizeof(CalRecord)
+    uint8_t  count[2];                          // 極性毎の点数
+    uint8_t  reserved[2];
+    CalPoint points[2][CAL_MAX_POINTS];         // 絶対値, 同相成分の昇順
+    CalComp  comp;                              // 温湿度補正の係数
+    uint16_t crc;
+    uint16_t reserved2;
+} CalRecord;
+
+_Static_assert(sizeof(CalRecord) <= HAL_FLASH_PAGE_SIZE, "CalRecord must fit in one flash page");
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+CalRecord   cal_table;                                  // 使用中の校正点
+bool        cal_loaded;                                 // フラッシュから読めた
+int32_t     cal_lut[2][CAL_LUT_SIZE + 1];               // 区間の境目の電圧 [mV] (絶対値)
+
+// 温湿度補正 (補正値は読み取り時刻からの経過で start → target へ直線補間)
+bool        cal_comp_valid;                             // センサー値を受け取った
+uint32_t    cal_comp_time;                              // 直近の読み取り時刻 [ms]
+uint32_t    cal_comp_ramp;                              // 補間時間 [ms]
+int32_t     cal_gain_start, cal_gain_target, cal_gain_step;     // ゲイン (Q16), 変化量 (Q16/ms, Q16)
+int32_t     cal_leak_start, cal_leak_target, cal_leak_step;     // ずれ (Q8), 変化量 (Q8/ms, Q16)
+int32_t     cal_gain_now = 1 << 16;                     // 直近に使ったゲイン
+int32_t     cal_leak_now;                               // 直近に使ったずれ
+int16_t     cal_comp_temp;                              // 直近の温度 [0.1℃] (係数変更時の再計算用)
+uint16_t    cal_comp_hum;                               // 直近の湿度 [0.1%RH]
+
+// 校正手順 (基準電圧 [mV] の順番, 極性毎に絶対値の昇順, ±1/2/5/10kV)
+const int32_t cal_step_table[] = {
+    1000000, 2000000, 5000000, 10000000, -1000000, -2000000, -5000000, -10000000
+};
+#define CAL_STEPS   (sizeof(cal_step_table) / sizeof(cal_step_table[0]))
+
+volatile CalState cal_now = CAL_IDLE;                   // 手順の状態
+uint32_t    cal_index;                                  // 今の手順
+int64_t     cal_sum;                                    // 平均中の合計
+uint32_t    cal_sum_count;                              // 平均中の個数
+int32_t     cal_live;                                   // 表示用の同相成分 (短い平均, Q8)
+CalPoint    cal_captured[CAL_STEPS];                    // 確定した値 (counts_q8 = 0 は未確定)
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void cal_default(CalRecord *rec);
+static bool cal_valid(const CalRecord *rec);
+static void cal_build_lut(void);
+static void cal_finish(void);
+static bool cal_save(CalRecord *rec);
+static void cal_comp_reset(void);
+
+//*****************************************************************************
+// 校正 初期化 (フラッシュから読み込み, 無ければ既定値)
+//*****************************************************************************
+void cal_init(void) {
+    const CalRecord *stored = (const CalRecord *)hal_flash_data(CAL_FLASH_OFFSET);
+
+    cal_loaded = cal_valid(stored);
+    if (cal_loaded) {
+        memcpy(&cal_table, stored, sizeof(cal_table));
+    } else {
+        cal_default(&cal_table);
+    }
+    cal_build_lut();
+    cal_comp_reset();
+    cal_now = CAL_IDLE;
+}
+
+//*****************************************************************************
+// 同相成分 (基準シャッター周波数に換算, Q8 ADC値) → 表面電位 [mV]
+//*****************************************************************************
+int32_t cal_convert(int32_t counts_q8) {
+    int      polarity = counts_q8 < 0 ? CAL_NEGATIVE : CAL_POSITIVE;
+    uint32_t a = counts_q8 < 0 ? (uint32_t)-(int64_t)counts_q8 : (uint32_t)counts_q8;
+    uint32_t index = a >> CAL_LUT_SHIFT;
+    const int32_t *lut = cal_lut[polarity];
+    int32_t  mv;
+
+    // 範囲外は最後の区間を延長する
+    if (index >= CAL_LUT_SIZE) index = CAL_LUT_SIZE - 1;
+    mv = lut[index] + (int32_t)(((int64_t)(lut[index + 1] - lut[index]) *
+                                 (a - (index << CAL_LUT_SHIFT))) >> CAL_LUT_SHIFT);
+    return polarity == CAL_NEGATIVE ? -mv : mv;
+}
+
+//*****************************************************************************
+// フラッシュの校正を使っているか (falseは既定値)
+//*****************************************************************************
+bool cal_from_flash(void) {
+    return cal_loaded;
+}
+
+//*****************************************************************************
+// 極性毎の校正点数 (原点を除く)
+//*****************************************************************************
+uint32_t cal_point_count(int polarity) {
+    return cal_table.count[polarity];
+}
+
+//*****************************************************************************
+// 温湿度の読み取り結果 (正常に読めた時だけ呼ぶ)
+// 今の補正値から新しい目標値へ、前回からの読み取り間隔をかけて近づける
+//*****************************************************************************
+void cal_comp_sensor(int16_t temperature, uint16_t humidity, uint32_t timestamp_ms) {
+    const CalComp *k = &cal_table.comp;
+    int32_t dt = temperature - k->ref_temp;
+    int32_t dh = (int32_t)humidity - k->ref_hum;
+    int64_t drift, gain;
+    uint32_t interval;
+
+    // ゲイン = 1 / (1 + 変化) (係数はppm/1単位, 温湿度は0.1単位なので10^7で割る)
+    drift = 10000000 + (int64_t)k->gain_temp_ppm * dt + (int64_t)k->gain_hum_ppm * dh;
+    gain = drift > 0 ? ((int64_t)10000000 << 16) / drift : CAL_COMP_GAIN_MAX;
+    if (gain < CAL_COMP_GAIN_MIN) gain = CAL_COMP_GAIN_MIN;
+    if (gain > CAL_COMP_GAIN_MAX) gain = CAL_COMP_GAIN_MAX;
+
+    cal_gain_target = (int32_t)gain;
+    cal_leak_target = dh > 0 ? k->leak_q8 * dh / 10 : 0;
+
+    if (!cal_comp_valid) {
+        // 最初の読み取りはそのまま使う
+        cal_gain_now = cal_gain_target;
+        cal_leak_now = cal_leak_target;
+        cal_comp_ramp = CAL_COMP_RAMP_MIN_MS;
+    } else {
+        interval = timestamp_ms - cal_comp_time;
+        if (interval < CAL_COMP_RAMP_MIN_MS) interval = CAL_COMP_RAMP_MIN_MS;
+        if (interval > CAL_COMP_RAMP_MAX_MS) interval = CAL_COMP_RAMP_MAX_MS;
+        cal_comp_ramp = interval;
+    }
+    cal_gain_start = cal_gain_now;
+    cal_leak_start = cal_leak_now;
+    cal_gain_step = (int32_t)(((int64_t)(cal_gain_target - cal_gain_start) << 16) / cal_comp_ramp);
+    cal_leak_step = (int32_t)(((int64_t)(cal_leak_target - cal_leak_start) << 16) / cal_comp_ramp);
+    cal_comp_time = timestamp_ms;
+    cal_comp_temp = temperature;
+    cal_comp_hum = humidity;
+    cal_comp_valid = true;
+}
+
+//*****************************************************************************
+// 温湿度補正 (計測毎, 温湿度が未取得の間はそのまま返す)
+//*****************************************************************************
+int32_t cal_compensate(int32_t counts_q8, uint32_t now_ms) {
+    uint32_t elapsed;
+
+    if (!cal_comp_valid) return counts_q8;
+
+    elapsed = now_ms - cal_comp_time;
+    if (elapsed >= cal_comp_ramp) {
+        cal_gain_now = cal_gain_target;
+        cal_leak_now = cal_leak_target;
+    } else {
+        cal_gain_now = cal_gain_start + (int32_t)(((int64_t)cal_gain_step * elapsed) >> 16);
+        cal_leak_now = cal_leak_start + (int32_t)(((int64_t)cal_leak_step * elapsed) >> 16);
+    }
+    return (int32_t)(((int64_t)(counts_q8 - cal_leak_now) * cal_gain_now) >> 16);
+}
+
+//*****************************************************************************
+// 温湿度補正の係数 (設定はフラッシュへ保存, 校正点はそのまま)
+//*****************************************************************************
+void cal_get_comp(CalComp *comp) {
+    *comp = cal_table.comp;
+}
+
+bool cal_set_comp(const CalComp *comp) {
+    CalRecord rec = cal_table;
+
+    rec.comp = *comp;
+    return cal_save(&rec);
+}
+
+//*****************************************************************************
+// 直近の補正ゲイン (Q16, 表示用)
+//*****************************************************************************
+int32_t cal_comp_gain(void) {
+    return cal_gain_now;
+}
+
+//*****************************************************************************
+// 校正手順 開始
+//*****************************************************************************
+void cal_begin(void) {
+    memset(cal_captured, 0, sizeof(cal_captured));
+    cal_index = 0;
+    cal_live = 0;
+    cal_now = CAL_WAIT;
+}
+
+//*****************************************************************************
+// 今の基準電圧で確定 (平均を始める)
+//*****************************************************************************
+void cal_capture(void) {
+    if (cal_now != CAL_WAIT) return;
+    cal_sum = 0;
+    cal_sum_count = 0;
+    cal_now = CAL_CAPTURE;
+}
+
+//*****************************************************************************
+// 今の基準電圧を飛ばす
+//*****************************************************************************
+void cal_skip(void) {
+    if (cal_now != CAL_WAIT) return;
+    if (++cal_index >= CAL_STEPS) cal_finish();
+}
+
+//*****************************************************************************
+// 校正手順 中止 (校正は変えない)
+//*****************************************************************************
+void cal_cancel(void) {
+    cal_now = CAL_IDLE;
+}
+
+//*****************************************************************************
+// 計測結果を渡す (メインループから, 手順外は何もしない)
+//*****************************************************************************
+void cal_feed(int32_t counts_q8) {
+    if (cal_now != CAL_WAIT && cal_now != CAL_CAPTURE) return;
+
+    cal_live += (counts_q8 - cal_live) / 16;
+    if (cal_now != CAL_CAPTURE) return;
+
+    cal_sum += counts_q8;
+    if (++cal_sum_count < CAL_CAPTURE_RESULTS) return;
+
+    cal_captured[cal_index].counts_q8 = (int32_t)(cal_sum / (int64_t)cal_sum_count);
+    cal_captured[cal_index].mv = cal_step_table[cal_index];
+    cal_now = CAL_WAIT;
+    if (++cal_index >= CAL_STEPS) cal_finish();
+}
+
+//*****************************************************************************
+// 手順の状態・表示用
+//*****************************************************************************
+CalState cal_state(void) {
+    return cal_now;
+}
+
+uint32_t cal_step(void) {
+    return cal_index;
+}
+
+uint32_t cal_steps(void) {
+    return CAL_STEPS;
+}
+
+int32_t cal_step_mv(void) {
+    return cal_index < CAL_STEPS ? cal_step_table[cal_index] : 0;
+}
+
+int32_t cal_live_counts(void) {
+    return cal_live;
+}
+
+//=============================================================================
+// ローカル関数
+//=============================================================================
+//*****************************************************************************
+// 既定の校正 (極性毎に1点, 以前の固定換算値と同じ直線)
+//*****************************************************************************
+static void cal_default(CalRecord *rec) {
+    int p;
+
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = CAL_MAGIC;
+    rec->version = CAL_VERSION;
+    rec->size = sizeof(*rec);
+    for (p = 0; p < 2; p++) {
+        rec->count[p] = 1;
+        rec->points[p][0].counts_q8 = CAL_DEFAULT_COUNTS << DEMOD_FRAC_BITS;
+        rec->points[p][0].mv = CAL_DEFAULT_COUNTS * (CAL_DEFAULT_MV_HZ / DEMOD_REF_FREQ_HZ);
+    }
+    rec->comp.ref_temp = CAL_COMP_REF_TEMP;
+    rec->comp.ref_hum = CAL_COMP_REF_HUM;
+}
+
+//*****************************************************************************
+// 保存形式の確認 (識別子・版数・CRC・点の並び)
+//*****************************************************************************
+static bool cal_valid(const CalRecord *rec) {
+    int p;
+    uint32_t i;
+
+    if (rec->magic != CAL_MAGIC || rec->version != CAL_VERSION || rec->size != sizeof(*rec)) return false;
+    if (rec->crc != telemetry_crc16((const uint8_t *)rec, offsetof(CalRecord, crc), 0xFFFF)) return false;
+
+    for (p = 0; p < 2; p++) {
+        if (rec->count[p] == 0 || rec->count[p] > CAL_MAX_POINTS) return false;
+        for (i = 0; i < rec->count[p]; i++) {
+            int32_t prev = i ? rec->points[p][i - 1].counts_q8 : 0;
+            if (rec->points[p][i].counts_q8 <= prev) return false;
+        }
+    }
+    return true;
+}
+
+//*****************************************************************************
+// 変換テーブル作成 (校正点の間を直線補間, 外側は端の区間を延長)
+//*****************************************************************************
+static void cal_build_lut(void) {
+    int p;
+    uint32_t k, seg;
+
+    for (p = 0; p < 2; p++) {
+        const CalPoint *pt = cal_table.points[p];
+        uint32_t n = cal_table.count[p];
+
+        seg = 0;
+        for (k = 0; k <= CAL_LUT_SIZE; k++) {
+            int64_t x = (int64_t)k << CAL_LUT_SHIFT;
+            int64_t x0, y0, x1, y1;
+
+            // xを含む区間 (原点〜1点目, 以降は点の間, 最後の点より先は最後の区間)
+            while (seg + 1 < n && x > pt[seg].counts_q8) seg++;
+            x0 = seg ? pt[seg - 1].counts_q8 : 0;
+            y0 = seg ? pt[seg - 1].mv : 0;
+            x1 = pt[seg].counts_q8;
+            y1 = pt[seg].mv;
+            cal_lut[p][k] = (int32_t)(y0 + (y1 - y0) * (x - x0) / (x1 - x0));
+        }
+    }
+}
+
+//*****************************************************************************
+// 校正手順 終了 (点を並べてフラッシュへ保存, 保存したものを読み直す)
+//*****************************************************************************
+static void cal_finish(void) {
+    CalRecord rec;
+    uint32_t i, added = 0;
+    int p;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = CAL_MAGIC;
+    rec.version = CAL_VERSION;
+    rec.size = sizeof(rec);
+    rec.comp = cal_table.comp;
+
+    for (p = 0; p < 2; p++) {
+        int32_t sign = p == CAL_NEGATIVE ? -1 : 1;
+
+        for (i = 0; i < CAL_STEPS; i++) {
+            CalPoint pt = cal_captured[i];
+            int32_t prev = rec.count[p] ? rec.points[p][rec.count[p] - 1].counts_q8 : 0;
+
+            // 極性違い・未確定・単調増加にならない点は使わない
+            if (pt.mv * sign <= 0 || pt.counts_q8 * sign <= prev) continue;
+            if (rec.count[p] >= CAL_MAX_POINTS) break;
+            rec.points[p][rec.count[p]].counts_q8 = pt.counts_q8 * sign;
+            rec.points[p][rec.count[p]].mv = pt.mv * sign;
+            rec.count[p]++;
+        }
+        added += rec.count[p];
+
+        // 点が無い極性は前の校正を引き継ぐ
+        if (rec.count[p] == 0) {
+            rec.count[p] = cal_table.count[p];
+            memcpy(rec.points[p], cal_table.points[p], sizeof(rec.points[p]));
+        }
+    }
+
+    if (added == 0) {
+        cal_now = CAL_FAILED;
+        return;
+    }
+
+    cal_now = cal_save(&rec) ? CAL_SAVED : CAL_FAILED;
+}
+
+//*****************************************************************************
+// フラッシュへ保存して読み直す (読めなければfalse, 既定値に戻る)
+// 書き換えの間はADCの取り込みが止まる (hal_flash_guard で登録した処理)
+//*****************************************************************************
+static bool cal_save(CalRecord *rec) {
+    uint8_t page[HAL_FLASH_PAGE_SIZE];
+    bool    sensor = cal_comp_valid;
+
+    rec->crc = telemetry_crc16((const uint8_t *)rec, offsetof(CalRecord, crc), 0xFFFF);
+    memset(page, 0xff, sizeof(page));
+    memcpy(page, rec, sizeof(*rec));
+    hal_flash_erase(CAL_FLASH_OFFSET, HAL_FLASH_SECTOR_SIZE);
+    hal_flash_program(CAL_FLASH_OFFSET, page, sizeof(page));
+
+    cal_init();
+    if (sensor) cal_comp_sensor(cal_comp_temp, cal_comp_hum, cal_comp_time);   // 新しい係数ですぐ補正
+    return cal_loaded;
+}
+
+//*****************************************************************************
+// 温湿度補正の状態を戻す (次の読み取りまで補正なし)
+//*****************************************************************************
+static void cal_comp_reset(void) {
+    cal_comp_valid = false;
+    cal_gain_now = 1 << 16;
+    cal_leak_now = 0;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
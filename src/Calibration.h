@@ -0,0 +1,93 @@
+//*****************************************************************************
+// ファイル名       Calibration.h
+// 対象マイコン     RP2040
+// ファイル内容     表面電位の多点校正 (フラッシュ保存・折れ線変換テーブル)
+//*****************************************************************************
+#ifndef CALIBRATION_H_
+#define CALIBRATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define CAL_MAX_POINTS          8           // 極性あたりの最大校正点数
+#define CAL_DEFAULT_MV_HZ       2056000     // 校正が無い時の換算値 [mV/(ADC値/Hz)] (シャッター周波数あたり)
+#define CAL_FLASH_OFFSET        0           // フラッシュデータ領域内の保存位置 (1セクタ)
+#define CAL_MAGIC               0x434d4645u // 'EFMC'
+#define CAL_VERSION             2           // 保存形式の版数 (2: 温湿度補正を追加)
+#define CAL_CAPTURE_RESULTS     400         // 校正点1個の平均回数 (エッジ毎の結果, 200Hzで約1秒)
+
+// 変換テーブル: 0～CAL_LUT_RANGE (Q8 ADC値) を CAL_LUT_SIZE 区間に等分した折れ線
+#define CAL_LUT_SHIFT           12          // 1区間の幅 (Q8で2^12 = 16 ADC値)
+#define CAL_LUT_SIZE            128         // 区間数 (2048 ADC値まで, 超えた分は最後の区間を延長)
+
+// 温湿度補正
+#define CAL_COMP_REF_TEMP       250         // 既定の基準温度 [0.1℃]
+#define CAL_COMP_REF_HUM        500         // 既定の基準湿度 [0.1%RH]
+#define CAL_COMP_RAMP_MIN_MS    1000        // 読み取り間の補間時間の範囲 [ms] (間隔の実測値を制限)
+#define CAL_COMP_RAMP_MAX_MS    10000
+#define CAL_COMP_GAIN_MIN       (1 << 15)   // 補正ゲインの範囲 (Q16, 0.5～2倍)
+#define CAL_COMP_GAIN_MAX       (1 << 17)
+
+// 極性
+#define CAL_POSITIVE            0
+#define CAL_NEGATIVE            1
+
+typedef struct {
+    int32_t  counts_q8;         // 基準シャッター周波数に換算した同相成分 (Q8 ADC値)
+    int32_t  mv;                // 基準電圧 [mV]
+} CalPoint;
+
+// 温湿度補正の係数 (基準条件では補正なし, 係数0で無効)
+//   補正後 = (同相成分 - leak_q8 × max(湿度 - 基準湿度, 0)) / (1 + ゲイン変化)
+//   ゲイン変化 = gain_temp_ppm × (温度 - 基準温度) + gain_hum_ppm × (湿度 - 基準湿度)
+typedef struct {
+    int16_t  ref_temp;          // 基準温度 [0.1℃]
+    uint16_t ref_hum;           // 基準湿度 [0.1%RH]
+    int32_t  gain_temp_ppm;     // 温度によるゲイン変化 [ppm/℃]
+    int32_t  gain_hum_ppm;      // 湿度によるゲイン変化 [ppm/%RH]
+    int32_t  leak_q8;           // 基準湿度を超えた分の漏れ電流によるずれ [Q8 ADC値/%RH]
+} CalComp;
+
+// 校正手順の状態
+typedef enum {
+    CAL_IDLE = 0,               // 手順外
+    CAL_WAIT,                   // 基準電圧をかけて確定待ち
+    CAL_CAPTURE,                // 平均中
+    CAL_SAVED,                  // 保存完了
+    CAL_FAILED,                 // 点が足りない・書き込み失敗 (前の校正を維持)
+} CalState;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     cal_init(void);
+int32_t  cal_convert(int32_t counts_q8);
+bool     cal_from_flash(void);
+uint32_t cal_point_count(int polarity);
+
+// 温湿度補正 (センサー値は読み取り毎に渡し, 読み取り間は補間する)
+void     cal_comp_sensor(int16_t temperature, uint16_t humidity, uint32_t timestamp_ms);
+int32_t  cal_compensate(int32_t counts_q8, uint32_t now_ms);
+void     cal_get_comp(CalComp *comp);
+bool     cal_set_comp(const CalComp *comp);
+int32_t  cal_comp_gain(void);
+
+// 校正手順 (スイッチ・USBから操作, 結果はメインループから cal_feed で渡す)
+void     cal_begin(void);
+void     cal_capture(void);
+void     cal_skip(void);
+void     cal_cancel(void);
+void     cal_feed(int32_t counts_q8);
+CalState cal_state(void);
+uint32_t cal_step(void);
+uint32_t cal_steps(void);
+int32_t  cal_step_mv(void);
+int32_t  cal_live_counts(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,559 @@
+//*****************************************************************************
+// ファイル名       CommandHandlers.c
+// 対象マイコン     RP2040
+// ファイル内容     USBコマンドの処理関数とコマンド表
+//*****************************************************************************
+// 各処理関数は引数を CommandParser.c で読み、各モジュールの公開関数を呼ぶ。
+// 本体 (ElectrostaticFieldMill.c) が持つ計測値・設定は cmd_handlers_init で
+// 渡された CmdContext を通して読み書きする。応答はテレメトリの応答フレームで送る。
+//=============================================================================
+//include
+//=============================================================================
+#include "Telemetry.h"
+#include "RawCapture.h"
+#include "Diagnostics.h"
+#include "CoreQueue.h"
+#include "SyncDemod.h"
+#include "MotorControl.h"
+#include "Calibration.h"
+#include "DataLog.h"
+#include "TriggerCapture.h"
+#include "Statistics.h"
+#include "CommandParser.h"
+#include "CommandHandlers.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+const CmdContext *cmd_context;              // 本体の状態
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+static void send_response(const char *text, uint32_t len);
+static void cmd_idn(const char *args, bool query);
+static void cmd_measure_potential(const char *args, bool query);
+static void cmd_measure_all(const char *args, bool query);
+static void cmd_measure_statistics(const char *args, bool query);
+static void cmd_statistics_window(const char *args, bool query);
+static void cmd_statistics_reset(const char *args, bool query);
+static void cmd_motor_start(const char *args, bool query);
+static void cmd_motor_stop(const char *args, bool query);
+static void cmd_motor_state(const char *args, bool query);
+static void cmd_motor_rpm(const char *args, bool query);
+static void cmd_motor_duty(const char *args, bool query);
+static void cmd_demod_window(const char *args, bool query);
+static void cmd_demod_adaptive(const char *args, bool query);
+static void cmd_stream(const char *args, bool query);
+static void cmd_stream_raw(const char *args, bool query);
+static void cmd_system_diagnostics(const char *args, bool query);
+static void cmd_log_dump(const char *args, bool query);
+static void cmd_log_pages(const char *args, bool query);
+static void cmd_trigger_arm(const char *args, bool query);
+static void cmd_trigger_stop(const char *args, bool query);
+static void cmd_trigger_config(const char *args, bool query);
+static void cmd_trigger_state(const char *args, bool query);
+static void cmd_trigger_peak(const char *args, bool query);
+static void cmd_trigger_peak_reset(const char *args, bool query);
+static void cmd_trigger_dump(const char *args, bool query);
+static void cmd_cal_begin(const char *args, bool query);
+static void cmd_cal_capture(const char *args, bool query);
+static void cmd_cal_skip(const char *args, bool query);
+static void cmd_cal_cancel(const char *args, bool query);
+static void cmd_cal_state(const char *args, bool query);
+static void cmd_cal_compensation(const char *args, bool query);
+
+//=============================================================================
+// USBコマンド表 (CommandParser.c の書式, 設定は応答 "OK", 問い合わせは値を返す)
+//=============================================================================
+static const CmdEntry usb_commands[] = {
+    {"*IDN",                        CMD_QUERY,           cmd_idn},
+    {"MEASure:POTential",           CMD_QUERY,           cmd_measure_potential},
+    {"MEASure:ALL",                 CMD_QUERY,           cmd_measure_all},
+    {"MEASure:STATistics",          CMD_QUERY,           cmd_measure_statistics},
+    {"STATistics:WINDow",           CMD_SET | CMD_QUERY, cmd_statistics_window},
+    {"STATistics:RESet",            CMD_SET,             cmd_statistics_reset},
+    {"MOTor:STARt",                 CMD_SET,             cmd_motor_start},
+    {"MOTor:STOP",                  CMD_SET,             cmd_motor_stop},
+    {"MOTor:STATe",                 CMD_QUERY,           cmd_motor_state},
+    {"MOTor:RPM",                   CMD_SET | CMD_QUERY, cmd_motor_rpm},
+    {"MOTor:DUTY",                  CMD_SET | CMD_QUERY, cmd_motor_duty},
+    {"DEMod:WINDow",                CMD_SET | CMD_QUERY, cmd_demod_window},
+    {"DEMod:ADAPtive",              CMD_SET | CMD_QUERY, cmd_demod_adaptive},
+    {"STReam",                      CMD_SET | CMD_QUERY, cmd_stream},
+    {"STReam:RAW",                  CMD_SET | CMD_QUERY, cmd_stream_raw},
+    {"SYSTem:DIAGnostics",          CMD_SET | CMD_QUERY, cmd_system_diagnostics},
+    {"LOG:DUMP",                    CMD_SET,             cmd_log_dump},
+    {"LOG:PAGes",                   CMD_QUERY,           cmd_log_pages},
+    {"TRIGger:ARM",                 CMD_SET,             cmd_trigger_arm},
+    {"TRIGger:STOP",                CMD_SET,             cmd_trigger_stop},
+    {"TRIGger:CONFig",              CMD_SET | CMD_QUERY, cmd_trigger_config},
+    {"TRIGger:STATe",               CMD_QUERY,           cmd_trigger_state},
+    {"TRIGger:PEAK",                CMD_QUERY,           cmd_trigger_peak},
+    {"TRIGger:PEAK:RESet",          CMD_SET,             cmd_trigger_peak_reset},
+    {"TRIGger:DUMP",                CMD_SET,             cmd_trigger_dump},
+    {"CALibration:BEGin",           CMD_SET,             cmd_cal_begin},
+    {"CALibration:CAPTure",         CMD_SET,             cmd_cal_capture},
+    {"CALibration:SKIP",            CMD_SET,             cmd_cal_skip},
+    {"CALibration:CANCel",          CMD_SET,             cmd_cal_cancel},
+    {"CALibration:STATe",           CMD_QUERY,           cmd_cal_state},
+    {"CALibration:COMPensation",    CMD_SET | CMD_QUERY, cmd_cal_compensation},
+    {NULL, 0, NULL}
+};
+
+//*****************************************************************************
+// USBコマンド 初期化 (コマンド表を登録する)
+//*****************************************************************************
+void cmd_handlers_init(const CmdContext *context) {
+    cmd_context = context;
+    cmd_init(usb_commands, send_response);
+}
+
+//*****************************************************************************
+// USBコマンドの応答をテレメトリで送信 (空きはメインループで確かめてある)
+//*****************************************************************************
+static void send_response(const char *text, uint32_t len) {
+    if (len > TELEMETRY_MAX_PAYLOAD) len = TELEMETRY_MAX_PAYLOAD;
+    telemetry_send(TELEMETRY_TYPE_RESPONSE, (const uint8_t *)text, (uint8_t)len);
+}
+
+//=============================================================================
+// USBコマンド: 計測値
+//=============================================================================
+//*****************************************************************************
+// *IDN? → 機種名
+//*****************************************************************************
+static void cmd_idn(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply(USB_IDN);
+}
+
+//*****************************************************************************
+// MEASure:POTential? → 表面電位 [mV]
+//*****************************************************************************
+static void cmd_measure_potential(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_int(*cmd_context->potential_mv);
+}
+
+//*****************************************************************************
+// MEASure:ALL? → 表面電位 [mV],符号,同相成分 (Q8),窓の長さ,温度 [℃],湿度 [%RH],DHT11状態,回転数 [rpm]
+//*****************************************************************************
+static void cmd_measure_all(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_int(*cmd_context->potential_mv);
+    cmd_reply_int(*cmd_context->sign);
+    cmd_reply_int(*cmd_context->average);
+    cmd_reply_int((int32_t)*cmd_context->window);
+    cmd_reply_fixed(cmd_context->dht11->temperature, 1);
+    cmd_reply_fixed(cmd_context->dht11->humidity, 1);
+    cmd_reply_int(cmd_context->dht11->status);
+    cmd_reply_int((int32_t)motor_rpm());
+}
+
+//*****************************************************************************
+// MEASure:STATistics? → 移動区間と リセット後の 件数,平均,標準偏差,最小,最大 [mV]
+//*****************************************************************************
+static void cmd_measure_statistics(const char *args, bool query) {
+    StatsSummary summary[2];
+    int i;
+
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    stats_get(&summary[0], &summary[1]);
+    for (i = 0; i < 2; i++) {
+        cmd_reply_int((int32_t)summary[i].count);
+        cmd_reply_int(summary[i].mean_mv);
+        cmd_reply_int((int32_t)summary[i].stddev_mv);
+        cmd_reply_int(summary[i].min_mv);
+        cmd_reply_int(summary[i].max_mv);
+    }
+}
+
+//*****************************************************************************
+// STATistics:WINDow 10S|1MIN|10MIN (?) → 統計の移動区間
+//*****************************************************************************
+static void cmd_statistics_window(const char *args, bool query) {
+    static const char *const names[] = {"10S", "1MIN", "10MIN"};
+    uint32_t window;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply(names[stats_window()]);
+        return;
+    }
+    if (!cmd_arg_choice(&args, names, STATS_WINDOW_NUM, &window) || !cmd_arg_end(args)) return;
+    stats_set_window((StatsWindow)window);
+}
+
+//*****************************************************************************
+// STATistics:RESet → リセット後の統計を捨てる
+//*****************************************************************************
+static void cmd_statistics_reset(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    stats_reset();
+}
+
+//=============================================================================
+// USBコマンド: モーター
+//=============================================================================
+//*****************************************************************************
+// MOTor:STARt → 定速制御で起動
+//*****************************************************************************
+static void cmd_motor_start(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    motor_start();
+}
+
+//*****************************************************************************
+// MOTor:STOP → 停止
+//*****************************************************************************
+static void cmd_motor_stop(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    motor_stop();
+}
+
+//*****************************************************************************
+// MOTor:STATe? → STOP|SOFT|RUN|STALL|MANUAL
+//*****************************************************************************
+static void cmd_motor_state(const char *args, bool query) {
+    static const char *const names[] = {"STOP", "SOFT", "RUN", "STALL", "MANUAL"};
+
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply(names[motor_state()]);
+}
+
+//*****************************************************************************
+// MOTor:RPM <rpm> (?) → 目標回転数 (問い合わせは 測定値,目標値)
+//*****************************************************************************
+static void cmd_motor_rpm(const char *args, bool query) {
+    int32_t rpm;
+
+    if (query) {
+        if (!cmd_arg_end(args)) return;
+        cmd_reply_int((int32_t)motor_rpm());
+        cmd_reply_int((int32_t)motor_target());
+        return;
+    }
+    if (!cmd_arg_int(&args, &rpm) || !cmd_arg_end(args)) return;
+    if (rpm < MOTOR_RPM_MIN || rpm > MOTOR_RPM_MAX) {
+        cmd_error(CMD_ERR_RANGE);
+        return;
+    }
+    motor_set_target((uint32_t)rpm);
+}
+
+//*****************************************************************************
+// MOTor:DUTY <%> (?) → PWMのデューティ比を固定して回す (開ループ, 0で停止)
+// 上限は MOTOR_LEVEL_MAX (約32%), 問い合わせは制御中でも今の出力を返す
+//*****************************************************************************
+static void cmd_motor_duty(const char *args, bool query) {
+    int32_t duty; // [0.1%]
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_fixed(motor_level() * 1000 / (cmd_context->pwm_wrap + 1), 1);
+        return;
+    }
+    if (!cmd_arg_fixed(&args, 1, &duty) || !cmd_arg_end(args)) return;
+    if (duty < 0 || duty > MOTOR_LEVEL_MAX * 1000 / (cmd_context->pwm_wrap + 1)) {
+        cmd_error(CMD_ERR_RANGE);
+        return;
+    }
+    motor_set_level((uint32_t)duty * (cmd_context->pwm_wrap + 1) / 1000);
+}
+
+//=============================================================================
+// USBコマンド: 同期検波・送信
+//=============================================================================
+//*****************************************************************************
+// DEMod:WINDow <半周期数> (?) → 固定窓の長さ (設定すると固定窓にする, 問い合わせは今の窓)
+//*****************************************************************************
+static void cmd_demod_window(const char *args, bool query) {
+    int32_t window;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_int((int32_t)*cmd_context->window);
+        return;
+    }
+    if (!cmd_arg_int(&args, &window) || !cmd_arg_end(args)) return;
+    if (window < DEMOD_WINDOW_MIN || window > DEMOD_WINDOW_MAX) {
+        cmd_error(CMD_ERR_RANGE);
+        return;
+    }
+    *cmd_context->fixed_window = (uint32_t)window;
+    *cmd_context->adaptive = false;
+}
+
+//*****************************************************************************
+// DEMod:ADAPtive ON|OFF (?) → 適応窓を使うか
+//*****************************************************************************
+static void cmd_demod_adaptive(const char *args, bool query) {
+    bool enable;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_int(*cmd_context->adaptive);
+        return;
+    }
+    if (!cmd_arg_bool(&args, &enable) || !cmd_arg_end(args)) return;
+    *cmd_context->adaptive = enable;
+}
+
+//*****************************************************************************
+// STReam ON|OFF (?) → 計測結果のフレームを送るか
+//*****************************************************************************
+static void cmd_stream(const char *args, bool query) {
+    bool enable;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_int(*cmd_context->stream_enabled);
+        return;
+    }
+    if (!cmd_arg_bool(&args, &enable) || !cmd_arg_end(args)) return;
+    *cmd_context->stream_enabled = enable;
+}
+
+//*****************************************************************************
+// STReam:RAW ON|OFF (?) → 生サンプルのキャプチャ
+//*****************************************************************************
+static void cmd_stream_raw(const char *args, bool query) {
+    bool enable;
+
+    if (query) {
+        if (cmd_arg_end(args)) cmd_reply_int(raw_capture_enabled());
+        return;
+    }
+    if (!cmd_arg_bool(&args, &enable) || !cmd_arg_end(args)) return;
+    raw_capture_enable(enable);
+}
+
+//*****************************************************************************
+// SYSTem:DIAGnostics → 動作状況のフレームを送る
+// SYSTem:DIAGnostics? → アイドル率 [%],ループ回転数,ADC溢れ,ADCエラー,ADC遅れ,キュー最大,キュー破棄,送信破棄
+//*****************************************************************************
+static void cmd_system_diagnostics(const char *args, bool query) {
+    DiagSnapshot diag;
+
+    if (!cmd_arg_end(args)) return;
+    if (!query) {
+        cmd_context->send_diagnostics();
+        return;
+    }
+    diag_get(&diag);
+    cmd_reply_fixed(diag.idle, 1);
+    cmd_reply_int((int32_t)diag.loop_rate);
+    cmd_reply_int((int32_t)diag.adc_overrun);
+    cmd_reply_int((int32_t)diag.adc_error);
+    cmd_reply_int((int32_t)diag.adc_late);
+    cmd_reply_int(diag.sample_queue_max);
+    cmd_reply_int((int32_t)sample_queue_dropped());
+    cmd_reply_int((int32_t)telemetry_dropped());
+}
+
+//=============================================================================
+// USBコマンド: ログ・トリガー
+//=============================================================================
+//*****************************************************************************
+// LOG:DUMP → フラッシュのログを全部送る
+//*****************************************************************************
+static void cmd_log_dump(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    log_dump_start();
+}
+
+//*****************************************************************************
+// LOG:PAGes? → 記録済みのページ数
+//*****************************************************************************
+static void cmd_log_pages(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_int((int32_t)log_pages());
+}
+
+//*****************************************************************************
+// TRIGger:ARM → アーム (前の記録は捨てる)
+//*****************************************************************************
+static void cmd_trigger_arm(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    trig_arm();
+}
+
+//*****************************************************************************
+// TRIGger:STOP → 停止 (記録済みなら保持)
+//*****************************************************************************
+static void cmd_trigger_stop(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    trig_disarm();
+}
+
+//*****************************************************************************
+// TRIGger:CONFig <条件>,<しきい値 [mV]>[,<前の記録数>,<後の記録数>] (?)
+//   条件: LRISE|LFALL (しきい値を横切る) SRISE|SFALL|SANY (1回の変化がしきい値以上)
+//*****************************************************************************
+static void cmd_trigger_config(const char *args, bool query) {
+    static const char *const names[] = {"LRISE", "LFALL", "SRISE", "SFALL", "SANY"};
+    uint32_t mode;
+    int32_t level, pre = (int32_t)trig_pre_length(), post = (int32_t)trig_post_length();
+
+    if (query) {
+        if (!cmd_arg_end(args)) return;
+        cmd_reply(names[trig_mode()]);
+        cmd_reply_int(trig_level());
+        cmd_reply_int(pre);
+        cmd_reply_int(post);
+        return;
+    }
+    if (!cmd_arg_choice(&args, names, TRIG_MODE_NUM, &mode) || !cmd_arg_int(&args, &level)) return;
+    while (*args == ' ' || *args == '\t') args++;
+    if (*args != '\0' && (!cmd_arg_int(&args, &pre) || !cmd_arg_int(&args, &post))) return;
+    if (!cmd_arg_end(args)) return;
+    if (pre < 0 || post < 0 || !trig_config((TrigMode)mode, level, (uint32_t)pre, (uint32_t)post)) {
+        cmd_error(CMD_ERR_RANGE);
+    }
+}
+
+//*****************************************************************************
+// TRIGger:STATe? → OFF|ARMED|POST|HOLD,記録数,トリガー位置
+//*****************************************************************************
+static void cmd_trigger_state(const char *args, bool query) {
+    static const char *const names[] = {"OFF", "ARMED", "POST", "HOLD"};
+
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply(names[trig_state()]);
+    cmd_reply_int((int32_t)trig_count());
+    cmd_reply_int((int32_t)trig_position());
+}
+
+//*****************************************************************************
+// TRIGger:PEAK? → ピークホールドの 最大,最小 [mV]
+//*****************************************************************************
+static void cmd_trigger_peak(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply_int(trig_peak_max());
+    cmd_reply_int(trig_peak_min());
+}
+
+//*****************************************************************************
+// TRIGger:PEAK:RESet → ピークホールドをやり直す
+//*****************************************************************************
+static void cmd_trigger_peak_reset(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    trig_peak_reset();
+}
+
+//*****************************************************************************
+// TRIGger:DUMP → 記録した波形を送る
+//*****************************************************************************
+static void cmd_trigger_dump(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    trig_dump_start();
+}
+
+//=============================================================================
+// USBコマンド: 校正
+//=============================================================================
+//*****************************************************************************
+// CALibration:BEGin → 校正手順を始める (最初の基準電圧で確定待ち)
+//*****************************************************************************
+static void cmd_cal_begin(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cal_begin();
+}
+
+//*****************************************************************************
+// CALibration:CAPTure → 今の基準電圧で確定 (確定待ちの時だけ)
+//*****************************************************************************
+static void cmd_cal_capture(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    if (cal_state() != CAL_WAIT) {
+        cmd_error(CMD_ERR_CONFLICT);
+        return;
+    }
+    cal_capture();
+}
+
+//*****************************************************************************
+// CALibration:SKIP → 今の基準電圧を飛ばす (確定待ちの時だけ)
+//*****************************************************************************
+static void cmd_cal_skip(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    if (cal_state() != CAL_WAIT) {
+        cmd_error(CMD_ERR_CONFLICT);
+        return;
+    }
+    cal_skip();
+}
+
+//*****************************************************************************
+// CALibration:CANCel → 校正手順を中止 (校正は変えない)
+//*****************************************************************************
+static void cmd_cal_cancel(const char *args, bool query) {
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cal_cancel();
+}
+
+//*****************************************************************************
+// CALibration:STATe? → IDLE|WAIT|CAPTURE|SAVED|FAILED,手順番号,手順数,基準電圧 [mV],同相成分 (Q8)
+//*****************************************************************************
+static void cmd_cal_state(const char *args, bool query) {
+    static const char *const names[] = {"IDLE", "WAIT", "CAPTURE", "SAVED", "FAILED"};
+
+    (void)query;
+    if (!cmd_arg_end(args)) return;
+    cmd_reply(names[cal_state()]);
+    cmd_reply_int((int32_t)cal_step());
+    cmd_reply_int((int32_t)cal_steps());
+    cmd_reply_int(cal_step_mv());
+    cmd_reply_int(cal_live_counts());
+}
+
+//*****************************************************************************
+// CALibration:COMPensation <基準温度 [℃]>,<基準湿度 [%RH]>,<温度係数 [ppm/℃]>,
+//                          <湿度係数 [ppm/%RH]>,<漏れ [Q8 ADC値/%RH]> (?)
+// 設定はフラッシュへ保存する
+//*****************************************************************************
+static void cmd_cal_compensation(const char *args, bool query) {
+    CalComp comp;
+    int32_t ref_temp, ref_hum;
+
+    cal_get_comp(&comp);
+    if (query) {
+        if (!cmd_arg_end(args)) return;
+        cmd_reply_fixed(comp.ref_temp, 1);
+        cmd_reply_fixed(comp.ref_hum, 1);
+        cmd_reply_int(comp.gain_temp_ppm);
+        cmd_reply_int(comp.gain_hum_ppm);
+        cmd_reply_int(comp.leak_q8);
+        return;
+    }
+    if (!cmd_arg_fixed(&args, 1, &ref_temp) || !cmd_arg_fixed(&args, 1, &ref_hum) ||
+        !cmd_arg_int(&args, &comp.gain_temp_ppm) || !cmd_arg_int(&args, &comp.gain_hum_ppm) ||
+        !cmd_arg_int(&args, &comp.leak_q8) || !cmd_arg_end(args)) return;
+    if (ref_temp < -400 || ref_temp > 850 || ref_hum < 0 || ref_hum > 1000) {
+        cmd_error(CMD_ERR_RANGE);
+        return;
+    }
+    comp.ref_temp = (int16_t)ref_temp;
+    comp.ref_hum = (uint16_t)ref_hum;
+    if (!cal_set_comp(&comp)) cmd_error(CMD_ERR_EXECUTION);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,40 @@
+//*****************************************************************************
+// ファイル名       CommandHandlers.h
+// 対象マイコン     RP2040
+// ファイル内容     USBコマンドの処理関数とコマンド表
+//*****************************************************************************
+#ifndef COMMANDHANDLERS_H_
+#define COMMANDHANDLERS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Dht11Control.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define USB_IDN             "EFM,ElectrostaticFieldMill,0,0.1" // *IDN? の応答 (メーカー,機種,製造番号,版)
+
+// コマンドから参照・変更する本体の状態 (本体が持ち、cmd_handlers_init で渡す)
+typedef struct {
+    const int32_t     *potential_mv;        // 表面電位 [mV]
+    const int16_t     *sign;                // 表面電位の符号 (1:正, -1:負)
+    const int32_t     *average;             // ADC平均値 (位相補償済み同相成分, Q8)
+    const uint32_t    *window;              // 最新結果の窓の長さ (半周期数)
+    const Dht11Data   *dht11;               // DHT11の最新読み取り結果
+    volatile bool     *adaptive;            // 適応窓を使うか (コア1が反映)
+    volatile uint32_t *fixed_window;        // 固定窓の長さ (コア1が反映)
+    bool              *stream_enabled;      // 計測結果をテレメトリで送るか
+    uint16_t           pwm_wrap;            // モーターPWMのラップ値 (デューティ比の換算)
+    void             (*send_diagnostics)(void); // 動作状況のフレームを送る
+} CmdContext;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void cmd_handlers_init(const CmdContext *context);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
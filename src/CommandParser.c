@@ -0,0 +1,472 @@
+//*****************************************************************************
+// ファイル名       CommandParser.c
+// 対象マイコン     RP2040
+// ファイル内容     USBコマンド解釈 (SCPI風の行単位, ノンブロッキング)
+//*****************************************************************************
+// USBから届いた文字を受信リングに溜め、メインループから cmd_process を呼ぶ毎に
+// 1行まで取り出して実行する。1行は ';' で区切った複数のコマンドを含められる。
+//   ヘッダー  "MEASure:POTential?" のように ':' で区切り、各段は短縮形 (大文字部分)
+//             か完全形で書く (大文字小文字は区別しない, 先頭の ':' は省略可)
+//   引数      ヘッダーの後ろに空白を空けて ',' 区切り
+// 1行につき応答を1回返す。問い合わせの結果は ';' 区切りでまとめ (1コマンドの
+// 複数の値は ',' 区切り)、問い合わせが無ければ "OK"、エラーなら最初のエラーで
+// 実行を止めて "ERR <番号>,\"<内容>\"" を返す (それまでのコマンドは実行済み)。
+// 応答の送り方は cmd_init で渡す関数が決める。
+//=============================================================================
+//include
+//=============================================================================
+#include <stddef.h>
+#include <string.h>
+#include "CommandParser.h"
+
+_Static_assert((CMD_RX_SIZE & (CMD_RX_SIZE - 1)) == 0, "CMD_RX_SIZE must be a power of 2");
+
+//=============================================================================
+//シンボル定義(ローカル)
+//=============================================================================
+#define CMD_RX_MASK     (CMD_RX_SIZE - 1)
+
+typedef struct {
+    int         code;
+    const char *text;
+} CmdErrorText;
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+const CmdEntry *cmd_table;                  // コマンド表
+CmdRespond  cmd_respond;                    // 応答の送り先
+
+// 受信リング (メインループのみで使う)
+char        cmd_rx[CMD_RX_SIZE];
+uint32_t    cmd_rx_wr;                      // 書き込み位置 (通し番号)
+uint32_t    cmd_rx_rd;                      // 読み出し位置 (通し番号)
+bool        cmd_overrun;                    // 受信リングがあふれた (次の行でエラーにする)
+
+// 組み立て中の行
+char        cmd_line[CMD_LINE_SIZE + 1];
+uint32_t    cmd_line_len;
+bool        cmd_line_long;                  // 長すぎて捨てている
+
+// 実行中の行の応答
+char        cmd_resp[CMD_RESPONSE_SIZE];
+uint32_t    cmd_resp_len;
+uint32_t    cmd_items;                      // 実行中のコマンドが返した値の数
+bool        cmd_queried;                    // 問い合わせがあった
+int         cmd_err;                        // 最初のエラー (0: なし)
+
+const CmdErrorText cmd_error_texts[] = {
+    {CMD_ERR_SYNTAX,            "Syntax error"},
+    {CMD_ERR_DATA_TYPE,         "Data type error"},
+    {CMD_ERR_PARAM_NOT_ALLOWED, "Parameter not allowed"},
+    {CMD_ERR_MISSING_PARAM,     "Missing parameter"},
+    {CMD_ERR_UNDEFINED,         "Undefined header"},
+    {CMD_ERR_EXECUTION,         "Execution error"},
+    {CMD_ERR_CONFLICT,          "Settings conflict"},
+    {CMD_ERR_RANGE,             "Data out of range"},
+    {CMD_ERR_TOO_LONG,          "Too much data"},
+    {CMD_ERR_OVERRUN,           "Input buffer overrun"},
+};
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void cmd_execute(char *line);
+static void cmd_run(char *command);
+static bool cmd_match(const char *pattern, uint32_t pattern_len, const char *word, uint32_t word_len);
+static bool cmd_match_header(const char *pattern, const char *header, uint32_t header_len);
+static void cmd_append(const char *text, uint32_t len);
+static const char *cmd_format(char *text, uint32_t size, int32_t value, uint32_t decimals);
+static const char *cmd_token(const char **args, uint32_t *len);
+static char cmd_upper(char c);
+static bool cmd_is_space(char c);
+
+//*****************************************************************************
+// コマンド解釈 初期化
+//*****************************************************************************
+void cmd_init(const CmdEntry *table, CmdRespond respond) {
+    cmd_table = table;
+    cmd_respond = respond;
+    cmd_rx_wr = 0;
+    cmd_rx_rd = 0;
+    cmd_overrun = false;
+    cmd_line_len = 0;
+    cmd_line_long = false;
+}
+
+//*****************************************************************************
+// 受信した1文字を溜める (満杯ならfalse, 次の行をエラーにする)
+//*****************************************************************************
+bool cmd_receive(char c) {
+    if (cmd_rx_wr - cmd_rx_rd >= CMD_RX_SIZE) {
+        cmd_overrun = true;
+        return false;
+    }
+    cmd_rx[cmd_rx_wr & CMD_RX_MASK] = c;
+    cmd_rx_wr++;
+    return true;
+}
+
+//*****************************************************************************
+// 受信リングの空き
+//*****************************************************************************
+uint32_t cmd_rx_free(void) {
+    return CMD_RX_SIZE - (cmd_rx_wr - cmd_rx_rd);
+}
+
+//*****************************************************************************
+// 受信リングから1行まで取り出して実行 (1行実行したらtrue)
+//*****************************************************************************
+bool cmd_process(void) {
+    char c;
+
+    while (cmd_rx_rd != cmd_rx_wr) {
+        c = cmd_rx[cmd_rx_rd & CMD_RX_MASK];
+        cmd_rx_rd++;
+
+        if (c != '\r' && c != '\n') {
+            if (cmd_line_len < CMD_LINE_SIZE) {
+                cmd_line[cmd_line_len++] = c;
+            } else {
+                cmd_line_long = true;
+            }
+            continue;
+        }
+
+        // 行の終わり (CRLFの空行は無視)
+        if (cmd_line_len == 0 && !cmd_line_long) continue;
+        cmd_line[cmd_line_len] = '\0';
+        cmd_execute(cmd_line);
+        cmd_line_len = 0;
+        cmd_line_long = false;
+        return true;
+    }
+    return false;
+}
+
+//*****************************************************************************
+// 応答に文字列を1個足す
+//*****************************************************************************
+void cmd_reply(const char *text) {
+    // 行内の2個目以降のコマンドは ';', 1コマンドの2個目以降の値は ',' で区切る
+    if (cmd_items > 0) {
+        cmd_append(",", 1);
+    } else if (cmd_resp_len > 0) {
+        cmd_append(";", 1);
+    }
+    cmd_append(text, (uint32_t)strlen(text));
+    cmd_items++;
+}
+
+//*****************************************************************************
+// 応答に整数を1個足す
+//*****************************************************************************
+void cmd_reply_int(int32_t value) {
+    cmd_reply_fixed(value, 0);
+}
+
+//*****************************************************************************
+// 応答に固定小数点の値を1個足す (value / 10^decimals を小数で書く)
+//*****************************************************************************
+void cmd_reply_fixed(int32_t value, uint32_t decimals) {
+    char text[16];
+
+    cmd_reply(cmd_format(text, sizeof(text), value, decimals));
+}
+
+//*****************************************************************************
+// エラーにする (行の残りは実行しない, 最初のエラーを返す)
+//*****************************************************************************
+void cmd_error(int code) {
+    if (cmd_err == 0) cmd_err = code;
+}
+
+//*****************************************************************************
+// 整数の引数を1個読む (読めなければエラーにしてfalse)
+//*****************************************************************************
+bool cmd_arg_int(const char **args, int32_t *value) {
+    return cmd_arg_fixed(args, 0, value);
+}
+
+//*****************************************************************************
+// 小数の引数を1個読み、10^decimals 倍の整数にする (それより下の桁は切り捨て)
+//*****************************************************************************
+bool cmd_arg_fixed(const char **args, uint32_t decimals, int32_t *value) {
+    const char *p;
+    uint32_t len, i, frac = 0;
+    uint64_t v = 0;
+    bool negative = false, digit = false, point = false;
+
+    p = cmd_token(args, &len);
+    if (p == NULL) {
+        cmd_error(CMD_ERR_MISSING_PARAM);
+        return false;
+    }
+
+    i = 0;
+    if (p[0] == '+' || p[0] == '-') {
+        negative = p[0] == '-';
+        i++;
+    }
+    for (; i < len; i++) {
+        if (p[i] == '.' && !point) {
+            point = true;
+        } else if (p[i] >= '0' && p[i] <= '9') {
+            digit = true;
+            if (point && frac >= decimals) continue;
+            if (point) frac++;
+            v = v * 10 + (uint32_t)(p[i] - '0');
+            if (v > 0x80000000u) {
+                cmd_error(CMD_ERR_RANGE);
+                return false;
+            }
+        } else {
+            cmd_error(CMD_ERR_DATA_TYPE);
+            return false;
+        }
+    }
+    if (!digit) {
+        cmd_error(CMD_ERR_DATA_TYPE);
+        return false;
+    }
+    for (; frac < decimals; frac++) {
+        v *= 10;
+        if (v > 0x80000000u) {
+            cmd_error(CMD_ERR_RANGE);
+            return false;
+        }
+    }
+    if (!negative && v > 0x7fffffffu) {
+        cmd_error(CMD_ERR_RANGE);
+        return false;
+    }
+
+    *value = negative ? (int32_t)(0u - (uint32_t)v) : (int32_t)v;
+    return true;
+}
+
+//*****************************************************************************
+// ON/OFF (1/0) の引数を1個読む
+//*****************************************************************************
+bool cmd_arg_bool(const char **args, bool *value) {
+    static const char *const names[] = {"OFF", "ON", "0", "1"};
+    uint32_t index;
+
+    if (!cmd_arg_choice(args, names, 4, &index)) return false;
+    *value = (index & 1) != 0;
+    return true;
+}
+
+//*****************************************************************************
+// 選択肢の引数を1個読む (names は長短形式, 見つからなければエラー)
+//*****************************************************************************
+bool cmd_arg_choice(const char **args, const char *const *names, uint32_t num, uint32_t *index) {
+    const char *p;
+    uint32_t len, i;
+
+    p = cmd_token(args, &len);
+    if (p == NULL) {
+        cmd_error(CMD_ERR_MISSING_PARAM);
+        return false;
+    }
+    for (i = 0; i < num; i++) {
+        if (cmd_match(names[i], (uint32_t)strlen(names[i]), p, len)) {
+            *index = i;
+            return true;
+        }
+    }
+    cmd_error(CMD_ERR_DATA_TYPE);
+    return false;
+}
+
+//*****************************************************************************
+// 引数が残っていないか (残っていればエラー)
+//*****************************************************************************
+bool cmd_arg_end(const char *args) {
+    while (cmd_is_space(*args)) args++;
+    if (*args == '\0') return true;
+
+    cmd_error(CMD_ERR_PARAM_NOT_ALLOWED);
+    return false;
+}
+
+//*****************************************************************************
+// 1行を実行して応答を返す
+//*****************************************************************************
+static void cmd_execute(char *line) {
+    char *command = line, *end;
+    const char *text, *number;
+    uint32_t i;
+    char code[16];
+
+    cmd_resp_len = 0;
+    cmd_queried = false;
+    cmd_err = 0;
+
+    if (cmd_overrun) {
+        cmd_overrun = false;
+        cmd_error(CMD_ERR_OVERRUN);
+    } else if (cmd_line_long) {
+        cmd_error(CMD_ERR_TOO_LONG);
+    }
+
+    // ';' 毎に実行 (エラーが出たら残りは実行しない)
+    while (cmd_err == 0) {
+        end = strchr(command, ';');
+        if (end != NULL) *end = '\0';
+        cmd_run(command);
+        if (end == NULL) break;
+        command = end + 1;
+    }
+
+    if (cmd_err != 0) {
+        text = "Unknown error";
+        for (i = 0; i < sizeof(cmd_error_texts) / sizeof(cmd_error_texts[0]); i++) {
+            if (cmd_error_texts[i].code == cmd_err) text = cmd_error_texts[i].text;
+        }
+        cmd_resp_len = 0;
+        cmd_append("ERR ", 4);
+        number = cmd_format(code, sizeof(code), cmd_err, 0);
+        cmd_append(number, (uint32_t)strlen(number));
+        cmd_append(",\"", 2);
+        cmd_append(text, (uint32_t)strlen(text));
+        cmd_append("\"", 1);
+    } else if (!cmd_queried) {
+        cmd_append("OK", 2);
+    }
+
+    if (cmd_respond != NULL) cmd_respond(cmd_resp, cmd_resp_len);
+}
+
+//*****************************************************************************
+// コマンド1個を実行
+//*****************************************************************************
+static void cmd_run(char *command) {
+    const CmdEntry *e;
+    const char *header;
+    uint32_t len;
+    bool query = false, root;
+
+    while (cmd_is_space(*command)) command++;
+    root = *command == ':';
+    if (root) command++;
+    header = command;
+    while (*command != '\0' && !cmd_is_space(*command)) command++;
+    len = (uint32_t)(command - header);
+    if (len == 0) {
+        if (root) cmd_error(CMD_ERR_SYNTAX);
+        return; // 空のコマンド (行末の ';' など) は無視
+    }
+    if (header[len - 1] == '?') {
+        query = true;
+        len--;
+    }
+
+    for (e = cmd_table; e != NULL && e->header != NULL; e++) {
+        if (!cmd_match_header(e->header, header, len)) continue;
+        if (!(e->flags & (query ? CMD_QUERY : CMD_SET))) continue;
+
+        cmd_items = 0;
+        if (query) cmd_queried = true;
+        e->handler(command, query);
+        return;
+    }
+    cmd_error(CMD_ERR_UNDEFINED);
+}
+
+//*****************************************************************************
+// 1語を長短形式と比べる (短縮形は先頭の大文字・数字・記号部分)
+//*****************************************************************************
+static bool cmd_match(const char *pattern, uint32_t pattern_len, const char *word, uint32_t word_len) {
+    uint32_t short_len = 0, i;
+
+    while (short_len < pattern_len && !(pattern[short_len] >= 'a' && pattern[short_len] <= 'z')) short_len++;
+    if (word_len != short_len && word_len != pattern_len) return false;
+
+    for (i = 0; i < word_len; i++) {
+        if (cmd_upper(word[i]) != cmd_upper(pattern[i])) return false;
+    }
+    return true;
+}
+
+//*****************************************************************************
+// ヘッダーを表の書式と比べる (':' で区切った段毎に比べる)
+//*****************************************************************************
+static bool cmd_match_header(const char *pattern, const char *header, uint32_t header_len) {
+    const char *pattern_end, *word_end, *end = header + header_len;
+
+    while (true) {
+        pattern_end = strchr(pattern, ':');
+        if (pattern_end == NULL) pattern_end = pattern + strlen(pattern);
+        word_end = memchr(header, ':', (size_t)(end - header));
+        if (word_end == NULL) word_end = end;
+
+        if (!cmd_match(pattern, (uint32_t)(pattern_end - pattern), header, (uint32_t)(word_end - header))) return false;
+        if (*pattern_end == '\0' || word_end == end) return *pattern_end == '\0' && word_end == end;
+
+        pattern = pattern_end + 1;
+        header = word_end + 1;
+    }
+}
+
+//*****************************************************************************
+// 応答バッファに足す (あふれた分は切り捨て)
+//*****************************************************************************
+static void cmd_append(const char *text, uint32_t len) {
+    if (len > CMD_RESPONSE_SIZE - cmd_resp_len) len = CMD_RESPONSE_SIZE - cmd_resp_len;
+    memcpy(&cmd_resp[cmd_resp_len], text, len);
+    cmd_resp_len += len;
+}
+
+//*****************************************************************************
+// 固定小数点の値を文字列にする (value / 10^decimals, text の末尾から詰める)
+//*****************************************************************************
+static const char *cmd_format(char *text, uint32_t size, int32_t value, uint32_t decimals) {
+    char *p = &text[size - 1];
+    uint32_t v = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+    uint32_t digits = 0;
+
+    *p = '\0';
+    do {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+        if (++digits == decimals) *--p = '.';
+    } while (v != 0 || digits <= decimals);
+    if (value < 0) *--p = '-';
+    return p;
+}
+
+//*****************************************************************************
+// 引数を1個切り出す (前後の空白と続く ',' を読み飛ばす, 無ければNULL)
+//*****************************************************************************
+static const char *cmd_token(const char **args, uint32_t *len) {
+    const char *p = *args, *start;
+
+    while (cmd_is_space(*p)) p++;
+    start = p;
+    while (*p != '\0' && *p != ',' && !cmd_is_space(*p)) p++;
+    *len = (uint32_t)(p - start);
+    while (cmd_is_space(*p)) p++;
+    if (*p == ',') p++;
+    *args = p;
+
+    return (*len > 0) ? start : NULL;
+}
+
+//*****************************************************************************
+// 英小文字を大文字にする
+//*****************************************************************************
+static char cmd_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+//*****************************************************************************
+// 空白か
+//*****************************************************************************
+static bool cmd_is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,71 @@
+//*****************************************************************************
+// ファイル名       CommandParser.h
+// 対象マイコン     RP2040
+// ファイル内容     USBコマンド解釈 (SCPI風の行単位, ノンブロッキング)
+//*****************************************************************************
+#ifndef COMMANDPARSER_H_
+#define COMMANDPARSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define CMD_RX_SIZE             256         // 受信リングバッファ (2のべき乗)
+#define CMD_LINE_SIZE           128         // 1行の最大長 (改行を除く)
+#define CMD_RESPONSE_SIZE       240         // 1行分の応答の最大長 (超えた分は切り捨て)
+
+// コマンドの種類 (表の flags)
+#define CMD_SET                 0x01        // 設定・実行 (応答なし)
+#define CMD_QUERY               0x02        // 問い合わせ ('?'付き, 応答あり)
+
+// エラー番号 (SCPIの番号を使う)
+#define CMD_ERR_SYNTAX          (-102)      // 区切りが正しくない
+#define CMD_ERR_DATA_TYPE       (-104)      // 数値・選択肢として読めない
+#define CMD_ERR_PARAM_NOT_ALLOWED (-108)    // 余分な引数
+#define CMD_ERR_MISSING_PARAM   (-109)      // 引数が足りない
+#define CMD_ERR_UNDEFINED       (-113)      // 知らないコマンド
+#define CMD_ERR_EXECUTION       (-200)      // 実行できない (書き込み失敗など)
+#define CMD_ERR_CONFLICT        (-221)      // 今の状態では実行できない
+#define CMD_ERR_RANGE           (-222)      // 範囲外
+#define CMD_ERR_TOO_LONG        (-223)      // 行が長すぎる
+#define CMD_ERR_OVERRUN         (-363)      // 受信バッファがあふれた
+
+// コマンドの処理関数 (args: ヘッダーの後ろの引数, query: '?'付きで呼ばれたか)
+typedef void (*CmdHandler)(const char *args, bool query);
+
+// コマンド表 (最後は header = NULL)
+//   header はSCPIの長短形式で書く (大文字部分が短縮形, 例 "MEASure:POTential")
+typedef struct {
+    const char *header;
+    uint8_t     flags;          // CMD_SET / CMD_QUERY
+    CmdHandler  handler;
+} CmdEntry;
+
+// 応答の送り先 (1行分をまとめて渡す, 末尾に改行は付かない)
+typedef void (*CmdRespond)(const char *text, uint32_t len);
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     cmd_init(const CmdEntry *table, CmdRespond respond);
+bool     cmd_receive(char c);
+uint32_t cmd_rx_free(void);
+bool     cmd_process(void);
+
+// 処理関数から使う
+void     cmd_reply(const char *text);
+void     cmd_reply_int(int32_t value);
+void     cmd_reply_fixed(int32_t value, uint32_t decimals);
+void     cmd_error(int code);
+bool     cmd_arg_int(const char **args, int32_t *value);
+bool     cmd_arg_fixed(const char **args, uint32_t decimals, int32_t *value);
+bool     cmd_arg_bool(const char **args, bool *value);
+bool     cmd_arg_choice(const char **args, const char *const *names, uint32_t num, uint32_t *index);
+bool     cmd_arg_end(const char *args);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,132 @@
+//*****************************************************************************
+// ファイル名       CoreQueue.c
+// 対象マイコン     RP2040
+// ファイル内容     コア間受け渡しキュー (1生産者/1消費者, ロックなし)
+//*****************************************************************************
+// サンプル : コア0のDMA割り込み → コア1の同期検波
+// 計測結果 : コア1の同期検波 → コア0のメインループ
+// 生産者は書き込み位置のみ、消費者は読み出し位置のみを更新する。
+// 位置は折り返さずに増やし続け、差分で残量を求める。
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "CoreQueue.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t            sample_queue_buff[SAMPLE_QUEUE_SIZE];   // サンプルバッファ
+volatile uint32_t   sample_queue_wr;                        // 書き込み位置 (生産者のみ更新)
+volatile uint32_t   sample_queue_rd;                        // 読み出し位置 (消費者のみ更新)
+volatile uint32_t   sample_queue_drop_count;                // 溢れて捨てたサンプル数
+DemodResult         result_queue_buff[RESULT_QUEUE_SIZE];   // 計測結果バッファ
+volatile uint32_t   result_queue_wr;                        // 書き込み位置 (コア1のみ更新)
+volatile uint32_t   result_queue_rd;                        // 読み出し位置 (コア0のみ更新)
+
+//*****************************************************************************
+// キュー初期化
+//*****************************************************************************
+void sample_queue_init(void) {
+    sample_queue_wr = 0;
+    sample_queue_rd = 0;
+    sample_queue_drop_count = 0;
+}
+
+//*****************************************************************************
+// サンプル書き込み (空きが足りなければ全て捨ててfalse)
+//*****************************************************************************
+bool sample_queue_push(const uint32_t *samples, uint32_t count) {
+    uint32_t wr = sample_queue_wr;
+    uint32_t i;
+
+    if (SAMPLE_QUEUE_SIZE - (wr - sample_queue_rd) < count) {
+        sample_queue_drop_count += count;
+        return false;
+    }
+
+    for (i = 0; i < count; i++) {
+        sample_queue_buff[(wr + i) & (SAMPLE_QUEUE_SIZE - 1)] = samples[i];
+    }
+
+    // データを書き終えてから位置を公開する
+    __mem_fence_release();
+    sample_queue_wr = wr + count;
+    return true;
+}
+
+//*****************************************************************************
+// サンプル読み出し (読み出した数を返す)
+//*****************************************************************************
+uint32_t sample_queue_pop(uint32_t *samples, uint32_t max) {
+    uint32_t rd = sample_queue_rd;
+    uint32_t count = sample_queue_wr - rd;
+    uint32_t i;
+
+    if (count > max) count = max;
+    __mem_fence_acquire();
+
+    for (i = 0; i < count; i++) {
+        samples[i] = sample_queue_buff[(rd + i) & (SAMPLE_QUEUE_SIZE - 1)];
+    }
+
+    __mem_fence_release();
+    sample_queue_rd = rd + count;
+    return count;
+}
+
+//*****************************************************************************
+// キューに溜まっているサンプル数
+//*****************************************************************************
+uint32_t sample_queue_level(void) {
+    return sample_queue_wr - sample_queue_rd;
+}
+
+//*****************************************************************************
+// 溢れて捨てたサンプル数
+//*****************************************************************************
+uint32_t sample_queue_dropped(void) {
+    return sample_queue_drop_count;
+}
+
+//*****************************************************************************
+// 計測結果キュー初期化
+//*****************************************************************************
+void result_queue_init(void) {
+    result_queue_wr = 0;
+    result_queue_rd = 0;
+}
+
+//*****************************************************************************
+// 計測結果書き込み (満杯ならfalse)
+//*****************************************************************************
+bool result_queue_push(const DemodResult *result) {
+    uint32_t wr = result_queue_wr;
+
+    if (wr - result_queue_rd >= RESULT_QUEUE_SIZE) return false;
+
+    result_queue_buff[wr & (RESULT_QUEUE_SIZE - 1)] = *result;
+    __mem_fence_release();
+    result_queue_wr = wr + 1;
+    return true;
+}
+
+//*****************************************************************************
+// 計測結果読み出し (空ならfalse)
+//*****************************************************************************
+bool result_queue_pop(DemodResult *result) {
+    uint32_t rd = result_queue_rd;
+
+    if (rd == result_queue_wr) return false;
+    __mem_fence_acquire();
+
+    *result = result_queue_buff[rd & (RESULT_QUEUE_SIZE - 1)];
+    __mem_fence_release();
+    result_queue_rd = rd + 1;
+    return true;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
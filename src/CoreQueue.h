@@ -0,0 +1,34 @@
+//*****************************************************************************
+// ファイル名       CoreQueue.h
+// 対象マイコン     RP2040
+// ファイル内容     コア間受け渡しキュー (1生産者/1消費者, ロックなし)
+//*****************************************************************************
+#ifndef COREQUEUE_H_
+#define COREQUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SyncDemod.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define SAMPLE_QUEUE_SIZE   4096        // サンプルキュー長 (2のべき乗, 25kHzで約160ms分)
+#define RESULT_QUEUE_SIZE   16          // 計測結果キュー長 (2のべき乗)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     sample_queue_init(void);
+bool     sample_queue_push(const uint32_t *samples, uint32_t count);
+uint32_t sample_queue_pop(uint32_t *samples, uint32_t max);
+uint32_t sample_queue_level(void);
+uint32_t sample_queue_dropped(void);
+void     result_queue_init(void);
+bool     result_queue_push(const DemodResult *result);
+bool     result_queue_pop(DemodResult *result);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,300 @@
+//*****************************************************************************
+// ファイル名       DataLog.c
+// 対象マイコン     RP2040
+// ファイル内容     計測値のフラッシュ記録 (循環ログ・USB読み出し)
+//*****************************************************************************
+// 記録間隔毎に表面電位の平均・温湿度・状態を1件にまとめ、RAMの1ページ分
+// (TELEMETRY_LOG_RECORDS 件) が溜まったらフラッシュへ1ページ書く (約1ms)。
+// ページはデータ領域の LOG_SECTORS セクタを順番に使い、次のセクタに入る時に
+// そのセクタ (一番古い記録) を消去する。どのセクタも同じ回数だけ消去される。
+// 消去・書き込みの間は割り込みとコア1が止まるので、ADCの取り込みも止めて
+// (hal_flash_guard) 終わってから取り直す。消去 (約50ms) は16ページに1回。
+// 途切れは呼び出し側が次の記録に TELEMETRY_LOG_FLAG_GAP を付けて残す。
+// 起動時は全ページのヘッダーを調べ、ページ番号が最大のページの次から書く。
+// 読み出しは古い順に全ページ (とRAMの書きかけ) をテレメトリの空きに合わせて送る。
+// 読み出し中はフラッシュへ書かない (消去で送信前の一番古いセクタを消さないよう)。
+// ページが埋まったら記録も読み出しの終わりまで延ばし、その分は次の1件の平均に入る。
+//=============================================================================
+//include
+//=============================================================================
+#include <string.h>
+#include "Telemetry.h"
+#include "DataLog.h"
+
+_Static_assert(TELEMETRY_LOG_PAGE_SIZE == HAL_FLASH_PAGE_SIZE, "log page must be one flash page");
+_Static_assert((LOG_FIRST_SECTOR + LOG_SECTORS) * HAL_FLASH_SECTOR_SIZE <= HAL_FLASH_DATA_SIZE,
+               "log must fit in the flash data area");
+
+//=============================================================================
+//シンボル定義(ローカル)
+//=============================================================================
+#define LOG_FRAME_SIZE  (TELEMETRY_HEADER_SIZE + TELEMETRY_LOG_SIZE + TELEMETRY_CRC_SIZE)
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint8_t     log_page[HAL_FLASH_PAGE_SIZE];  // 書きかけのページ (記録部分だけ使う)
+uint8_t     log_count;                      // 書きかけのページの記録数
+uint32_t    log_next;                       // 次に書くページ (0～LOG_PAGES-1)
+uint32_t    log_seq;                        // 次に書くページのページ番号
+uint16_t    log_boot;                       // 起動回数
+
+// 記録間隔内の平均
+int64_t     log_sum;
+uint32_t    log_sum_count;
+int8_t      log_sign;
+uint32_t    log_last_ms;
+
+// 読み出し
+bool        log_dump_active;
+uint32_t    log_dump_base;                  // 読み出し開始時の一番古いページ
+uint32_t    log_dump_pos;                   // 次に調べるページ (log_dump_baseからの順番)
+uint16_t    log_dump_index;                 // 次に送るフレームの順番
+uint16_t    log_dump_total;                 // 送るフレーム数
+bool        log_dump_ram;                   // 最後に書きかけのページを送る
+uint8_t     log_dump_page[HAL_FLASH_PAGE_SIZE]; // 送信中のページ
+bool        log_dump_half;                  // 送信中のページの後半が残っている
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static uint32_t log_offset(uint32_t page);
+static bool log_blank(uint32_t page);
+static void log_write(void);
+static void log_seal(uint8_t *page);
+static bool log_dump_next(void);
+
+//*****************************************************************************
+// ログ 初期化 (書き込み位置を探す, 書きかけで壊れたページは飛ばす。
+//              セクタに空きページが無ければ次のセクタの先頭から)
+//*****************************************************************************
+void log_init(void) {
+    TelemetryLogPage h;
+    bool found = false;
+    uint32_t i, newest = 0, newest_seq = 0;
+    uint16_t boot = 0;
+
+    for (i = 0; i < LOG_PAGES; i++) {
+        if (telemetry_check_log_page(hal_flash_data(log_offset(i)), &h) <= 0) continue;
+        if (!found || (int32_t)(h.page_seq - newest_seq) > 0) {
+            found = true;
+            newest = i;
+            newest_seq = h.page_seq;
+            boot = h.boot;
+        }
+    }
+
+    log_next = found ? (newest + 1) % LOG_PAGES : 0;
+    log_seq = found ? newest_seq + 1 : 0;
+    log_boot = found ? (uint16_t)(boot + 1) : 0;
+    while (log_next % LOG_PAGES_PER_SECTOR != 0 && !log_blank(log_next)) {
+        log_next = (log_next + 1) % LOG_PAGES;
+    }
+
+    memset(log_page, 0xff, sizeof(log_page));
+    log_count = 0;
+    log_sum = 0;
+    log_sum_count = 0;
+    log_sign = 0;
+    log_last_ms = 0;
+    log_dump_active = false;
+}
+
+//*****************************************************************************
+// 計測結果を渡す (計測毎, 記録間隔の平均に使う)
+//*****************************************************************************
+void log_result(int32_t potential_mv, int8_t sign) {
+    log_sum += potential_mv;
+    log_sum_count++;
+    log_sign = sign;
+}
+
+//*****************************************************************************
+// 記録する時刻になったか
+//*****************************************************************************
+bool log_due(uint32_t now_ms) {
+    if (log_dump_active && log_count >= TELEMETRY_LOG_RECORDS) return false;
+    return now_ms - log_last_ms >= LOG_INTERVAL_MS;
+}
+
+//*****************************************************************************
+// 1件記録 (平均を取り直す, ページが埋まったら log_process で書く)
+//*****************************************************************************
+void log_record(uint32_t now_ms, int16_t temperature, uint16_t humidity, uint8_t flags) {
+    TelemetryLogRecord r;
+
+    // 前のページが書けていなければ先に書く (読み出し中は書けないので平均を続ける)
+    if (log_count >= TELEMETRY_LOG_RECORDS) {
+        if (log_dump_active) return;
+        log_write();
+    }
+
+    r.time_ms = now_ms;
+    r.potential_mv = log_sum_count ? (int32_t)(log_sum / (int64_t)log_sum_count) : 0;
+    r.temperature = temperature;
+    r.humidity = humidity;
+    r.sign = log_sum_count ? log_sign : 0;
+    r.flags = flags;
+    if (log_sum_count == 0) r.flags |= TELEMETRY_LOG_FLAG_NO_DATA;
+
+    telemetry_pack_log_record(&log_page[TELEMETRY_LOG_HEADER_SIZE + log_count * TELEMETRY_LOG_RECORD_SIZE], &r);
+    log_count++;
+
+    log_sum = 0;
+    log_sum_count = 0;
+    log_last_ms = now_ms;
+}
+
+//*****************************************************************************
+// メインループから呼ぶ (埋まったページの書き込み・読み出しの送信)
+//*****************************************************************************
+void log_process(void) {
+    if (log_count >= TELEMETRY_LOG_RECORDS && !log_dump_active) log_write();
+
+    // テレメトリの送信リングに入るだけ送る
+    while (log_dump_active && telemetry_free() >= LOG_FRAME_SIZE) {
+        if (!log_dump_next()) log_dump_active = false;
+    }
+}
+
+//*****************************************************************************
+// 読み出し開始 (古い順に全ページ, 最後にRAMの書きかけ)
+//*****************************************************************************
+void log_dump_start(void) {
+    uint8_t payload[TELEMETRY_LOG_SIZE];
+
+    log_dump_base = log_next;
+    log_dump_pos = 0;
+    log_dump_index = 0;
+    log_dump_half = false;
+    log_dump_ram = log_count > 0;
+    log_dump_total = (uint16_t)(2 * (log_pages() + (log_dump_ram ? 1 : 0)));
+
+    if (log_dump_total == 0) {
+        // 空: 順番0・フレーム数0を1つだけ送る
+        telemetry_put_u16(&payload[0], 0);
+        telemetry_put_u16(&payload[2], 0);
+        telemetry_send(TELEMETRY_TYPE_LOG, payload, 4);
+        log_dump_active = false;
+        return;
+    }
+    log_dump_active = true;
+}
+
+//*****************************************************************************
+// 読み出し中か
+//*****************************************************************************
+bool log_dumping(void) {
+    return log_dump_active;
+}
+
+//*****************************************************************************
+// フラッシュに書いたページ数
+//*****************************************************************************
+uint32_t log_pages(void) {
+    TelemetryLogPage h;
+    uint32_t i, count = 0;
+
+    for (i = 0; i < LOG_PAGES; i++) {
+        if (telemetry_check_log_page(hal_flash_data(log_offset(i)), &h) > 0) count++;
+    }
+    return count;
+}
+
+//=============================================================================
+// ローカル関数
+//=============================================================================
+//*****************************************************************************
+// ページのフラッシュデータ領域内の位置
+//*****************************************************************************
+static uint32_t log_offset(uint32_t page) {
+    return LOG_FIRST_SECTOR * HAL_FLASH_SECTOR_SIZE + page * HAL_FLASH_PAGE_SIZE;
+}
+
+//*****************************************************************************
+// ページが消去済みか
+//*****************************************************************************
+static bool log_blank(uint32_t page) {
+    const uint8_t *p = hal_flash_data(log_offset(page));
+    uint32_t i;
+
+    for (i = 0; i < HAL_FLASH_PAGE_SIZE; i++) {
+        if (p[i] != 0xff) return false;
+    }
+    return true;
+}
+
+//*****************************************************************************
+// 書きかけのページをフラッシュへ書く (セクタの先頭なら先に消去)
+//*****************************************************************************
+static void log_write(void) {
+    if (log_count == 0) return;
+
+    if (log_next % LOG_PAGES_PER_SECTOR == 0) {
+        hal_flash_erase(log_offset(log_next), HAL_FLASH_SECTOR_SIZE);
+    }
+    log_seal(log_page);
+    hal_flash_program(log_offset(log_next), log_page, HAL_FLASH_PAGE_SIZE);
+
+    log_next = (log_next + 1) % LOG_PAGES;
+    log_seq++;
+    memset(log_page, 0xff, sizeof(log_page));
+    log_count = 0;
+}
+
+//*****************************************************************************
+// ページのヘッダーを書く (書きかけのページ番号・記録数で)
+//*****************************************************************************
+static void log_seal(uint8_t *page) {
+    TelemetryLogPage h;
+
+    h.magic = TELEMETRY_LOG_MAGIC;
+    h.page_seq = log_seq;
+    h.boot = log_boot;
+    h.count = log_count;
+    h.version = TELEMETRY_LOG_VERSION;
+    telemetry_seal_log_page(page, &h);
+}
+
+//*****************************************************************************
+// 読み出しのフレームを1つ送る (送り終わったらfalse)
+//*****************************************************************************
+static bool log_dump_next(void) {
+    TelemetryLogPage h;
+    uint8_t payload[TELEMETRY_LOG_SIZE];
+    uint32_t page;
+
+    if (!log_dump_half) {
+        // 次の有効なページを探す (古い順 = 次に書く位置から一周)
+        for (;;) {
+            if (log_dump_pos < LOG_PAGES) {
+                page = (log_dump_base + log_dump_pos++) % LOG_PAGES;
+                if (telemetry_check_log_page(hal_flash_data(log_offset(page)), &h) <= 0) continue;
+                memcpy(log_dump_page, hal_flash_data(log_offset(page)), HAL_FLASH_PAGE_SIZE);
+                break;
+            }
+            if (log_dump_ram) {
+                // 読み出し中は書かないので、書きかけは開始時より記録が増えているだけ
+                log_dump_ram = false;
+                memcpy(log_dump_page, log_page, HAL_FLASH_PAGE_SIZE);
+                log_seal(log_dump_page);
+                break;
+            }
+            return false;
+        }
+    }
+
+    if (log_dump_index >= log_dump_total) return false;
+    telemetry_put_u16(&payload[0], log_dump_index);
+    telemetry_put_u16(&payload[2], log_dump_total);
+    memcpy(&payload[4], &log_dump_page[log_dump_half ? TELEMETRY_LOG_CHUNK_SIZE : 0], TELEMETRY_LOG_CHUNK_SIZE);
+    telemetry_send(TELEMETRY_TYPE_LOG, payload, TELEMETRY_LOG_SIZE);
+
+    log_dump_index++;
+    log_dump_half = !log_dump_half;
+    return log_dump_index < log_dump_total;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
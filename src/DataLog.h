@@ -0,0 +1,38 @@
+//*****************************************************************************
+// ファイル名       DataLog.h
+// 対象マイコン     RP2040
+// ファイル内容     計測値のフラッシュ記録 (循環ログ・USB読み出し)
+//*****************************************************************************
+#ifndef DATALOG_H_
+#define DATALOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Hal.h"
+#include "TelemetryProtocol.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define LOG_INTERVAL_MS         1000        // 記録間隔 [ms] (間の計測結果は平均する)
+#define LOG_FIRST_SECTOR        1           // フラッシュデータ領域で使う最初のセクタ (0は校正)
+#define LOG_SECTORS             15          // 使うセクタ数 (順番に消去して一周する)
+#define LOG_PAGES_PER_SECTOR    (HAL_FLASH_SECTOR_SIZE / HAL_FLASH_PAGE_SIZE)
+#define LOG_PAGES               (LOG_SECTORS * LOG_PAGES_PER_SECTOR)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     log_init(void);
+void     log_result(int32_t potential_mv, int8_t sign);
+bool     log_due(uint32_t now_ms);
+void     log_record(uint32_t now_ms, int16_t temperature, uint16_t humidity, uint8_t flags);
+void     log_process(void);
+void     log_dump_start(void);
+bool     log_dumping(void);
+uint32_t log_pages(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
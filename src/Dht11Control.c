@@ -0,0 +1,184 @@
+//*****************************************************************************
+// ファイル名       Dht11Control.c
+// 対象マイコン     RP2040
+// ファイル内容     DHT11温湿度センサー 非同期読み取りライブラリ
+//*****************************************************************************
+// 開始信号の送出は1ms周期のdht11_process、受信は立ち下がりエッジ割り込みで
+// 時刻を記録するだけとし、呼び出し側を待たせない。
+// 立ち下がり間隔 : 応答 約160us、ビット0 約78us、ビット1 約120us
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "Dht11Control.h"
+#include "Diagnostics.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+unsigned int        dht11_pin;                          // データピン
+int                 dht11_mode;                         // 処理状態
+uint32_t            dht11_timer;                        // 状態内の経過時間 [ms]
+uint32_t            dht11_interval;                     // 読み取り間隔 [ms]
+uint32_t            dht11_edge_time[DHT11_EDGE_COUNT];  // 立ち下がり時刻 [us]
+volatile uint32_t   dht11_edge_count;                   // 受信した立ち下がり数
+Dht11Data           dht11_result;                       // 公開する読み取り結果
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void dht11_irq_handler(void);
+static void dht11_decode(void);
+static void dht11_publish(uint8_t status, const uint8_t *data);
+
+//*****************************************************************************
+// DHT11 初期化
+//*****************************************************************************
+void dht11_init(unsigned int pin) {
+    dht11_pin = pin;
+    dht11_mode = 0;
+    dht11_timer = 0;
+    dht11_interval = DHT11_READ_INTERVAL_MS;
+    dht11_edge_count = 0;
+    dht11_result.temperature = 0;
+    dht11_result.humidity = 0;
+    dht11_result.status = DHT11_ERR_TIMEOUT;
+    dht11_result.timestamp_ms = 0;
+    dht11_result.seq = 0;
+
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_OUT);    // 初期状態は出力
+    gpio_put(pin, 1);               // HIGHに設定
+
+    gpio_add_raw_irq_handler(pin, dht11_irq_handler);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+//*****************************************************************************
+// 読み取り間隔設定
+//*****************************************************************************
+void dht11_set_interval(uint32_t interval_ms) {
+    if (interval_ms < DHT11_MIN_INTERVAL_MS) interval_ms = DHT11_MIN_INTERVAL_MS;
+    dht11_interval = interval_ms;
+}
+
+//*****************************************************************************
+// 読み取り結果取得 (last_seq以降に更新されていればtrue)
+//*****************************************************************************
+bool dht11_get(Dht11Data *data, uint32_t last_seq) {
+    uint32_t save = save_and_disable_interrupts();
+
+    *data = dht11_result;
+    restore_interrupts(save);
+
+    return data->seq != last_seq;
+}
+
+//*****************************************************************************
+// DHT11制御 (タイマ割り込みで1ms間隔で実行)
+//*****************************************************************************
+void dht11_process(void) {
+    dht11_timer++;
+
+    switch (dht11_mode) {
+        case 0: // 読み取り間隔待ち
+            if (dht11_timer >= dht11_interval) {
+                gpio_set_dir(dht11_pin, GPIO_OUT);
+                gpio_put(dht11_pin, 0);     // 開始信号 LOW
+                dht11_timer = 0;
+                dht11_mode = 1;
+            }
+            break;
+
+        case 1: // 開始信号送出中
+            if (dht11_timer >= DHT11_START_LOW_MS) {
+                dht11_edge_count = 0;
+                gpio_put(dht11_pin, 1);
+                gpio_set_dir(dht11_pin, GPIO_IN); // 解放してセンサーの応答を待つ
+                gpio_acknowledge_irq(dht11_pin, GPIO_IRQ_EDGE_FALL);
+                gpio_set_irq_enabled(dht11_pin, GPIO_IRQ_EDGE_FALL, true);
+                dht11_timer = 0;
+                dht11_mode = 2;
+            }
+            break;
+
+        case 2: // 受信中
+            if (dht11_edge_count >= DHT11_EDGE_COUNT) {
+                dht11_decode();
+            } else if (dht11_timer >= DHT11_TIMEOUT_MS) {
+                dht11_publish(DHT11_ERR_TIMEOUT, NULL);
+            } else {
+                break;
+            }
+            gpio_set_irq_enabled(dht11_pin, GPIO_IRQ_EDGE_FALL, false);
+            gpio_set_dir(dht11_pin, GPIO_OUT);
+            gpio_put(dht11_pin, 1);
+            dht11_timer = 0;
+            dht11_mode = 0;
+            break;
+
+        default:
+            dht11_mode = 0;
+            break;
+    }
+}
+
+//*****************************************************************************
+// 立ち下がりエッジ割り込み処理 (時刻の記録のみ)
+//*****************************************************************************
+static void dht11_irq_handler(void) {
+    uint32_t now = time_us_32();
+    uint32_t events = gpio_get_irq_event_mask(dht11_pin);
+
+    if (!(events & GPIO_IRQ_EDGE_FALL)) return;
+    uint32_t diag = diag_isr_enter();
+    gpio_acknowledge_irq(dht11_pin, GPIO_IRQ_EDGE_FALL);
+
+    if (dht11_edge_count < DHT11_EDGE_COUNT) {
+        dht11_edge_time[dht11_edge_count] = now;
+        dht11_edge_count++;
+    }
+    diag_isr_exit(DIAG_ISR_GPIO, diag);
+}
+
+//*****************************************************************************
+// 立ち下がり間隔から40ビットのデータを復元
+//*****************************************************************************
+static void dht11_decode(void) {
+    uint8_t data[5] = {0}; // DHT11は40ビットのデータ (5バイト) を送信
+    int i;
+
+    // 最初の2回は応答信号、以降の間隔が各ビットのHIGH時間を含む
+    for (i = 0; i < 40; i++) {
+        if (dht11_edge_time[i + 2] - dht11_edge_time[i + 1] >= DHT11_BIT_THRESHOLD_US) {
+            data[i / 8] |= (0x80 >> (i % 8)); // 長ければ1
+        }
+    }
+
+    // チェックサム検証
+    if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        dht11_publish(DHT11_OK, data);
+    } else {
+        dht11_publish(DHT11_ERR_CHECKSUM, NULL);
+    }
+}
+
+//*****************************************************************************
+// 読み取り結果を公開
+//*****************************************************************************
+static void dht11_publish(uint8_t status, const uint8_t *data) {
+    if (data) {
+        dht11_result.humidity = data[0] * 10 + data[1];     // 湿度 (小数点対応)
+        dht11_result.temperature = data[2] * 10 + data[3];  // 温度 (小数点対応)
+    }
+    dht11_result.status = status;
+    dht11_result.timestamp_ms = to_ms_since_boot(get_absolute_time());
+    dht11_result.seq++;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,46 @@
+//*****************************************************************************
+// ファイル名       Dht11Control.h
+// 対象マイコン     RP2040
+// ファイル内容     DHT11温湿度センサー 非同期読み取りライブラリ
+//*****************************************************************************
+#ifndef DHT11CONTROL_H_
+#define DHT11CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define DHT11_READ_INTERVAL_MS  2000    // 読み取り間隔の初期値 [ms]
+#define DHT11_MIN_INTERVAL_MS   1000    // 読み取り間隔の下限 [ms] (センサー仕様)
+#define DHT11_START_LOW_MS      20      // 開始信号のLOW時間 [ms]
+#define DHT11_TIMEOUT_MS        10      // 開始信号解除から受信完了までの制限時間 [ms]
+#define DHT11_BIT_THRESHOLD_US  100     // 立ち下がり間隔がこれ以上ならビット1 [us]
+#define DHT11_EDGE_COUNT        42      // 応答2回 + データ40ビット分の立ち下がり
+
+// 読み取り結果
+#define DHT11_OK                0       // 正常
+#define DHT11_ERR_TIMEOUT       1       // 応答なし・途中で途切れた
+#define DHT11_ERR_CHECKSUM      2       // チェックサム不一致
+
+typedef struct {
+    int16_t  temperature;       // 温度 [0.1℃] (最後に正常に読めた値)
+    uint16_t humidity;          // 湿度 [0.1%RH] (最後に正常に読めた値)
+    uint8_t  status;            // 直近の読み取り結果
+    uint32_t timestamp_ms;      // 直近の読み取り時刻 [ms]
+    uint32_t seq;               // 読み取り回数 (結果が更新される毎に+1)
+} Dht11Data;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void dht11_init(unsigned int pin);
+void dht11_process(void);
+void dht11_set_interval(uint32_t interval_ms);
+bool dht11_get(Dht11Data *data, uint32_t last_seq);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,212 @@
+//*****************************************************************************
+// ファイル名       Diagnostics.c
+// 対象マイコン     RP2040
+// ファイル内容     動作状況の常時計測 (割り込み負荷・タイマー遅れ・アイドル率)
+//*****************************************************************************
+// 割り込みの入口・出口でSysTick (CPUクロック) を読み、処理時間を積算する。
+// 多重割り込みでは外側の処理時間に内側の分も含まれるが、アイドル率の計算では
+// 一番外側の分だけを数える。
+// 積算値は起動からの累計で持ち、1秒毎に1msタイマー割り込みの中で前回との差から
+// 率・最大値を求める (メインループ側は加算するだけでリセットしない)。
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "Hal.h"
+#include "Diagnostics.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t            diag_cycles_per_us;                 // SysTickの1usあたりカウント
+volatile uint32_t   diag_isr_depth;                     // 割り込みの入れ子の深さ
+volatile uint32_t   diag_isr_busy;                      // 割り込み処理時間の累計 (外側のみ)
+volatile uint32_t   diag_isr_count[DIAG_ISR_NUM];       // 割り込み回数
+volatile uint32_t   diag_isr_cycles[DIAG_ISR_NUM];      // 割り込み処理時間の累計
+volatile uint32_t   diag_isr_max[DIAG_ISR_NUM];         // 区間内の最大処理時間
+volatile uint32_t   diag_adc_overrun_count;
+volatile uint32_t   diag_adc_error_count;
+volatile uint32_t   diag_adc_late_count;
+volatile uint32_t   diag_timer_late[DIAG_LATE_BINS];
+volatile uint32_t   diag_timer_late_max;                // 区間内の最大遅れ [us]
+uint32_t            diag_timer_expected;                // 次のタイマー割り込みの予定時刻 [us]
+uint32_t            diag_timer_ticks;                   // 区間内のタイマー割り込み回数
+volatile uint32_t   diag_queue_max;                     // 区間内のキュー最大使用量
+volatile uint32_t   diag_loop_count;                    // メインループ回数 (メインループのみ更新)
+volatile uint32_t   diag_idle_cycles;                   // アイドル時間の累計 (メインループのみ更新)
+uint32_t            diag_idle_busy;                     // アイドル開始時の割り込み処理時間累計
+
+// 区間の始まりの累計値
+uint32_t            diag_prev_isr_cycles[DIAG_ISR_NUM];
+uint32_t            diag_prev_loop;
+uint32_t            diag_prev_idle;
+uint32_t            diag_prev_time;
+
+DiagSnapshot        diag_snapshot;                      // 直近の区間の結果
+
+//*****************************************************************************
+// 初期化
+//*****************************************************************************
+void diag_init(void) {
+    int i;
+
+    hal_cycle_init();
+    diag_cycles_per_us = hal_cycle_hz() / 1000000;
+
+    diag_isr_depth = 0;
+    diag_isr_busy = 0;
+    for (i = 0; i < DIAG_ISR_NUM; i++) {
+        diag_isr_count[i] = 0;
+        diag_isr_cycles[i] = 0;
+        diag_isr_max[i] = 0;
+        diag_prev_isr_cycles[i] = 0;
+    }
+    for (i = 0; i < DIAG_LATE_BINS; i++) diag_timer_late[i] = 0;
+    diag_adc_overrun_count = 0;
+    diag_adc_error_count = 0;
+    diag_adc_late_count = 0;
+    diag_timer_late_max = 0;
+    diag_timer_ticks = 0;
+    diag_timer_expected = 0;
+    diag_queue_max = 0;
+    diag_loop_count = 0;
+    diag_idle_cycles = 0;
+    diag_prev_loop = 0;
+    diag_prev_idle = 0;
+    diag_prev_time = time_us_32();
+    diag_snapshot.seq = 0;
+}
+
+//*****************************************************************************
+// 割り込み処理の入口・出口 (コア0の割り込みの先頭と最後で呼ぶ)
+//*****************************************************************************
+uint32_t diag_isr_enter(void) {
+    diag_isr_depth++;
+    return hal_cycle_count();
+}
+
+void diag_isr_exit(int isr, uint32_t start) {
+    uint32_t t = hal_cycle_elapsed(start);
+
+    diag_isr_count[isr]++;
+    diag_isr_cycles[isr] += t;
+    if (t > diag_isr_max[isr]) diag_isr_max[isr] = t;
+    if (--diag_isr_depth == 0) diag_isr_busy += t;
+}
+
+//*****************************************************************************
+// 1msタイマー割り込み (遅れの記録と1秒毎の集計)
+//*****************************************************************************
+void diag_timer_tick(void) {
+    static const uint32_t limits[DIAG_LATE_BINS - 1] = DIAG_LATE_LIMITS;
+    uint32_t now = time_us_32();
+    uint32_t late, elapsed, i;
+    DiagSnapshot *d = &diag_snapshot;
+
+    // 予定時刻からの遅れ (初回と大きく外れた時は予定を取り直す)
+    late = now - diag_timer_expected;
+    if (diag_timer_expected == 0 || late > 100000) {
+        diag_timer_expected = now;
+        late = 0;
+    }
+    diag_timer_expected += 1000;
+
+    for (i = 0; i < DIAG_LATE_BINS - 1 && late >= limits[i]; i++) ;
+    diag_timer_late[i]++;
+    if (late > diag_timer_late_max) diag_timer_late_max = late;
+
+    if (++diag_timer_ticks < DIAG_WINDOW_MS) return;
+    diag_timer_ticks = 0;
+
+    // === 区間の集計 ===
+    elapsed = now - diag_prev_time;
+    diag_prev_time = now;
+    if (elapsed == 0) elapsed = 1;
+
+    for (i = 0; i < DIAG_ISR_NUM; i++) {
+        uint32_t cycles = diag_isr_cycles[i];
+        d->isr_count[i] = diag_isr_count[i];
+        d->isr_max_us[i] = (uint16_t)(diag_isr_max[i] / diag_cycles_per_us);
+        d->isr_load[i] = (uint16_t)((uint64_t)(cycles - diag_prev_isr_cycles[i]) * 1000
+                                    / ((uint64_t)elapsed * diag_cycles_per_us));
+        diag_prev_isr_cycles[i] = cycles;
+        diag_isr_max[i] = 0;
+    }
+    for (i = 0; i < DIAG_LATE_BINS; i++) d->timer_late[i] = diag_timer_late[i];
+    d->timer_late_max_us = (uint16_t)(diag_timer_late_max > 0xffff ? 0xffff : diag_timer_late_max);
+    diag_timer_late_max = 0;
+
+    d->adc_overrun = diag_adc_overrun_count;
+    d->adc_error = diag_adc_error_count;
+    d->adc_late = diag_adc_late_count;
+
+    d->loop_rate = (uint32_t)((uint64_t)(diag_loop_count - diag_prev_loop) * 1000000 / elapsed);
+    diag_prev_loop = diag_loop_count;
+    d->idle = (uint16_t)((uint64_t)(diag_idle_cycles - diag_prev_idle) * 1000
+                         / ((uint64_t)elapsed * diag_cycles_per_us));
+    diag_prev_idle = diag_idle_cycles;
+
+    d->sample_queue_max = (uint16_t)diag_queue_max;
+    diag_queue_max = 0;
+
+    d->seq++;
+}
+
+//*****************************************************************************
+// ADCの異常 (DMA割り込みから呼ぶ)
+//*****************************************************************************
+void diag_adc_overrun(void) {
+    diag_adc_overrun_count++;
+}
+
+void diag_adc_error(uint32_t count) {
+    diag_adc_error_count += count;
+}
+
+void diag_adc_late(void) {
+    diag_adc_late_count++;
+}
+
+//*****************************************************************************
+// キュー使用量 (最大値を記録)
+//*****************************************************************************
+void diag_queue_level(uint32_t level) {
+    if (level > diag_queue_max) diag_queue_max = level;
+}
+
+//*****************************************************************************
+// メインループ (1周毎に呼ぶ)
+//*****************************************************************************
+void diag_loop(void) {
+    diag_loop_count++;
+}
+
+//*****************************************************************************
+// アイドル区間 (__wfe()の前後で呼ぶ, 起こした割り込みの処理時間は除く)
+//*****************************************************************************
+uint32_t diag_idle_enter(void) {
+    diag_idle_busy = diag_isr_busy;
+    return hal_cycle_count();
+}
+
+void diag_idle_exit(uint32_t start) {
+    uint32_t t = hal_cycle_elapsed(start);
+    uint32_t busy = diag_isr_busy - diag_idle_busy;
+
+    if (t > busy) diag_idle_cycles += t - busy;
+}
+
+//*****************************************************************************
+// 直近の計測結果を取得
+//*****************************************************************************
+void diag_get(DiagSnapshot *d) {
+    uint32_t status = save_and_disable_interrupts();
+
+    *d = diag_snapshot;
+    restore_interrupts(status);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,64 @@
+//*****************************************************************************
+// ファイル名       Diagnostics.h
+// 対象マイコン     RP2040
+// ファイル内容     動作状況の常時計測 (割り込み負荷・タイマー遅れ・アイドル率)
+//*****************************************************************************
+#ifndef DIAGNOSTICS_H_
+#define DIAGNOSTICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+// 計測する割り込み (コア0)
+#define DIAG_ISR_TIMER          0       // 1msタイマー
+#define DIAG_ISR_ADC            1       // ADC DMAブロック完了
+#define DIAG_ISR_GPIO           2       // GPIOエッジ (DHT11)
+#define DIAG_ISR_NUM            3
+
+// タイマー遅れのヒストグラム区切り [us] (最後の区間はそれ以上)
+#define DIAG_LATE_BINS          6
+#define DIAG_LATE_LIMITS        {10, 50, 100, 250, 1000}
+
+#define DIAG_WINDOW_MS          1000    // 率・最大値を求める区間 [ms]
+
+//=============================================================================
+// 計測結果 (率・最大値は直近の区間, 回数は起動からの累計)
+//=============================================================================
+typedef struct {
+    uint32_t seq;                               // 区間の更新回数
+    uint32_t isr_count[DIAG_ISR_NUM];           // 割り込み回数
+    uint16_t isr_max_us[DIAG_ISR_NUM];          // 割り込み処理時間の最大 [us]
+    uint16_t isr_load[DIAG_ISR_NUM];            // 割り込み処理の占有率 [0.1%]
+    uint32_t adc_overrun;                       // ADC FIFOの溢れ
+    uint32_t adc_error;                         // ADC変換エラー (サンプル数)
+    uint32_t adc_late;                          // 割り込みが間に合わず2ブロック溜まった回数
+    uint32_t timer_late[DIAG_LATE_BINS];        // 1msタイマーの遅れのヒストグラム
+    uint16_t timer_late_max_us;                 // 1msタイマーの遅れの最大 [us]
+    uint16_t idle;                              // コア0のアイドル率 [0.1%]
+    uint32_t loop_rate;                         // メインループの回転数 [回/s]
+    uint16_t sample_queue_max;                  // コア1へのサンプルキューの最大使用量
+} DiagSnapshot;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     diag_init(void);
+uint32_t diag_isr_enter(void);
+void     diag_isr_exit(int isr, uint32_t start);
+void     diag_timer_tick(void);
+void     diag_adc_overrun(void);
+void     diag_adc_error(uint32_t count);
+void     diag_adc_late(void);
+void     diag_queue_level(uint32_t level);
+void     diag_loop(void);
+uint32_t diag_idle_enter(void);
+void     diag_idle_exit(uint32_t start);
+void     diag_get(DiagSnapshot *d);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
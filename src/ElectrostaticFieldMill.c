@@ -6,19 +6,31 @@
 //=============================================================================
 //include
 //=============================================================================
-#include <stdio.h>
-#include <math.h>
 #include <stdlib.h>
 #include "pico/stdlib.h"
-#include "pico/float.h"
 #include "hardware/gpio.h"
 #include "hardware/adc.h"
 #include "hardware/dma.h"
 #include "pico/multicore.h"
-#include "hardware/pwm.h"
 #include "LcdControl.h"
 #include "SwitchControl.h"
 #include "BuzzerControl.h"
+#include "AdcControl.h"
+#include "ShutterControl.h"
+#include "SyncDemod.h"
+#include "CoreQueue.h"
+#include "Dht11Control.h"
+#include "Telemetry.h"
+#include "RawCapture.h"
+#include "Diagnostics.h"
+#include "MotorControl.h"
+#include "Calibration.h"
+#include "DataLog.h"
+#include "TriggerCapture.h"
+#include "Statistics.h"
+#include "CommandParser.h"
+#include "CommandHandlers.h"
+#include "Hal.h"
 
 //=============================================================================
 // マクロ定義
@@ -45,39 +57,25 @@
 #define ADC_PIN             26   // ADC入力ピン (GPIO26)
 
 // 定数の定義
-#define ADC_MID_VALUE       2048  // ADCの中間値 (12ビット)
-#define SHUTTER_CYCLE_THRESHOLD 10  // シャッター回転数の閾値
-#define POTENTIAL_CONVERSION_FACTOR 0.01028f  // 表面電位変換係数 [kV/ADC値]
-#define ADC_CLOCK_FREQ      48000000  // ADCクロック周波数 (48MHz)
-#define ADC_SAMPLE_FREQ_HZ  25000  // ADCサンプリング周波数 (25kHz)
 #define PWM_CLOCK_FREQ      125000000  // PWMクロック周波数 (125MHz)
 #define PWM_FREQ_HZ         20000  // PWM周波数 (20kHz)
 #define PWM_WRAP_VALUE      ((PWM_CLOCK_FREQ / PWM_FREQ_HZ) - 1)  // PWMラップ値
 #define STARTUP_DELAY_MS    1000  // 起動時の待機時間 (ms)
 #define BEEP_PATTERN_START  0xA   // 起動時のビープパターン
-
-//=============================================================================
-// 表面電位計測用構造体定義
-//=============================================================================
-typedef struct {
-    uint32_t shutter_count;    // シャッター回転数
-    uint32_t sample_count;     // サンプル数
-    int64_t sync_value;        // 同期検波値
-    int64_t positive_sum;      // 正側合計
-    int64_t negative_sum;      // 負側合計
-    bool prev_shutter_state;   // 前回のシャッター状態
-} SyncDemodState;
+#define DEMOD_CHUNK_SAMPLES 256   // コア1が一度に取り出すサンプル数
 
 //=============================================================================
 // グローバル変数
 //=============================================================================
-SyncDemodState demod_state = {0, 0, 0, 0, 0, false};
-int32_t adc_average = 0;         // ADC平均値
+SyncDemodState demod_state;     // 同期検波状態 (コア1のみ使用)
+int32_t adc_average = 0;         // ADC平均値 (位相補償済み同相成分, Q8)
 int16_t surface_potential_sign = 0; // 表面電位の符号 (1:正, -1:負)
-float surface_potential_kv = 0.0f;  // 表面電位 [kV]
-uint pwm_slice_num;              // PWMスライス番号
-float temperature = 0.0f;        // 温度 [℃]
-float humidity = 0.0f;           // 湿度 [%RH]
+int32_t surface_potential_mv = 0; // 表面電位 [mV]
+Dht11Data dht11_data;            // DHT11の最新読み取り結果 (温度・湿度は0.1単位)
+volatile bool demod_adaptive = true; // 適応窓を使うか (コア0で切り替え, コア1が反映)
+volatile uint32_t demod_fixed_window = SHUTTER_CYCLE_THRESHOLD; // 固定窓の長さ (コア0で設定, コア1が反映)
+bool stream_enabled = true;      // 計測結果をテレメトリで送るか
+uint32_t demod_window = 0;       // 最新結果の窓の長さ (半周期数)
 
 //=============================================================================
 // 関数プロトタイプ宣言
@@ -85,9 +83,27 @@ float humidity = 0.0f;           // 湿度 [%RH]
 bool timer_callback(repeating_timer_t *rt);
 void init_rp2040(void);
 void core1_main(void);
-void display_process(void);
-static void adc_irq_handler(void);
-bool read_dht11(float *temp, float *hum);
+void display_process(bool update);
+void send_measurement(const DemodResult *result);
+void send_diagnostics(void);
+void log_measurement(uint32_t now_ms);
+static void adc_block_handler(const uint32_t *samples, uint32_t count);
+
+//=============================================================================
+// USBコマンドから参照・変更する状態 (処理関数は CommandHandlers.c)
+//=============================================================================
+static const CmdContext command_context = {
+    .potential_mv     = &surface_potential_mv,
+    .sign             = &surface_potential_sign,
+    .average          = &adc_average,
+    .window           = &demod_window,
+    .dht11            = &dht11_data,
+    .adaptive         = &demod_adaptive,
+    .fixed_window     = &demod_fixed_window,
+    .stream_enabled   = &stream_enabled,
+    .pwm_wrap         = PWM_WRAP_VALUE,
+    .send_diagnostics = send_diagnostics,
+};
 
 //*****************************************************************************
 // コア0: メイン処理
@@ -105,28 +121,103 @@ int main(void) {
     set_beep_pattern(BEEP_PATTERN_START);
     sleep_ms(STARTUP_DELAY_MS);
 
-    // メインループ
+    // メインループ (割り込みかコア1からのイベントで起きて、変化があった時だけ描画)
+    bool update = true; // 初回は必ず描画
     while (true) {
-        // 表面電位を計算 (kV単位)
-        surface_potential_kv = fabsf(adc_average) * POTENTIAL_CONVERSION_FACTOR;
-
-        // DHT11から温湿度を取得 (2秒ごとに更新)
-        static uint64_t last_dht11_read = 0;
-        if (time_us_64() - last_dht11_read >= 2000000) { // 2秒間隔
-            read_dht11(&temperature, &humidity);
-            last_dht11_read = time_us_64();
+
+        // コア1から届いた計測結果を反映
+        DemodResult result;
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        while (result_queue_pop(&result)) {
+            adc_average = result.average;
+
+            // 表面電位を計算 (mV単位, 符号付き, シャッター速度の変動は基準周波数への換算で除く)
+            // 温湿度補正をかけてから校正テーブルで変換する (校正点も補正後の値で取る)
+            int32_t compensated = cal_compensate(result.normalized, now_ms);
+            surface_potential_mv = cal_convert(compensated);
+            cal_feed(compensated); // 校正手順中は平均に使う
+            log_result(surface_potential_mv, (int8_t)result.sign);
+            trig_process(surface_potential_mv, result.timestamp_us, result.gap);
+            if (!result.gap) stats_add(surface_potential_mv); // 途切れの直後の結果は統計に入れない
+
+            // 極性LED制御 (不感帯付きの判定結果)
+            surface_potential_sign = result.sign;
+            demod_window = result.shutter_count;
+            gpio_put(LED_RED_PIN, surface_potential_sign > 0);  // 赤LED
+            gpio_put(LED_BLUE_PIN, surface_potential_sign < 0); // 青LED
+            update = true;
+
+            if (stream_enabled) send_measurement(&result);
+        }
+
+        // DHT11の温湿度を反映 (読み取りはバックグラウンドで実行)
+        if (dht11_get(&dht11_data, dht11_data.seq)) {
+            if (dht11_data.status == DHT11_OK) {
+                cal_comp_sensor(dht11_data.temperature, dht11_data.humidity, dht11_data.timestamp_ms);
+            }
+            update = true;
         }
 
-        display_process();
+        // 統計は1秒毎に移動区間・リセット後の結果を求め直す
+        stats_tick(now_ms);
+
+        // 記録間隔毎にログへ1件 (ページが埋まったら log_process で書く)
+        if (log_due(now_ms)) {
+            log_measurement(now_ms);
+        }
+
+        // USBからのコマンド (届いた分を受信リングへ移し、応答を送る空きがあれば1行実行)
+        int c;
+        while (cmd_rx_free() > 0 && (c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+            cmd_receive((char)c);
+        }
+        if (telemetry_free() >= TELEMETRY_MAX_FRAME && cmd_process()) {
+            update = true; // 設定が変わったかもしれない
+        }
+
+        display_process(update);
+        update = false;
+        raw_capture_process();  // キャプチャ中なら生サンプルをフレームにする
+        log_process();          // ログのページ書き込み・読み出し中ならフレームにする
+        trig_dump_process();    // 波形の読み出し中ならフレームにする
+        telemetry_process();    // USBへ送れる分だけ送る (ブロックしない)
+
+        // 次のイベントまで待つ (待っていた時間をアイドルとして計測)
+        diag_loop();
+        uint32_t idle = diag_idle_enter();
+        __wfe();
+        diag_idle_exit(idle);
     }
 }
 
 //*****************************************************************************
-// コア1: サブ処理 (未実装)
+// コア1: 同期検波処理
 //*****************************************************************************
 void core1_main(void) {
+    static uint32_t samples[DEMOD_CHUNK_SAMPLES];
+    DemodResult result;
+    uint32_t count, pos, used;
+
+    sync_demod_init(&demod_state);
+    multicore_lockout_victim_init(); // 校正のフラッシュ書き込み中は止まる
+
     while (true) {
-        // 必要に応じて実装
+        sync_demod_set_adaptive(&demod_state, demod_adaptive);
+        sync_demod_set_window(&demod_state, demod_fixed_window);
+
+        count = sample_queue_pop(samples, DEMOD_CHUNK_SAMPLES);
+        if (count == 0) {
+            __wfe(); // DMA割り込みからの__sev()を待つ
+            continue;
+        }
+
+        for (pos = 0; pos < count; pos += used) {
+            if (sync_demod_process(&demod_state, &samples[pos], count - pos, &used, &result)) {
+                result.timestamp_us = time_us_32();
+                result_queue_push(&result); // 満杯ならコア0が追いつくまで捨てる
+                __sev();                    // コア0のメインループを起こす
+            }
+        }
     }
 }
 
@@ -135,6 +226,14 @@ void core1_main(void) {
 //*****************************************************************************
 void init_rp2040(void) {
     stdio_init_all(); // USBシリアル初期化
+    diag_init();      // 割り込みより先に計測を準備
+    telemetry_init();
+    raw_capture_init();
+    cal_init();       // 校正テーブルをフラッシュから読み込み
+    log_init();       // ログの書き込み位置を探す (ADC開始前に)
+    trig_init();
+    stats_init();
+    cmd_handlers_init(&command_context);
 
     // === GPIO設定 ===
     const uint lcd_pins[] = {LCD_PIN_D4, LCD_PIN_D5, LCD_PIN_D6, LCD_PIN_D7, LCD_PIN_E, LCD_PIN_RS};
@@ -159,9 +258,7 @@ void init_rp2040(void) {
     gpio_init(LED_BLUE_PIN);
     gpio_set_dir(LED_BLUE_PIN, GPIO_OUT);
 
-    gpio_init(DHT11_PIN);           // DHT11ピンの初期化
-    gpio_set_dir(DHT11_PIN, GPIO_OUT); // 初期状態は出力
-    gpio_put(DHT11_PIN, 1);         // HIGHに設定
+    dht11_init(DHT11_PIN);          // DHT11ピンの初期化 (非同期読み取り)
 
     gpio_init(SHUTTER_SENSOR_PIN);
     gpio_set_dir(SHUTTER_SENSOR_PIN, GPIO_IN);
@@ -171,29 +268,21 @@ void init_rp2040(void) {
     static repeating_timer_t timer;
     add_repeating_timer_ms(-1, timer_callback, NULL, &timer);
 
-    // === ADC設定 ===
-    adc_init();
-    adc_set_clkdiv((ADC_CLOCK_FREQ / ADC_SAMPLE_FREQ_HZ) - 1.0f); // 25kHz
-    adc_gpio_init(ADC_PIN);       // ADC0
-    adc_select_input(0);          // ADC0を選択
-    adc_set_round_robin(0);       // ラウンドロビン無効
+    // === 同期検波 (コア1) ===
+    sample_queue_init();
+    result_queue_init();
+    multicore_launch_core1(core1_main);
 
-    adc_fifo_setup(true, false, 1, false, false);
-    irq_set_exclusive_handler(ADC_IRQ_FIFO, adc_irq_handler);
-    irq_set_enabled(ADC_IRQ_FIFO, true);
-    adc_irq_set_enabled(true);
-    irq_set_priority(ADC_IRQ_FIFO, 0);
+    // === ADC設定 (DMAでブロック単位に取り込み) ===
+    shutter_init(SHUTTER_SENSOR_PIN);
+    adc_control_init(ADC_PIN, adc_block_handler);
+    hal_flash_guard(adc_control_pause, adc_control_resume); // フラッシュ書き換え中はADCを止める
 
     sleep_ms(1);
-    adc_run(true); // ADCフリーラン開始
+    adc_control_start(); // ADCフリーラン開始
 
-    // === PWM設定 ===
-    gpio_set_function(PWM_PIN, GPIO_FUNC_PWM);
-    pwm_slice_num = pwm_gpio_to_slice_num(PWM_PIN);
-    pwm_set_output_polarity(pwm_slice_num, PWM_CHAN_A, true);
-    pwm_set_wrap(pwm_slice_num, PWM_WRAP_VALUE); // 20kHz
-    pwm_set_chan_level(pwm_slice_num, PWM_CHAN_A, 0);
-    pwm_set_enabled(pwm_slice_num, true);
+    // === モーター (PWM 20kHz, シャッター周期で速度制御) ===
+    motor_init(PWM_PIN, PWM_WRAP_VALUE);
 
     // === ライブラリ初期化 ===
     lcd_init();
@@ -203,59 +292,257 @@ void init_rp2040(void) {
 
 //*****************************************************************************
 // LCDとスイッチを使った表示処理
+// スイッチは毎回確認し、描画は新しいデータ・ページ切替・点滅の時だけ行う
 //*****************************************************************************
-void display_process(void) {
+void display_process(bool update) {
     static unsigned int parameter_pattern = 1;
     unsigned int set_min, set_max;
     static bool dot_blink = false; // ドットの点滅状態を管理
-    static uint64_t last_blink_update = 0; // 最後の点滅更新時刻
+    static uint32_t blink_seq = 0; // 点滅に反映したDHT11の読み取り回数
+    static uint32_t diag_seq = 0;  // 表示した動作状況の更新回数
+    static MotorState motor_shown = MOTOR_STOP; // 表示したモーター状態
+    static const char *const motor_names[] = {"STOP ", "SOFT ", "RUN  ", "STALL", "MAN  "};
+    static TrigState trig_shown = TRIG_OFF; // 表示したトリガー状態
+    static const char *const trig_names[] = {"OFF ", "ARM ", "POST", "HOLD"};
+    static const char *const trig_modes[] = {"L+", "L-", "S+", "S-", "S*"};
+    static uint32_t stats_shown = 0; // 表示した統計の更新回数
+    static const char *const stats_names[] = {"10s  ", "1min ", "10min"};
+    StatsSummary rolling, total;
+    DiagSnapshot diag;
 
     set_min = 1;
-    set_max = 3;
+    set_max = 9;
+
+    // モーターの状態変化 (停止検出はブザーで知らせる)
+    if (motor_state() != motor_shown) {
+        motor_shown = motor_state();
+        if (motor_shown == MOTOR_STALL) set_beep_pattern(0xF);
+        update = true;
+    }
+
+    // トリガーの状態変化 (記録完了はブザーで知らせる)
+    if (trig_state() != trig_shown) {
+        trig_shown = trig_state();
+        if (trig_shown == TRIG_HOLD) set_beep_pattern(0xA);
+        update = true;
+    }
 
-    // DHT11のサンプリングタイミング（2秒ごと）に合わせて点滅を更新
-    if (time_us_64() - last_blink_update >= 2000000) { // 2秒間隔
+    // 統計は1秒毎に更新
+    if ((parameter_pattern == 8 || parameter_pattern == 9) && stats_seq() != stats_shown) {
+        stats_shown = stats_seq();
+        update = true;
+    }
+
+    // DHT11の読み取り毎に点滅を更新
+    if (dht11_data.seq != blink_seq) {
         dot_blink = !dot_blink; // 点滅状態を反転
-        last_blink_update = time_us_64();
+        blink_seq = dht11_data.seq;
+        update = true;
     }
 
+    // 動作状況は1秒毎に更新
+    diag_get(&diag);
+    if (parameter_pattern == 4 && diag.seq != diag_seq) {
+        diag_seq = diag.seq;
+        update = true;
+    }
+
+    // ページを離れたら校正手順は中止
     if (get_sw_flag(SW_1)) {
+        if (parameter_pattern == 6) cal_cancel();
         parameter_pattern++;
         if (parameter_pattern > set_max) parameter_pattern = set_min;
+        update = true;
     }
     if (get_sw_flag(SW_2)) {
+        if (parameter_pattern == 6) cal_cancel();
         parameter_pattern--;
         if (parameter_pattern < set_min) parameter_pattern = set_max;
+        update = true;
     }
 
+    // SW0でUSBへの生サンプルキャプチャを開始・停止 (全ページ共通)
+    if (get_sw_flag(SW_0)) {
+        raw_capture_enable(!raw_capture_enabled());
+        set_beep_pattern(raw_capture_enabled() ? 0xA : 0xF);
+    }
+
+    // ページ毎のスイッチ操作
     switch (parameter_pattern) {
         case 1:
-            lcd_position(0, 0);
-            lcd_printf("Surf. Potential ");
-            lcd_position(0, 1);
-            lcd_printf("   = %+6.2f [kV]", surface_potential_kv * surface_potential_sign);
+            // SW3でモーター起動 (ソフトスタート→定速制御)、SW4で停止
+            if (get_sw_flag(SW_3)) {
+                set_beep_pattern(0xA);
+                motor_start();
+            }
+            if (get_sw_flag(SW_4)) {
+                set_beep_pattern(0xF);
+                motor_stop();
+            }
+            break;
+
+        case 2:
+            // SW3で適応窓、SW4で固定窓
+            if (get_sw_flag(SW_3)) {
+                set_beep_pattern(0xA);
+                demod_adaptive = true;
+                __sev();
+            }
+            if (get_sw_flag(SW_4)) {
+                set_beep_pattern(0xF);
+                demod_adaptive = false;
+                __sev();
+            }
+            break;
+
+        case 5:
+            // SW3/SW4で目標回転数を上げ下げ
+            if (get_sw_flag(SW_3)) {
+                motor_set_target(motor_target() + MOTOR_RPM_STEP);
+                update = true;
+            }
+            if (get_sw_flag(SW_4)) {
+                motor_set_target(motor_target() - MOTOR_RPM_STEP);
+                update = true;
+            }
+            break;
+
+        case 6:
+            // 校正: SW3で開始・基準電圧の確定、SW4で今の基準電圧を飛ばす
+            if (get_sw_flag(SW_3)) {
+                set_beep_pattern(0xA);
+                if (cal_state() == CAL_WAIT) cal_capture();
+                else if (cal_state() != CAL_CAPTURE) cal_begin();
+                update = true;
+            }
+            if (get_sw_flag(SW_4)) {
+                set_beep_pattern(0xF);
+                cal_skip();
+                update = true;
+            }
+            break;
+
+        case 7:
+            // トリガー記録: SW3でアーム (記録を捨ててやり直し)、SW4で停止・ピークホールドのやり直し
+            if (get_sw_flag(SW_3)) {
+                set_beep_pattern(0xA);
+                trig_arm();
+                update = true;
+            }
+            if (get_sw_flag(SW_4)) {
+                set_beep_pattern(0xF);
+                trig_disarm();
+                trig_peak_reset();
+                update = true;
+            }
+            break;
+
+        case 8:
+            // 統計 (移動区間): SW3で区間を切り替え (10秒/1分/10分)
             if (get_sw_flag(SW_3)) {
                 set_beep_pattern(0xA);
-                pwm_set_chan_level(pwm_slice_num, PWM_CHAN_A, 650);
+                stats_set_window((StatsWindow)((stats_window() + 1) % STATS_WINDOW_NUM));
+                update = true;
             }
+            get_sw_flag(SW_4);
+            break;
+
+        case 9:
+            // 統計 (リセット後): SW4でリセット
             if (get_sw_flag(SW_4)) {
                 set_beep_pattern(0xF);
-                pwm_set_chan_level(pwm_slice_num, PWM_CHAN_A, 0);
+                stats_reset();
+                update = true;
             }
+            get_sw_flag(SW_3);
+            break;
+
+        default:
+            // SW3/SW4を使わないページでは押下を捨てる (ページを移った後に効かないように)
+            get_sw_flag(SW_3 | SW_4);
+            break;
+    }
+
+    if (!update) return;
+
+    switch (parameter_pattern) {
+        case 1:
+            lcd_position(0, 0);
+            lcd_printf("Surf. Potential ");
+            lcd_position(0, 1);
+            // 0.01kV単位に丸めて表示
+            lcd_printf("   = %+6.2q [kV]", (surface_potential_mv + (surface_potential_mv < 0 ? -5000 : 5000)) / 10000);
             break;
 
         case 2:
+            // 窓の長さ (A:適応, F:固定) も表示
+            lcd_position(0, 0);
+            lcd_printf("ADC Cnt Win %c%3u", demod_adaptive ? 'A' : 'F', demod_window);
+            lcd_position(0, 1);
+            lcd_printf("         = %+5d", adc_average / (1 << DEMOD_FRAC_BITS));
+            break;
+
+        case 3:
+            lcd_position(0, 0);
+            lcd_printf("Temp:%5.1q C   %c", (int32_t)dht11_data.temperature, dot_blink ? '.' : ' ');
+            lcd_position(0, 1);
+            lcd_printf("Hum: %5.1q %%RH %c", (int32_t)dht11_data.humidity, dot_blink ? '.' : ' ');
+            break;
+
+        case 4:
+            // 動作状況: アイドル率・ループ回転数 / タイマー遅れ最大[us]・ADC異常の累計
+            lcd_position(0, 0);
+            lcd_printf("Idle%3u%% Lp%5u", (uint32_t)(diag.idle + 5) / 10, diag.loop_rate);
+            lcd_position(0, 1);
+            lcd_printf("Lat%4u Ovr%5u", (uint32_t)diag.timer_late_max_us,
+                       diag.adc_overrun + diag.adc_error + diag.adc_late);
+            break;
+
+        case 5:
+            // モーター: 状態・目標回転数 / 測定回転数・PWMレベル
+            lcd_position(0, 0);
+            lcd_printf("Motor %s%5u", motor_names[motor_shown], motor_target());
+            lcd_position(0, 1);
+            lcd_printf("%5urpm Lv%5u", motor_rpm(), (uint32_t)motor_level());
+            break;
+
+        case 6:
+            // 校正: 手順外は校正の出所 (FLASH/既定値) と極性毎の点数
+            //       手順中は番号・基準電圧 / 今の同相成分 (平均中は avg)
+            lcd_position(0, 0);
+            if (cal_state() == CAL_WAIT || cal_state() == CAL_CAPTURE) {
+                lcd_printf("Cal%u/%u  %+6.2qkV", cal_step() + 1, cal_steps(), cal_step_mv() / 10000);
+                lcd_position(0, 1);
+                lcd_printf("Cnt%+7.1q %s", cal_live_counts() * 10 / (1 << DEMOD_FRAC_BITS),
+                           cal_state() == CAL_WAIT ? "SW3ok" : "avg  ");
+            } else {
+                lcd_printf("Calib %s P%uN%u", cal_from_flash() ? "FLASH" : "DEFLT",
+                           cal_point_count(CAL_POSITIVE), cal_point_count(CAL_NEGATIVE));
+                lcd_position(0, 1);
+                lcd_printf("%sSW3:start", cal_state() == CAL_SAVED ? "Saved  " :
+                                          cal_state() == CAL_FAILED ? "Failed " : "       ");
+            }
+            break;
+
+        case 7:
+            // トリガー記録: 状態・条件・しきい値 / ピークホールドの最大・最小 [kV]
             lcd_position(0, 0);
-            lcd_printf("ADC Count       ");
+            lcd_printf("%s %s %+6.2qkV", trig_names[trig_shown], trig_modes[trig_mode()], trig_level() / 10000);
             lcd_position(0, 1);
-            lcd_printf("         = %+5ld", abs(adc_average));
+            lcd_printf("%+6.2q/%+6.2qkV ", trig_peak_max() / 10000, trig_peak_min() / 10000);
             break;
 
-            case 3:
+        case 8:
+        case 9:
+            // 統計: 区間 (8:移動区間, 9:リセット後)・平均 [kV] / 標準偏差・最大-最小 [kV]
+            stats_get(&rolling, &total);
+            if (parameter_pattern == 9) rolling = total;
             lcd_position(0, 0);
-            lcd_printf("Temp:%5.1f C   %c", temperature, dot_blink ? '.' : ' ');
+            lcd_printf("%s avg%+7.3q", parameter_pattern == 8 ? stats_names[stats_window()] : "All  ",
+                       rolling.mean_mv / 1000);
             lcd_position(0, 1);
-            lcd_printf("Hum: %5.1f %%RH %c", humidity, dot_blink ? '.' : ' ');
+            lcd_printf("sd%6.3q pp%5.2q", (int32_t)(rolling.stddev_mv / 1000),
+                       (rolling.max_mv - rolling.min_mv) / 10000);
             break;
 
         default:
@@ -264,132 +551,131 @@ void display_process(void) {
 }
 
 //*****************************************************************************
-// タイマー割り込み処理 (1msごと)
+// 計測結果をテレメトリで送信
 //*****************************************************************************
-bool timer_callback(repeating_timer_t *rt) {
+void send_measurement(const DemodResult *result) {
+    TelemetryMeasurement m;
+    StatsSummary rolling, total;
+    uint8_t payload[TELEMETRY_MEASUREMENT_SIZE];
+
+    m.potential_mv = surface_potential_mv;
+    m.average_q8 = result->average;
+    m.quadrature_q8 = result->quadrature;
+    m.phase_q16 = result->phase;
+    m.sign = (int8_t)result->sign;
+    m.dht11_status = dht11_data.status;
+    m.sample_count = result->sample_count;
+    m.shutter_count = (uint16_t)result->shutter_count;
+    m.temperature = dht11_data.temperature;
+    m.humidity = dht11_data.humidity;
+    m.shutter_mhz = result->shutter_mhz;
+    m.dc_offset_q8 = result->dc_offset;
+    stats_get(&rolling, &total);
+    m.stats_window_s = (uint16_t)stats_window_seconds(stats_window());
+    m.stats_mean_mv = rolling.mean_mv;
+    m.stats_stddev_mv = rolling.stddev_mv;
+    m.stats_min_mv = rolling.min_mv;
+    m.stats_max_mv = rolling.max_mv;
+    m.total_mean_mv = total.mean_mv;
+    m.total_stddev_mv = total.stddev_mv;
+    m.total_min_mv = total.min_mv;
+    m.total_max_mv = total.max_mv;
+    m.flags = result->gap ? TELEMETRY_MEAS_FLAG_GAP : 0;
+
+    telemetry_pack_measurement(payload, &m);
+    telemetry_send(TELEMETRY_TYPE_MEASUREMENT, payload, TELEMETRY_MEASUREMENT_SIZE);
+}
 
-    lcd_process();
-    switch_process();
-    beep_process();
+//*****************************************************************************
+// 動作状況をテレメトリで送信
+//*****************************************************************************
+void send_diagnostics(void) {
+    DiagSnapshot diag;
+    TelemetryDiagnostics d;
+    uint8_t payload[TELEMETRY_DIAG_SIZE];
+    int i;
+
+    diag_get(&diag);
+    for (i = 0; i < DIAG_ISR_NUM; i++) {
+        d.isr_count[i] = diag.isr_count[i];
+        d.isr_max_us[i] = diag.isr_max_us[i];
+        d.isr_load[i] = diag.isr_load[i];
+    }
+    d.adc_overrun = diag.adc_overrun;
+    d.adc_error = diag.adc_error;
+    d.adc_late = diag.adc_late;
+    for (i = 0; i < DIAG_LATE_BINS; i++) {
+        d.timer_late[i] = diag.timer_late[i];
+    }
+    d.timer_late_max_us = diag.timer_late_max_us;
+    d.idle = diag.idle;
+    d.loop_rate = diag.loop_rate;
+    d.sample_queue_max = diag.sample_queue_max;
+    d.sample_queue_dropped = sample_queue_dropped();
+    d.telemetry_dropped = telemetry_dropped();
+
+    telemetry_pack_diag(payload, &d);
+    telemetry_send(TELEMETRY_TYPE_DIAG, payload, TELEMETRY_DIAG_SIZE);
+}
 
-    return true;
+//*****************************************************************************
+// ログへ1件記録 (表面電位は記録間隔の平均, 状態フラグはここで集める)
+//*****************************************************************************
+void log_measurement(uint32_t now_ms) {
+    static uint32_t adc_errors = 0; // 前回までのADC異常の累計
+    static uint32_t adc_gaps = 0;   // 前回までのADC取り込みの途切れ回数
+    DiagSnapshot diag;
+    uint32_t errors;
+    uint8_t flags = 0;
+
+    diag_get(&diag);
+    errors = diag.adc_overrun + diag.adc_error + diag.adc_late;
+    if (errors != adc_errors) flags |= TELEMETRY_LOG_FLAG_ADC;
+    adc_errors = errors;
+    if (adc_control_gaps() != adc_gaps) flags |= TELEMETRY_LOG_FLAG_GAP;
+    adc_gaps = adc_control_gaps();
+
+    if (dht11_data.status == DHT11_OK) flags |= TELEMETRY_LOG_FLAG_DHT11_OK;
+    if (motor_state() == MOTOR_RUN) flags |= TELEMETRY_LOG_FLAG_MOTOR;
+    if (cal_from_flash()) flags |= TELEMETRY_LOG_FLAG_CAL;
+
+    log_record(now_ms, dht11_data.temperature, dht11_data.humidity, flags);
 }
 
 //*****************************************************************************
-// ADC割り込み処理
+// タイマー割り込み処理 (1msごと)
 //*****************************************************************************
-static void adc_irq_handler(void) {
-    // ADC値を取得
-    int32_t adc_value = adc_fifo_get() - ADC_MID_VALUE;
-
-    // シャッター状態を取得
-    bool shutter_open = gpio_get(SHUTTER_SENSOR_PIN);
-
-    // 同期検波
-    int32_t sync_factor = shutter_open ? 1 : -1;
-    demod_state.sync_value += adc_value * sync_factor;
-    if (shutter_open) {
-        demod_state.positive_sum += adc_value;
-    } else {
-        demod_state.negative_sum += adc_value;
-    }
-    demod_state.sample_count++;
+bool timer_callback(repeating_timer_t *rt) {
+    uint32_t diag = diag_isr_enter();
+    uint32_t rise_count, rise_period;
 
-    // シャッター状態変化を検出
-    if (shutter_open != demod_state.prev_shutter_state) {
-        demod_state.shutter_count++;
-        demod_state.prev_shutter_state = shutter_open;
-    }
+    diag_timer_tick();
+    lcd_process();
+    switch_process();
+    beep_process();
+    dht11_process();
 
-    // 指定回転数ごとに平均値を計算
-    if (demod_state.shutter_count >= SHUTTER_CYCLE_THRESHOLD) {
-        adc_average = demod_state.sync_value / demod_state.sample_count;
-
-        // 電位の正負判定とLED制御
-        surface_potential_sign = (demod_state.positive_sum > demod_state.negative_sum) ? 1 : -1;
-        gpio_put(LED_RED_PIN, surface_potential_sign > 0);  // 赤LED
-        gpio_put(LED_BLUE_PIN, surface_potential_sign < 0); // 青LED
-
-        // 状態リセット
-        demod_state.sync_value = 0;
-        demod_state.sample_count = 0;
-        demod_state.positive_sum = 0;
-        demod_state.negative_sum = 0;
-        demod_state.shutter_count = 0;
-    }
+    shutter_rise(&rise_count, &rise_period);
+    motor_process(rise_count, rise_period);
 
-    // デバッグ用出力
-    gpio_put(DEBUG_OUT_PIN, shutter_open);
+    diag_isr_exit(DIAG_ISR_TIMER, diag);
+    return true;
 }
 
 //*****************************************************************************
-// DHT11から温湿度を読み取る
+// ADCブロック処理 (DMA割り込みから1ブロック毎に呼ばれる)
 //*****************************************************************************
-bool read_dht11(float *temp, float *hum) {
-    uint8_t data[5] = {0}; // DHT11は40ビットのデータ (5バイト) を送信
-    uint32_t timeout;
-
-    sleep_ms(100); // 前回の読み取りから十分な時間を確保
-
-    // ピンを出力に設定し、開始信号を送信 (20ms LOW, その後HIGH)
-    gpio_set_dir(DHT11_PIN, GPIO_OUT);
-    gpio_put(DHT11_PIN, 0);
-    sleep_ms(20);
-    gpio_put(DHT11_PIN, 1);
-    sleep_us(40);
-
-    // ピンを入力に切り替え、DHT11の応答を待つ
-    gpio_set_dir(DHT11_PIN, GPIO_IN);
-    timeout = 10000;
-    while (gpio_get(DHT11_PIN) && timeout--) sleep_us(1); // LOWを待つ
-    if (timeout == 0) {
-        irq_set_enabled(ADC_IRQ_FIFO, true); // 割り込み復帰
-        return false;
-    }
-    timeout = 10000;
-    while (!gpio_get(DHT11_PIN) && timeout--) sleep_us(1); // HIGHを待つ
-    if (timeout == 0) {
-        irq_set_enabled(ADC_IRQ_FIFO, true); // 割り込み復帰
-        return false;
-    }
-    timeout = 10000;
-    while (gpio_get(DHT11_PIN) && timeout--) sleep_us(1); // LOWを待つ
-    if (timeout == 0) {
-        irq_set_enabled(ADC_IRQ_FIFO, true); // 割り込み復帰
-        return false;
-    }
+static void adc_block_handler(const uint32_t *samples, uint32_t count) {
+    // コア1の同期検波へ渡す
+    sample_queue_push(samples, count);
+    diag_queue_level(sample_queue_level());
+    __sev();
 
-    // 40ビットのデータを受信
-    for (int i = 0; i < 5; i++) {
-        for (int j = 7; j >= 0; j--) {
-            timeout = 10000;
-            while (!gpio_get(DHT11_PIN) && timeout--) sleep_us(1); // HIGHを待つ
-            if (timeout == 0) {
-                irq_set_enabled(ADC_IRQ_FIFO, true); // 割り込み復帰
-                return false;
-            }
-            sleep_us(60); // タイミング調整
-            if (gpio_get(DHT11_PIN)) {
-                data[i] |= (1 << j); // HIGHなら1
-            }
-            timeout = 10000;
-            while (gpio_get(DHT11_PIN) && timeout--) sleep_us(1); // LOWを待つ
-            if (timeout == 0) {
-                irq_set_enabled(ADC_IRQ_FIFO, true); // 割り込み復帰
-                return false;
-            }
-        }
-    }
+    // USBキャプチャ用 (メインループで送信)
+    raw_capture_push(samples, count);
 
-    // チェックサム検証
-    uint8_t calc_checksum = (data[0] + data[1] + data[2] + data[3]) & 0xFF;
-    if (data[4] == calc_checksum) {
-        *hum = (float)data[0] + (float)data[1] / 10.0f;  // 湿度 (小数点対応)
-        *temp = (float)data[2] + (float)data[3] / 10.0f; // 温度 (小数点対応)
-        return true;
-    } else {
-        return false;
-    }
+    // デバッグ用出力
+    gpio_put(DEBUG_OUT_PIN, (samples[count - 1] & ADC_SAMPLE_SHUTTER_BIT) != 0);
 }
 
 //*****************************************************************************
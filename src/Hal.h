@@ -0,0 +1,64 @@
+//*****************************************************************************
+// ファイル名       Hal.h
+// 対象マイコン     RP2040 / ホストPC
+// ファイル内容     ハードウェア抽象化 (スイッチ・ブザー・LCD・フラッシュが使う分)
+//*****************************************************************************
+// 実機は HalRp2040.c、ホストPCのシミュレータは host/HalHost.c で実装する。
+// ADC・シャッター・DHT11は割り込み/DMAと一体なので対象外 (シミュレータは
+// サンプルデータを直接生成する)。
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+// フラッシュのデータ領域 (プログラムの後ろ, フラッシュ末尾の16セクタ)
+#define HAL_FLASH_SECTOR_SIZE   4096        // 消去単位
+#define HAL_FLASH_PAGE_SIZE     256         // 書き込み単位
+#define HAL_FLASH_DATA_SIZE     (16 * HAL_FLASH_SECTOR_SIZE)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+// GPIO
+bool hal_gpio_get(unsigned int pin);
+void hal_gpio_put(unsigned int pin, bool value);
+
+// PWM (GPIO毎, 出力は反転)
+void hal_pwm_init(unsigned int pin, uint16_t wrap);
+void hal_pwm_set_level(unsigned int pin, uint16_t level);
+
+// 時間
+void hal_sleep_ms(uint32_t ms);
+
+// 処理時間計測 (実機はSysTick = CPUクロック数, ホストPCはナノ秒)
+void     hal_cycle_init(void);
+uint32_t hal_cycle_count(void);
+uint32_t hal_cycle_elapsed(uint32_t start);                 // startからの経過 (折り返し考慮)
+uint32_t hal_cycle_hz(void);
+uint32_t hal_irq_save(void);                                // 割り込み禁止 (計測区間用)
+void     hal_irq_restore(uint32_t status);
+
+// LCD 4ビットバス (1バイト = 1ニブル, ビット配置はLcdControl.hのLCD_PIO_NIBBLE)
+void hal_lcd_bus_init(unsigned int pin_base, unsigned int pin_e);
+void hal_lcd_bus_put(uint8_t nibble);                      // 1ニブル送信 (送れるまで待つ)
+void hal_lcd_bus_write(const uint8_t *stream, int count);  // ニブル列をバックグラウンドで送信
+bool hal_lcd_bus_busy(void);                               // hal_lcd_bus_writeの送信中
+
+// フラッシュ データ領域 (offsetは領域先頭から。消去はセクタ、書き込みはページ単位)
+// 消去・書き込みの間は割り込みともう一方のコアが止まる (消去は1セクタ約50ms)
+// 割り込みなしでは動き続けられない処理 (ADCのDMA) は、hal_flash_guard で渡した
+// 関数で書き換えの前に止め、後で再開する
+typedef void (*hal_flash_hook_t)(void);
+const uint8_t *hal_flash_data(uint32_t offset);            // 読み出し (直接参照)
+void hal_flash_guard(hal_flash_hook_t pause, hal_flash_hook_t resume);
+void hal_flash_erase(uint32_t offset, uint32_t size);
+void hal_flash_program(uint32_t offset, const uint8_t *data, uint32_t size);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
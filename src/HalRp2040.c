@@ -0,0 +1,188 @@
+//*****************************************************************************
+// ファイル名       HalRp2040.c
+// 対象マイコン     RP2040
+// ファイル内容     ハードウェア抽象化 (実機用)
+//*****************************************************************************
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+#include "hardware/flash.h"
+#include "pico/multicore.h"
+#include "Hal.h"
+#include "LcdBus.pio.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+PIO             lcd_pio;
+uint            lcd_sm;
+int             lcd_dma_chan;
+hal_flash_hook_t flash_pause;           // フラッシュ書き換え前に止める処理
+hal_flash_hook_t flash_resume;          // フラッシュ書き換え後に再開する処理
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static uint32_t hal_flash_begin(bool *lockout);
+static void     hal_flash_end(uint32_t status, bool lockout);
+
+//*****************************************************************************
+// GPIO
+//*****************************************************************************
+bool hal_gpio_get(unsigned int pin) {
+    return gpio_get(pin);
+}
+
+void hal_gpio_put(unsigned int pin, bool value) {
+    gpio_put(pin, value);
+}
+
+//*****************************************************************************
+// PWM
+//*****************************************************************************
+void hal_pwm_init(unsigned int pin, uint16_t wrap) {
+    uint slice = pwm_gpio_to_slice_num(pin);
+    uint chan = pwm_gpio_to_channel(pin);
+
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    pwm_set_output_polarity(slice, chan == PWM_CHAN_A, chan == PWM_CHAN_B);
+    pwm_set_wrap(slice, wrap);
+    pwm_set_chan_level(slice, chan, 0);
+    pwm_set_enabled(slice, true);
+}
+
+void hal_pwm_set_level(unsigned int pin, uint16_t level) {
+    pwm_set_gpio_level(pin, level);
+}
+
+//*****************************************************************************
+// 時間
+//*****************************************************************************
+void hal_sleep_ms(uint32_t ms) {
+    sleep_ms(ms);
+}
+
+//*****************************************************************************
+// 処理時間計測 (SysTick: CPUクロックで減る24ビットカウンタ)
+//*****************************************************************************
+void hal_cycle_init(void) {
+    systick_hw->csr = 0;
+    systick_hw->rvr = 0x00ffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;          // CPUクロック, 割り込みなし, 動作開始
+}
+
+uint32_t hal_cycle_count(void) {
+    return systick_hw->cvr;
+}
+
+uint32_t hal_cycle_elapsed(uint32_t start) {
+    return (start - systick_hw->cvr) & 0x00ffffff;  // 約134ms (125MHz) まで
+}
+
+uint32_t hal_cycle_hz(void) {
+    return clock_get_hz(clk_sys);
+}
+
+uint32_t hal_irq_save(void) {
+    return save_and_disable_interrupts();
+}
+
+void hal_irq_restore(uint32_t status) {
+    restore_interrupts(status);
+}
+
+//*****************************************************************************
+// LCD 4ビットバス PIO・DMA 初期化
+//*****************************************************************************
+void hal_lcd_bus_init(unsigned int pin_base, unsigned int pin_e) {
+    dma_channel_config c;
+    uint offset;
+
+    lcd_pio = pio0;
+    lcd_sm = pio_claim_unused_sm(lcd_pio, true);
+    offset = pio_add_program(lcd_pio, &lcd_bus_program);
+    lcd_bus_program_init(lcd_pio, lcd_sm, offset, pin_base, pin_e);
+
+    lcd_dma_chan = dma_claim_unused_channel(true);
+    c = dma_channel_get_default_config(lcd_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(lcd_pio, lcd_sm, true));
+    dma_channel_configure(lcd_dma_chan, &c, &lcd_pio->txf[lcd_sm], NULL, 0, false);
+}
+
+//*****************************************************************************
+// LCD 4ビットバス 送信
+//*****************************************************************************
+void hal_lcd_bus_put(uint8_t nibble) {
+    pio_sm_put_blocking(lcd_pio, lcd_sm, nibble);
+}
+
+void hal_lcd_bus_write(const uint8_t *stream, int count) {
+    dma_channel_transfer_from_buffer_now(lcd_dma_chan, stream, count);
+}
+
+bool hal_lcd_bus_busy(void) {
+    return dma_channel_is_busy(lcd_dma_chan);
+}
+
+//*****************************************************************************
+// フラッシュ データ領域 (フラッシュ末尾 HAL_FLASH_DATA_SIZE バイト)
+// 書き換え中はXIPが使えないので、割り込みを止め、コア1も(動いていれば)RAMで待たせる
+// 消去・書き込みは全て hal_flash_begin / hal_flash_end で囲む
+//*****************************************************************************
+#define HAL_FLASH_DATA_BASE     (PICO_FLASH_SIZE_BYTES - HAL_FLASH_DATA_SIZE)
+
+const uint8_t *hal_flash_data(uint32_t offset) {
+    return (const uint8_t *)(uintptr_t)(XIP_BASE + HAL_FLASH_DATA_BASE + offset);
+}
+
+void hal_flash_guard(hal_flash_hook_t pause, hal_flash_hook_t resume) {
+    flash_pause = pause;
+    flash_resume = resume;
+}
+
+void hal_flash_erase(uint32_t offset, uint32_t size) {
+    bool lockout;
+    uint32_t status = hal_flash_begin(&lockout);
+
+    flash_range_erase(HAL_FLASH_DATA_BASE + offset, size);
+    hal_flash_end(status, lockout);
+}
+
+void hal_flash_program(uint32_t offset, const uint8_t *data, uint32_t size) {
+    bool lockout;
+    uint32_t status = hal_flash_begin(&lockout);
+
+    flash_range_program(HAL_FLASH_DATA_BASE + offset, data, size);
+    hal_flash_end(status, lockout);
+}
+
+// 書き換えの準備 (止める処理を止めてから、コア1と割り込みを止める)
+static uint32_t hal_flash_begin(bool *lockout) {
+    if (flash_pause != NULL) flash_pause();
+    *lockout = multicore_lockout_victim_is_initialized(1);
+    if (*lockout) multicore_lockout_start_blocking();
+    return save_and_disable_interrupts();
+}
+
+// 書き換えの後始末 (逆順に戻す)
+static void hal_flash_end(uint32_t status, bool lockout) {
+    restore_interrupts(status);
+    if (lockout) multicore_lockout_end_blocking();
+    if (flash_resume != NULL) flash_resume();
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -6,29 +6,33 @@
 //=============================================================================
 //include
 //=============================================================================
-#include <stdio.h>
-#include "pico/stdlib.h"
-#include "hardware/gpio.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "Hal.h"
 #include "LcdControl.h"
 
 //=============================================================================
 //グローバル変数宣言
 //=============================================================================
 char            buff_lcd_data[LCD_MAX_X * LCD_MAX_Y];
-char            buff_lcd_data2[LCD_MAX_X * LCD_MAX_Y];
+char            buff_lcd_data2[LCD_MAX_X * LCD_MAX_Y + 1];
+char            buff_lcd_shadow[LCD_MAX_X * LCD_MAX_Y]; // LCDに実際に表示されている内容
 int             lcd_pos;                // バッファに書き込む位置
-int             lcd_mode = 1;
-int             lcd_now_locate;
-int             f_lcd_refresh;
+int             lcd_now_locate = -1;    // LCD側のカーソル位置 (-1:不定)
+volatile int    f_lcd_refresh;          // 表示と異なるセルがある可能性あり
+uint8_t         lcd_stream[LCD_STREAM_SIZE]; // DMAで送るニブル列
 
 //=============================================================================
 //プロトタイプ宣言(ローカル)
 //=============================================================================
 void lcd_locate(int x, int y);
+static unsigned char lcd_address(int x, int y);
 void lcd_out(char command, char data);
 void lcd_out2(char data2);
-void lcd_dr(char data);
-void lcd_nop(volatile int i);
+static int  lcd_stream_put(int n, char command, char data);
+static char *lcd_format_number(char *p, char *end, uint32_t value, bool negative,
+                               int width, int decimals, bool plus, bool zero);
 
 //*****************************************************************************
 // 液晶処理 初期化
@@ -36,29 +40,34 @@ void lcd_nop(volatile int i);
 int lcd_init(void) {
     int i;
 
+    hal_lcd_bus_init(LCD_PIN_BASE, LCD_PIN_E);
+
     for (i = 0; i <= LCD_MAX_X * LCD_MAX_Y - 1; i++) {
         buff_lcd_data[i] = ' ';
+        buff_lcd_shadow[i] = ' ';   // 表示クリア後の内容
     }
+    lcd_now_locate = -1;
+    f_lcd_refresh = 0;
 
-    sleep_ms(20);
+    hal_sleep_ms(20);
     lcd_out2(0x03);
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out2(0x03);
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out2(0x03);
     lcd_out2(0x02);
-    sleep_ms(5);
+    hal_sleep_ms(5);
 
     lcd_out(LCD_INST, 0x28);  // 4-bit mode, 2 lines, 5x7 font
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out(LCD_INST, 0x08);  // Display off
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out(LCD_INST, 0x01);  // Display clear
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out(LCD_INST, 0x06);  // Entry mode: increment, no shift
-    sleep_ms(5);
+    hal_sleep_ms(5);
     lcd_out(LCD_INST, 0x0c);  // Display on, cursor off, blink off
-    sleep_ms(5);
+    hal_sleep_ms(5);
 
     return 1;
 }
@@ -67,6 +76,13 @@ int lcd_init(void) {
 // 液晶カーソル移動
 //*****************************************************************************
 void lcd_locate(int x, int y) {
+    lcd_out(LCD_INST, lcd_address(x, y));
+}
+
+//*****************************************************************************
+// カーソル移動コマンドの生成
+//*****************************************************************************
+static unsigned char lcd_address(int x, int y) {
     unsigned char work = 0x80;
 
     work += x;
@@ -77,7 +93,7 @@ void lcd_locate(int x, int y) {
     } else if (y == 3) {
         work += 0x54;
     }
-    lcd_out(LCD_INST, work);
+    return work;
 }
 
 //*****************************************************************************
@@ -94,93 +110,169 @@ void lcd_out(char command, char data) {
 }
 
 //*****************************************************************************
-// 液晶データ出力
+// 液晶データ出力 (初期化用, 1ニブルをPIOへ)
 //*****************************************************************************
 void lcd_out2(char data2) {
-    lcd_dr(data2);
-    lcd_nop(60);
-    lcd_dr(data2 | LCD_BIT_E);
-    lcd_nop(60);
-    lcd_dr(data2);
-    lcd_nop(60);
+    hal_lcd_bus_put(LCD_PIO_NIBBLE((unsigned char)data2));
 }
 
 //*****************************************************************************
-// IOへデータ出力
+// 送信列に1バイト分 (2ニブル) を追加
 //*****************************************************************************
-void lcd_dr(char data) {
-    gpio_put(0, (data & 0x01));  // D4
-    gpio_put(1, (data & 0x02));  // D5
-    gpio_put(2, (data & 0x04));  // D6
-    gpio_put(3, (data & 0x08));  // D7
-    gpio_put(5, (data & 0x10));  // RS
-    gpio_put(4, (data & 0x40));  // E
+static int lcd_stream_put(int n, char command, char data) {
+    lcd_stream[n++] = LCD_PIO_NIBBLE((unsigned char)command | ((unsigned char)data >> 4));
+    lcd_stream[n++] = LCD_PIO_NIBBLE((unsigned char)command | ((unsigned char)data & 0x0f));
+    return n;
 }
 
 //*****************************************************************************
-// 液晶表示処理
+// 液晶表示処理 (1msごと)
+// 変化したセルだけを、カーソル移動とデータのニブル列にしてDMAでPIOへ送る
 //*****************************************************************************
 void lcd_process(void) {
-    switch (lcd_mode) {
-        case 1:
-            if (f_lcd_refresh) {
-                f_lcd_refresh = 0;
-                lcd_mode = 2;
-            }
-            break;
-
-        case 2:
-            lcd_now_locate = 0;
-            lcd_locate(0, 0);
-            lcd_mode = 3;
-            break;
-
-        case 3:
-            if (lcd_now_locate % LCD_MAX_X == 0) {
-                lcd_locate(0, lcd_now_locate / LCD_MAX_X);
-            }
-            lcd_mode = 4;
-            break;
-
-        case 4:
-            lcd_out(LCD_DATA, buff_lcd_data[lcd_now_locate++]);
-            if (lcd_now_locate >= LCD_MAX_X * LCD_MAX_Y) {
-                lcd_mode = 1;
-            } else {
-                lcd_mode = 3;
-            }
-            break;
-
-        default:
-            lcd_mode = 1;
-            break;
+    int cell, n = 0;
+
+    // 前回の送信中は待つ
+    if (hal_lcd_bus_busy()) return;
+
+    // 書き込み側はデータを書いてからフラグを立てるので、先に下ろしてから探す
+    if (!f_lcd_refresh) return;
+    f_lcd_refresh = 0;
+
+    for (cell = 0; cell < LCD_MAX_X * LCD_MAX_Y; cell++) {
+        if (buff_lcd_data[cell] == buff_lcd_shadow[cell]) continue;
+
+        // カーソルが別の位置ならカーソル移動
+        if (cell != lcd_now_locate) {
+            n = lcd_stream_put(n, LCD_INST, lcd_address(cell % LCD_MAX_X, cell / LCD_MAX_X));
+        }
+
+        buff_lcd_shadow[cell] = buff_lcd_data[cell];
+        n = lcd_stream_put(n, LCD_DATA, buff_lcd_shadow[cell]);
+
+        // 行末を越えるとLCD側のアドレスは次の行に続かない
+        lcd_now_locate = ((cell + 1) % LCD_MAX_X == 0) ? -1 : cell + 1;
+    }
+
+    if (n > 0) {
+        hal_lcd_bus_write(lcd_stream, n);
     }
 }
 
 //*****************************************************************************
-// 液晶へ表示
+// 液晶へ表示 (整数・固定小数点のみの簡易書式, 書式はLcdControl.h参照)
 //*****************************************************************************
-int lcd_printf(char *format, ...) {
+int lcd_printf(const char *format, ...) {
     va_list argptr;
-    char    *p;
-    int     ret = 0;
+    char    *p = buff_lcd_data2;
+    char    *end = buff_lcd_data2 + LCD_MAX_X * LCD_MAX_Y;
+    const char *s;
+    bool    plus, zero;
+    int     width, decimals;
+    int32_t value;
 
     va_start(argptr, format);
-    ret = vsprintf(buff_lcd_data2, format, argptr);
+    while (*format && p < end) {
+        if (*format != '%') {
+            *p++ = *format++;
+            continue;
+        }
+        format++;
+
+        // フラグ・幅・小数桁数
+        plus = zero = false;
+        for (;; format++) {
+            if (*format == '+') plus = true;
+            else if (*format == '0') zero = true;
+            else break;
+        }
+        width = 0;
+        while (*format >= '0' && *format <= '9') width = width * 10 + (*format++ - '0');
+        decimals = 0;
+        if (*format == '.') {
+            format++;
+            while (*format >= '0' && *format <= '9') decimals = decimals * 10 + (*format++ - '0');
+        }
+        if (*format == 'l') format++;
+
+        switch (*format) {
+            case 'd':
+                decimals = 0;
+                // fall through
+            case 'q':
+                value = va_arg(argptr, int32_t);
+                p = lcd_format_number(p, end, value < 0 ? 0u - (uint32_t)value : (uint32_t)value,
+                                      value < 0, width, decimals, plus, zero);
+                break;
+
+            case 'u':
+                p = lcd_format_number(p, end, va_arg(argptr, uint32_t), false, width, 0, false, zero);
+                break;
+
+            case 'c':
+                *p++ = (char)va_arg(argptr, int);
+                break;
+
+            case 's':
+                for (s = va_arg(argptr, const char *); *s && p < end; ) *p++ = *s++;
+                break;
+
+            case '%':
+                *p++ = '%';
+                break;
+
+            default:
+                break;
+        }
+        if (*format) format++;
+    }
     va_end(argptr);
+    *p = '\0';
 
-    if (ret > 0) {
-        p = buff_lcd_data2;
-        while (*p) {
-            buff_lcd_data[lcd_pos++] = *p++;
-            if (lcd_pos >= LCD_MAX_X * LCD_MAX_Y) {
-                lcd_pos = 0;
-            }
+    p = buff_lcd_data2;
+    while (*p) {
+        if (buff_lcd_data[lcd_pos] != *p) {
+            buff_lcd_data[lcd_pos] = *p;
+            f_lcd_refresh = 1;  // 変化した時だけ表示処理を起こす
+        }
+        p++;
+        if (++lcd_pos >= LCD_MAX_X * LCD_MAX_Y) {
+            lcd_pos = 0;
         }
-        f_lcd_refresh = 1;
     }
 
-    return ret;
+    return p - buff_lcd_data2;
+}
+
+//*****************************************************************************
+// 数値を10進文字列に変換 (decimals桁目の前に小数点を入れる)
+//*****************************************************************************
+static char *lcd_format_number(char *p, char *end, uint32_t value, bool negative,
+                               int width, int decimals, bool plus, bool zero) {
+    char digits[12];
+    int  n = 0, len, i;
+
+    // 下の桁から生成 (小数部があれば整数部は最低1桁)
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value || n <= decimals);
+
+    len = n + (decimals > 0) + (negative || plus);
+
+    if (!zero) {
+        for (; len < width && p < end; len++) *p++ = ' ';
+    }
+    if ((negative || plus) && p < end) *p++ = negative ? '-' : '+';
+    if (zero) {
+        for (; len < width && p < end; len++) *p++ = '0';
+    }
+    for (i = n - 1; i >= 0 && p < end; i--) {
+        *p++ = digits[i];
+        if (i == decimals && decimals > 0 && p < end) *p++ = '.';
+    }
+
+    return p;
 }
 
 //*****************************************************************************
@@ -193,14 +285,6 @@ void lcd_position(char x, char y) {
     lcd_pos = x + y * LCD_MAX_X;
 }
 
-//*****************************************************************************
-// 極短いタイミング用タイマ
-//*****************************************************************************
-void lcd_nop(volatile int i) {
-    i = i * 15;
-    while (i--);
-}
-
 //*****************************************************************************
 // 終わり
 //*****************************************************************************
\ No newline at end of file
@@ -30,12 +30,25 @@
 #define LCD_INST            0x00        // インストラクション
 #define LCD_DATA            LCD_BIT_RS  // データ
 
+// PIO出力 (GPIO0-3:D4-D7, GPIO4:E, GPIO5:RS)
+#define LCD_PIN_BASE        0           // D4のGPIO番号
+#define LCD_PIN_E           4           // EのGPIO番号
+#define LCD_PIO_NIBBLE(x)   ((((x) & LCD_BIT_RS) << 1) | ((x) & 0x0f)) // 上記ビット配列→PIO出力
+#define LCD_STREAM_SIZE     (LCD_MAX_X * LCD_MAX_Y * 4) // 1回に送るニブル数の上限
+
+/*
+lcd_printfの書式 (浮動小数点は使わない)
+    %[+][0][幅]d    符号付き整数           %[幅]u  符号なし整数
+    %[+][0][幅].Nq  固定小数点 (整数値を10^Nで割った値として小数N桁で表示)
+    %c  文字    %s  文字列    %%  '%'
+*/
+
 //=============================================================================
 //プロトタイプ宣言
 //=============================================================================
 int  lcd_init(void);
 void lcd_process(void);
-int  lcd_printf(char *format, ...);
+int  lcd_printf(const char *format, ...);
 void lcd_position(char x, char y);
 
 #endif
@@ -0,0 +1,197 @@
+//*****************************************************************************
+// ファイル名       MotorControl.c
+// 対象マイコン     RP2040
+// ファイル内容     チョッパーモーター 速度制御 (シャッター周期のPI制御)
+//*****************************************************************************
+// シャッターの立ち上がり間隔から回転数を求め、PWMレベルをPI制御する。
+// 起動時は目標値を MOTOR_RAMP_RPM_PER_S で上げていき (ソフトスタート)、
+// 一定以上の出力でエッジが MOTOR_STALL_MS 来なければ出力を切って停止を知らせる。
+// タイマー割り込みから1ms毎に motor_process を呼ぶ。
+//=============================================================================
+//include
+//=============================================================================
+#include "Hal.h"
+#include "MotorControl.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+unsigned int    motor_pin;              // PWM出力ピン
+uint16_t        motor_wrap;             // PWMラップ値
+volatile MotorState motor_now;          // 状態 (メインループから参照)
+volatile uint32_t motor_target_rpm;     // 目標回転数 [rpm]
+uint32_t        motor_setpoint;         // ソフトスタート中の目標値 [rpm × 1000]
+volatile uint32_t motor_measured;       // 測定回転数 [rpm]
+volatile uint16_t motor_out;            // PWMレベル
+int32_t         motor_integ;            // 積分項 (Q16 PWMレベル)
+uint32_t        motor_last_rise;        // 前回見た立ち上がり数
+uint32_t        motor_edge_age;         // 最後の立ち上がりからの経過 [ms]
+uint32_t        motor_tick;             // 制御周期のカウンタ [ms]
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void motor_output(uint32_t level);
+static void motor_control(void);
+
+//*****************************************************************************
+// モーター制御 初期化
+//*****************************************************************************
+void motor_init(unsigned int pin, uint16_t wrap) {
+    motor_pin = pin;
+    motor_wrap = wrap;
+    motor_now = MOTOR_STOP;
+    motor_target_rpm = MOTOR_TARGET_RPM;
+    motor_setpoint = 0;
+    motor_measured = 0;
+    motor_integ = 0;
+    motor_last_rise = 0;
+    motor_edge_age = 0;
+    motor_tick = 0;
+
+    hal_pwm_init(pin, wrap);
+    motor_output(0);
+}
+
+//*****************************************************************************
+// 起動 (ソフトスタートから定速制御へ)
+//*****************************************************************************
+void motor_start(void) {
+    if (motor_now == MOTOR_SOFTSTART || motor_now == MOTOR_RUN) return;
+
+    motor_setpoint = 0;
+    motor_integ = 0;
+    motor_edge_age = 0;
+    motor_now = MOTOR_SOFTSTART;
+}
+
+//*****************************************************************************
+// 停止
+//*****************************************************************************
+void motor_stop(void) {
+    motor_now = MOTOR_STOP;
+    motor_integ = 0;
+    motor_output(0);
+}
+
+//*****************************************************************************
+// 目標回転数の設定 (範囲外は制限)
+//*****************************************************************************
+void motor_set_target(uint32_t rpm) {
+    if (rpm < MOTOR_RPM_MIN) rpm = MOTOR_RPM_MIN;
+    if (rpm > MOTOR_RPM_MAX) rpm = MOTOR_RPM_MAX;
+    motor_target_rpm = rpm;
+}
+
+//*****************************************************************************
+// PWMレベル固定で回す (開ループ, MOTOR_LEVEL_MAX で制限, 0は停止)
+//*****************************************************************************
+void motor_set_level(uint32_t level) {
+    if (level == 0) {
+        motor_stop();
+        return;
+    }
+    if (level > MOTOR_LEVEL_MAX) level = MOTOR_LEVEL_MAX;
+    if (motor_now != MOTOR_MANUAL) motor_edge_age = 0;
+    motor_integ = 0;
+    motor_now = MOTOR_MANUAL;
+    motor_output(level);
+}
+
+//*****************************************************************************
+// 1ms毎の処理 (rise_count: シャッター立ち上がりの累計, period_us: 直近の周期)
+//*****************************************************************************
+void motor_process(uint32_t rise_count, uint32_t period_us) {
+    uint32_t rpm, bound;
+
+    // 回転数: 直近の周期から求め、エッジが途絶えたら経過時間で上限を抑える
+    if (rise_count != motor_last_rise) {
+        motor_last_rise = rise_count;
+        motor_edge_age = 0;
+        rpm = (period_us > 0) ? 60000000u / (period_us * MOTOR_CYCLES_PER_REV) : 0;
+    } else {
+        motor_edge_age++;
+        rpm = motor_measured;
+        bound = 60000u / (motor_edge_age * MOTOR_CYCLES_PER_REV);
+        if (rpm > bound) rpm = bound;
+    }
+    motor_measured = rpm;
+
+    if (motor_now != MOTOR_SOFTSTART && motor_now != MOTOR_RUN && motor_now != MOTOR_MANUAL) return;
+
+    // 停止検出
+    if (motor_out >= MOTOR_STALL_LEVEL && motor_edge_age >= MOTOR_STALL_MS) {
+        motor_now = MOTOR_STALL;
+        motor_integ = 0;
+        motor_output(0);
+        return;
+    }
+
+    if (motor_now == MOTOR_MANUAL) return;
+    if (++motor_tick >= MOTOR_CONTROL_MS) {
+        motor_tick = 0;
+        motor_control();
+    }
+}
+
+//*****************************************************************************
+// PI制御 (MOTOR_CONTROL_MS毎)
+//*****************************************************************************
+static void motor_control(void) {
+    int32_t err, out;
+    uint32_t target = motor_target_rpm * 1000;
+
+    // ソフトスタート: 目標値を少しずつ上げる (目標を下げた時はすぐ従う)
+    if (motor_now == MOTOR_SOFTSTART) {
+        motor_setpoint += MOTOR_RAMP_RPM_PER_S * MOTOR_CONTROL_MS;
+        if (motor_setpoint >= target) motor_now = MOTOR_RUN;
+    }
+    if (motor_now == MOTOR_RUN || motor_setpoint > target) motor_setpoint = target;
+
+    err = (int32_t)(motor_setpoint / 1000) - (int32_t)motor_measured;
+
+    // 出力が上下限に張り付いている間は、さらに張り付く向きに積分しない
+    out = (MOTOR_KP * err + motor_integ) >> 16;
+    if (!((out >= MOTOR_LEVEL_MAX && err > 0) || (out <= 0 && err < 0))) {
+        motor_integ += MOTOR_KI * err;
+        if (motor_integ > (MOTOR_LEVEL_MAX << 16)) motor_integ = MOTOR_LEVEL_MAX << 16;
+        if (motor_integ < 0) motor_integ = 0;
+    }
+
+    out = (MOTOR_KP * err + motor_integ) >> 16;
+    if (out < 0) out = 0;
+    if (out > MOTOR_LEVEL_MAX) out = MOTOR_LEVEL_MAX;
+    motor_output((uint32_t)out);
+}
+
+//*****************************************************************************
+// PWM出力
+//*****************************************************************************
+static void motor_output(uint32_t level) {
+    if (level > motor_wrap) level = motor_wrap;
+    motor_out = (uint16_t)level;
+    hal_pwm_set_level(motor_pin, (uint16_t)level);
+}
+
+//*****************************************************************************
+// 状態の取得
+//*****************************************************************************
+MotorState motor_state(void) {
+    return motor_now;
+}
+
+uint32_t motor_rpm(void) {
+    return motor_measured;
+}
+
+uint32_t motor_target(void) {
+    return motor_target_rpm;
+}
+
+uint16_t motor_level(void) {
+    return motor_out;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
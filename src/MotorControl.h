@@ -0,0 +1,53 @@
+//*****************************************************************************
+// ファイル名       MotorControl.h
+// 対象マイコン     RP2040
+// ファイル内容     チョッパーモーター 速度制御 (シャッター周期のPI制御)
+//*****************************************************************************
+#ifndef MOTORCONTROL_H_
+#define MOTORCONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define MOTOR_CYCLES_PER_REV    4       // 1回転あたりのシャッター周期数 (羽根の枚数)
+#define MOTOR_TARGET_RPM        3000    // 目標回転数の初期値 [rpm] (シャッター200Hz)
+#define MOTOR_RPM_MIN           600     // 目標回転数の設定範囲 [rpm]
+#define MOTOR_RPM_MAX           6000
+#define MOTOR_RPM_STEP          100     // 目標回転数の変更幅 [rpm]
+#define MOTOR_CONTROL_MS        10      // 制御周期 [ms]
+#define MOTOR_RAMP_RPM_PER_S    2000    // ソフトスタートの目標値の上げ速度 [rpm/s]
+#define MOTOR_KP                0x1000  // 比例ゲイン (Q16, PWMレベル/rpm)
+#define MOTOR_KI                0x0300  // 積分ゲイン (Q16, PWMレベル/rpm/制御周期)
+#define MOTOR_LEVEL_MAX         2000    // PWMレベルの上限 (開ループ時代の650の約3倍)
+#define MOTOR_STALL_LEVEL       300     // この出力以上でエッジが来なければ停止とみなす
+#define MOTOR_STALL_MS          500     // 停止判定の時間 [ms]
+
+typedef enum {
+    MOTOR_STOP = 0,             // 停止
+    MOTOR_SOFTSTART,            // ソフトスタート中 (目標値を上げている)
+    MOTOR_RUN,                  // 定速制御中
+    MOTOR_STALL,                // 回転停止を検出して出力を切った
+    MOTOR_MANUAL,               // PWMレベル固定 (開ループ, 停止検出は有効)
+} MotorState;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void       motor_init(unsigned int pin, uint16_t wrap);
+void       motor_start(void);
+void       motor_stop(void);
+void       motor_set_target(uint32_t rpm);
+void       motor_set_level(uint32_t level);
+void       motor_process(uint32_t rise_count, uint32_t period_us);
+MotorState motor_state(void);
+uint32_t   motor_rpm(void);
+uint32_t   motor_target(void);
+uint16_t   motor_level(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,153 @@
+//*****************************************************************************
+// ファイル名       RawCapture.c
+// 対象マイコン     RP2040
+// ファイル内容     生サンプルのUSBキャプチャ
+//*****************************************************************************
+// DMA割り込みでサンプルをキューに積み、メインループで12ビットに詰めて送る。
+// 25kHzで約46kB/sとなり、USBフルスピードのCDCに十分収まる。
+// キュー満杯・テレメトリ満杯で捨てたサンプルは数えて次のフレームで知らせる。
+// フレームには先頭の通し番号が入るので、ホスト側でも欠落位置が分かる。
+// キューはブロック(ADC_BLOCK_SAMPLES)単位で積み、ブロック毎に通し番号を持つ。
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "AdcControl.h"
+#include "Telemetry.h"
+#include "RawCapture.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t            raw_queue_buff[RAW_QUEUE_SIZE];     // 送信待ちサンプル
+uint32_t            raw_block_index[RAW_QUEUE_BLOCKS];  // 各ブロック先頭のサンプル番号
+volatile uint32_t   raw_queue_wr;                       // 書き込み位置 (DMA割り込みのみ更新)
+volatile uint32_t   raw_queue_rd;                       // 読み出し位置 (メインループのみ更新)
+volatile uint32_t   raw_sample_index;                   // 次に届くサンプルの通し番号
+volatile uint32_t   raw_drop_count;                     // 捨てたサンプル数 (累計)
+volatile bool       f_raw_capture;                      // キャプチャ中フラグ
+
+//*****************************************************************************
+// 初期化
+//*****************************************************************************
+void raw_capture_init(void) {
+    raw_queue_wr = 0;
+    raw_queue_rd = 0;
+    raw_sample_index = 0;
+    raw_drop_count = 0;
+    f_raw_capture = false;
+}
+
+//*****************************************************************************
+// キャプチャ開始・停止
+//*****************************************************************************
+void raw_capture_enable(bool enable) {
+    uint32_t status = save_and_disable_interrupts();
+
+    if (enable && !f_raw_capture) {
+        // 前回の残りを捨てて、次のサンプルから始める
+        raw_queue_rd = raw_queue_wr;
+        raw_drop_count = 0;
+    }
+    f_raw_capture = enable;
+
+    restore_interrupts(status);
+}
+
+bool raw_capture_enabled(void) {
+    return f_raw_capture;
+}
+
+//*****************************************************************************
+// サンプル書き込み (DMA割り込みからADC_BLOCK_SAMPLES毎に呼ぶ)
+//*****************************************************************************
+void raw_capture_push(const uint32_t *samples, uint32_t count) {
+    uint32_t wr = raw_queue_wr;
+    uint32_t index = raw_sample_index;
+    uint32_t i;
+
+    // 通し番号はキャプチャしていない時も進める
+    raw_sample_index = index + count;
+    if (!f_raw_capture) return;
+
+    if (count != ADC_BLOCK_SAMPLES || RAW_QUEUE_SIZE - (wr - raw_queue_rd) < count) {
+        raw_drop_count += count;
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        raw_queue_buff[(wr + i) & (RAW_QUEUE_SIZE - 1)] = samples[i];
+    }
+    raw_block_index[(wr / ADC_BLOCK_SAMPLES) & (RAW_QUEUE_BLOCKS - 1)] = index;
+
+    __mem_fence_release();
+    raw_queue_wr = wr + count;
+}
+
+//*****************************************************************************
+// 取り込みの途切れ (ADCを止めていた間のサンプル数)
+// 通し番号を進め、キャプチャ中なら捨てたサンプルとして数える。
+//*****************************************************************************
+void raw_capture_gap(uint32_t count) {
+    uint32_t status = save_and_disable_interrupts();
+
+    raw_sample_index += count;
+    if (f_raw_capture) raw_drop_count += count;
+
+    restore_interrupts(status);
+}
+
+//*****************************************************************************
+// フレーム送信 (メインループから呼ぶ)
+// 2ブロック溜まる毎に1フレーム送る。間で欠落していれば1ブロックだけ送る。
+//*****************************************************************************
+void raw_capture_process(void) {
+    static uint32_t samples[RAW_FRAME_SAMPLES];
+    uint8_t payload[TELEMETRY_RAW_SIZE(RAW_FRAME_SAMPLES)];
+    TelemetryRawHeader h;
+    uint32_t rd, block, count, i;
+    uint32_t status;
+
+    while (f_raw_capture) {
+        rd = raw_queue_rd;
+        if (raw_queue_wr - rd < RAW_FRAME_SAMPLES) return;
+        __mem_fence_acquire();
+
+        // 連続しているブロックだけを1フレームにまとめる
+        block = rd / ADC_BLOCK_SAMPLES;
+        h.first_index = raw_block_index[block & (RAW_QUEUE_BLOCKS - 1)];
+        for (count = ADC_BLOCK_SAMPLES; count < RAW_FRAME_SAMPLES; count += ADC_BLOCK_SAMPLES) {
+            block++;
+            if (raw_block_index[block & (RAW_QUEUE_BLOCKS - 1)] != h.first_index + count) break;
+        }
+
+        for (i = 0; i < count; i++) {
+            samples[i] = raw_queue_buff[(rd + i) & (RAW_QUEUE_SIZE - 1)];
+        }
+        raw_queue_rd = rd + count;
+
+        h.dropped = raw_drop_count;
+        h.sample_rate_hz = ADC_SAMPLE_FREQ_HZ;
+        h.count = (uint8_t)count;
+        telemetry_pack_raw(payload, &h, samples);
+
+        // 送れなかったフレームも捨てたサンプルとして数える
+        if (!telemetry_send(TELEMETRY_TYPE_RAW, payload, TELEMETRY_RAW_SIZE(count))) {
+            status = save_and_disable_interrupts();
+            raw_drop_count += count;
+            restore_interrupts(status);
+        }
+    }
+}
+
+//*****************************************************************************
+// 捨てたサンプル数 (累計)
+//*****************************************************************************
+uint32_t raw_capture_dropped(void) {
+    return raw_drop_count;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,35 @@
+//*****************************************************************************
+// ファイル名       RawCapture.h
+// 対象マイコン     RP2040
+// ファイル内容     生サンプルのUSBキャプチャ
+//*****************************************************************************
+#ifndef RAWCAPTURE_H_
+#define RAWCAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AdcControl.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define RAW_QUEUE_SIZE          2048        // 送信待ちサンプル数 (2のべき乗, 25kHzで約80ms分)
+#define RAW_QUEUE_BLOCKS        (RAW_QUEUE_SIZE / ADC_BLOCK_SAMPLES)
+#define RAW_FRAME_SAMPLES       128         // 1フレームのサンプル数 (ADC_BLOCK_SAMPLESの倍数,
+                                            //  TELEMETRY_RAW_MAX_SAMPLES以下)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     raw_capture_init(void);
+void     raw_capture_enable(bool enable);
+bool     raw_capture_enabled(void);
+void     raw_capture_push(const uint32_t *samples, uint32_t count);
+void     raw_capture_gap(uint32_t count);
+void     raw_capture_process(void);
+uint32_t raw_capture_dropped(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
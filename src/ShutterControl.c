@@ -0,0 +1,144 @@
+//*****************************************************************************
+// ファイル名       ShutterControl.c
+// 対象マイコン     RP2040
+// ファイル内容     シャッター位置検出センサー エッジ記録ライブラリ (PIO + DMA)
+//*****************************************************************************
+// PIOがエッジ後のレベルをRX FIFOへ送り、DMA(レベル)→DMA(タイマ値)の順に
+// チェインしてリングバッファへ記録する。エッジ毎のCPU処理は無い。
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "ShutterControl.h"
+#include "ShutterEdge.pio.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define SHUTTER_EDGE_RING_BITS  8   // リングバッファのバイト数 (2^8 = 4byte x 64)
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint32_t shutter_edge_time[SHUTTER_EDGE_BUFF_SIZE]
+    __attribute__((aligned(1 << SHUTTER_EDGE_RING_BITS)));     // エッジ時刻 [us]
+uint32_t shutter_edge_level[SHUTTER_EDGE_BUFF_SIZE]
+    __attribute__((aligned(1 << SHUTTER_EDGE_RING_BITS)));     // エッジ後のレベル
+int      shutter_dma_level;                                     // レベル記録用DMA
+int      shutter_dma_time;                                      // 時刻記録用DMA
+uint32_t shutter_edge_rd;                                       // 読み出し位置
+bool     shutter_now_level;                                     // 読み出し済みエッジ後のレベル
+uint32_t shutter_rise_time;                                     // 最後の立ち上がり時刻 [us]
+volatile uint32_t shutter_rise_count;                           // 立ち上がりの累計
+volatile uint32_t shutter_rise_period;                          // 直近の立ち上がり間隔 [us]
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static uint32_t shutter_edge_wr(void);
+
+//*****************************************************************************
+// シャッターエッジ記録 初期化
+//*****************************************************************************
+void shutter_init(unsigned int pin) {
+    PIO pio = pio0;
+    uint sm = pio_claim_unused_sm(pio, true);
+    uint offset = pio_add_program(pio, &shutter_edge_program);
+    dma_channel_config c;
+
+    shutter_edge_rd = 0;
+    shutter_now_level = gpio_get(pin);
+    shutter_rise_time = 0;
+    shutter_rise_count = 0;
+    shutter_rise_period = 0;
+
+    shutter_dma_level = dma_claim_unused_channel(true);
+    shutter_dma_time = dma_claim_unused_channel(true);
+
+    // RX FIFO → レベルリング (PIOのDREQで1ワード毎)
+    c = dma_channel_get_default_config(shutter_dma_level);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, SHUTTER_EDGE_RING_BITS);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+    channel_config_set_chain_to(&c, shutter_dma_time);
+    dma_channel_configure(shutter_dma_level, &c, shutter_edge_level, &pio->rxf[sm], 1, false);
+
+    // タイマ値 → 時刻リング (レベル転送の直後に起動)
+    c = dma_channel_get_default_config(shutter_dma_time);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, SHUTTER_EDGE_RING_BITS);
+    channel_config_set_chain_to(&c, shutter_dma_level);
+    dma_channel_configure(shutter_dma_time, &c, shutter_edge_time, &timer_hw->timerawl, 1, false);
+
+    dma_channel_start(shutter_dma_level);
+    shutter_edge_program_init(pio, sm, offset, pin);
+}
+
+//*****************************************************************************
+// 未処理の最古エッジを取得 (エッジが無ければfalse)
+//*****************************************************************************
+bool shutter_edge_peek(uint32_t *time_us, bool *level) {
+    uint32_t rd = shutter_edge_rd;
+
+    if (rd == shutter_edge_wr()) return false;
+
+    *time_us = shutter_edge_time[rd];
+    *level = shutter_edge_level[rd] & 0x01;
+    return true;
+}
+
+//*****************************************************************************
+// 最古エッジを読み捨て (立ち上がりなら間隔を記録)
+//*****************************************************************************
+void shutter_edge_pop(void) {
+    uint32_t rd = shutter_edge_rd;
+
+    if (rd == shutter_edge_wr()) return;
+
+    shutter_now_level = shutter_edge_level[rd] & 0x01;
+    if (shutter_now_level) {
+        if (shutter_rise_count > 0) shutter_rise_period = shutter_edge_time[rd] - shutter_rise_time;
+        shutter_rise_time = shutter_edge_time[rd];
+        shutter_rise_count++;
+    }
+    shutter_edge_rd = (rd + 1) & (SHUTTER_EDGE_BUFF_SIZE - 1);
+}
+
+//*****************************************************************************
+// 読み出し済みエッジ時点のシャッター状態
+//*****************************************************************************
+bool shutter_level(void) {
+    return shutter_now_level;
+}
+
+//*****************************************************************************
+// 立ち上がりの累計と直近の間隔 [us] (モーターの速度制御用)
+//*****************************************************************************
+void shutter_rise(uint32_t *count, uint32_t *period_us) {
+    uint32_t status = save_and_disable_interrupts();
+
+    *count = shutter_rise_count;
+    *period_us = shutter_rise_period;
+    restore_interrupts(status);
+}
+
+//*****************************************************************************
+// 書き込み位置 (時刻記録DMAの書き込み先から求める)
+//*****************************************************************************
+static uint32_t shutter_edge_wr(void) {
+    uint32_t addr = dma_channel_hw_addr(shutter_dma_time)->write_addr;
+
+    return ((addr - (uint32_t)(uintptr_t)shutter_edge_time) / sizeof(uint32_t)) & (SHUTTER_EDGE_BUFF_SIZE - 1);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
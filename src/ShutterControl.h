@@ -0,0 +1,29 @@
+//*****************************************************************************
+// ファイル名       ShutterControl.h
+// 対象マイコン     RP2040
+// ファイル内容     シャッター位置検出センサー エッジ記録ライブラリ (PIO + DMA)
+//*****************************************************************************
+#ifndef SHUTTERCONTROL_H_
+#define SHUTTERCONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define SHUTTER_EDGE_BUFF_SIZE  64          // エッジ記録バッファ数 (2のべき乗)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void shutter_init(unsigned int pin);
+bool shutter_edge_peek(uint32_t *time_us, bool *level);
+void shutter_edge_pop(void);
+bool shutter_level(void);
+void shutter_rise(uint32_t *count, uint32_t *period_us);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,244 @@
+//*****************************************************************************
+// ファイル名       Statistics.c
+// 対象マイコン     RP2040
+// ファイル内容     表面電位の統計 (平均・標準偏差・最小・最大, 移動区間とリセット後)
+//*****************************************************************************
+// 計測結果は STATS_BUCKET_MS 毎の区切りに整数で積算する (区切りの最初の値からの
+// 差の和と二乗和, 最小・最大)。計測毎の処理はこれだけで、区切りの終わりに
+// 平均と偏差平方和に直してリングへ入れる。移動区間とリセット後の統計は区切りを
+// 終える時 (1秒毎) に偏差平方和の合成 (Chan の並列版 Welford) で求め直す。
+// 合成は区切り毎に1回なので浮動小数点 (ソフトウェア) でも負荷は無視できる。
+//=============================================================================
+//include
+//=============================================================================
+#include <stddef.h>
+#include <math.h>
+#include "Statistics.h"
+
+//=============================================================================
+//シンボル定義(ローカル)
+//=============================================================================
+// 区切り・合成途中の統計
+typedef struct {
+    uint32_t count;
+    int32_t  min;
+    int32_t  max;
+    double   mean;
+    double   m2;                // 偏差平方和
+} StatsBucket;
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+StatsBucket stats_ring[STATS_BUCKETS];      // 終わった区切り (古いものから上書き)
+uint32_t    stats_head;                     // 次に入れる位置
+uint32_t    stats_filled;                   // 入っている区切りの数
+
+// 今の区切り (計測毎に更新, 整数で正確に積算)
+uint32_t    stats_count;
+int32_t     stats_ref;                      // 区切りの最初の値
+int64_t     stats_sum;                      // 最初の値からの差の和
+int64_t     stats_sum_sq;                   // 最初の値からの差の二乗和
+int32_t     stats_min;
+int32_t     stats_max;
+uint32_t    stats_start_ms;                 // 区切りの開始時刻
+bool        stats_started;
+
+StatsBucket stats_total;                    // リセット後 (終わった区切りの合成)
+StatsWindow stats_window_now = STATS_WINDOW_1MIN;
+StatsSummary stats_rolling_summary;         // 移動区間の結果 (区切り毎に更新)
+StatsSummary stats_total_summary;           // リセット後の結果 (区切り毎に更新)
+uint32_t    stats_update_seq;               // 結果の更新回数
+
+const uint32_t stats_window_sec[STATS_WINDOW_NUM] = {10, 60, 600};
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void stats_close(void);
+static void stats_merge(StatsBucket *a, const StatsBucket *b);
+static void stats_summary(StatsSummary *s, const StatsBucket *b);
+static void stats_update(void);
+
+//*****************************************************************************
+// 統計 初期化
+//*****************************************************************************
+void stats_init(void) {
+    stats_head = 0;
+    stats_filled = 0;
+    stats_count = 0;
+    stats_started = false;
+    stats_total.count = 0;
+    stats_update();
+}
+
+//*****************************************************************************
+// 計測結果を渡す (計測毎)
+//*****************************************************************************
+void stats_add(int32_t potential_mv) {
+    int64_t d;
+
+    if (stats_count == 0) {
+        stats_ref = potential_mv;
+        stats_min = potential_mv;
+        stats_max = potential_mv;
+    }
+    d = (int64_t)potential_mv - stats_ref;
+    stats_sum += d;
+    stats_sum_sq += d * d;
+    if (potential_mv < stats_min) stats_min = potential_mv;
+    if (potential_mv > stats_max) stats_max = potential_mv;
+    stats_count++;
+}
+
+//*****************************************************************************
+// 時刻を渡す (メインループから, 区切りの終わりで統計を求め直す)
+//*****************************************************************************
+void stats_tick(uint32_t now_ms) {
+    uint32_t n = 0;
+
+    if (!stats_started) {
+        stats_start_ms = now_ms;
+        stats_started = true;
+        return;
+    }
+    if (now_ms - stats_start_ms < STATS_BUCKET_MS) return;
+
+    // 止まっていた間の区切りは空で埋める (全部埋まったら時刻を合わせ直す)
+    while (now_ms - stats_start_ms >= STATS_BUCKET_MS) {
+        stats_close();
+        stats_start_ms += STATS_BUCKET_MS;
+        if (++n >= STATS_BUCKETS) {
+            stats_start_ms = now_ms;
+            break;
+        }
+    }
+    stats_update();
+}
+
+//*****************************************************************************
+// リセット後の統計をやり直す (移動区間はそのまま)
+//*****************************************************************************
+void stats_reset(void) {
+    stats_total.count = 0;
+    stats_update();
+}
+
+//*****************************************************************************
+// 移動区間の選択
+//*****************************************************************************
+void stats_set_window(StatsWindow window) {
+    if ((unsigned int)window >= STATS_WINDOW_NUM) return;
+    stats_window_now = window;
+    stats_update();
+}
+
+StatsWindow stats_window(void) {
+    return stats_window_now;
+}
+
+uint32_t stats_window_seconds(StatsWindow window) {
+    return (unsigned int)window < STATS_WINDOW_NUM ? stats_window_sec[window] : 0;
+}
+
+//*****************************************************************************
+// 結果 (移動区間・リセット後, どちらもNULL可)
+//*****************************************************************************
+void stats_get(StatsSummary *rolling, StatsSummary *total) {
+    if (rolling != NULL) *rolling = stats_rolling_summary;
+    if (total != NULL) *total = stats_total_summary;
+}
+
+//*****************************************************************************
+// 結果の更新回数 (表示の更新判定用)
+//*****************************************************************************
+uint32_t stats_seq(void) {
+    return stats_update_seq;
+}
+
+//=============================================================================
+// ローカル関数
+//=============================================================================
+//*****************************************************************************
+// 今の区切りを終えてリングへ入れる (リセット後の統計にも加える)
+//*****************************************************************************
+static void stats_close(void) {
+    StatsBucket *b = &stats_ring[stats_head];
+
+    b->count = stats_count;
+    if (stats_count > 0) {
+        b->min = stats_min;
+        b->max = stats_max;
+        b->mean = stats_ref + (double)stats_sum / stats_count;
+        b->m2 = (double)stats_sum_sq - (double)stats_sum * (double)stats_sum / stats_count;
+        if (b->m2 < 0) b->m2 = 0;
+    }
+    stats_merge(&stats_total, b);
+
+    stats_head = (stats_head + 1) % STATS_BUCKETS;
+    if (stats_filled < STATS_BUCKETS) stats_filled++;
+    stats_count = 0;
+    stats_sum = 0;
+    stats_sum_sq = 0;
+}
+
+//*****************************************************************************
+// 統計の合成 (a に b を加える)
+//*****************************************************************************
+static void stats_merge(StatsBucket *a, const StatsBucket *b) {
+    double delta, n;
+
+    if (b->count == 0) return;
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    n = (double)a->count + b->count;
+    delta = b->mean - a->mean;
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((double)a->count * b->count / n);
+    if (b->min < a->min) a->min = b->min;
+    if (b->max > a->max) a->max = b->max;
+    a->count += b->count;
+}
+
+//*****************************************************************************
+// 表示・送信用の結果に直す
+//*****************************************************************************
+static void stats_summary(StatsSummary *s, const StatsBucket *b) {
+    s->count = b->count;
+    if (b->count == 0) {
+        s->mean_mv = 0;
+        s->stddev_mv = 0;
+        s->min_mv = 0;
+        s->max_mv = 0;
+        return;
+    }
+    s->mean_mv = (int32_t)lround(b->mean);
+    s->stddev_mv = b->count > 1 ? (uint32_t)lround(sqrt(b->m2 / (b->count - 1))) : 0;
+    s->min_mv = b->min;
+    s->max_mv = b->max;
+}
+
+//*****************************************************************************
+// 移動区間・リセット後の結果を求め直す (区切り毎, 最大 STATS_BUCKETS 個の合成)
+//*****************************************************************************
+static void stats_update(void) {
+    StatsBucket acc;
+    uint32_t i, n;
+
+    n = stats_window_sec[stats_window_now] * 1000 / STATS_BUCKET_MS;
+    if (n > stats_filled) n = stats_filled;
+
+    acc.count = 0;
+    for (i = 1; i <= n; i++) {
+        stats_merge(&acc, &stats_ring[(stats_head + STATS_BUCKETS - i) % STATS_BUCKETS]);
+    }
+    stats_summary(&stats_rolling_summary, &acc);
+    stats_summary(&stats_total_summary, &stats_total);
+    stats_update_seq++;
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,51 @@
+//*****************************************************************************
+// ファイル名       Statistics.h
+// 対象マイコン     RP2040
+// ファイル内容     表面電位の統計 (平均・標準偏差・最小・最大, 移動区間とリセット後)
+//*****************************************************************************
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define STATS_BUCKET_MS         1000        // 1区切りの長さ [ms] (移動区間の統計はこの単位で更新)
+#define STATS_BUCKETS           600         // 保持する区切りの数 (最長の移動区間 10分)
+
+// 移動区間
+typedef enum {
+    STATS_WINDOW_10S = 0,
+    STATS_WINDOW_1MIN,
+    STATS_WINDOW_10MIN,
+    STATS_WINDOW_NUM
+} StatsWindow;
+
+// 統計の結果 (count = 0 なら他は0)
+typedef struct {
+    uint32_t count;             // 計測結果の数
+    int32_t  mean_mv;           // 平均 [mV]
+    uint32_t stddev_mv;         // 標準偏差 [mV] (不偏)
+    int32_t  min_mv;            // 最小 [mV]
+    int32_t  max_mv;            // 最大 [mV]
+} StatsSummary;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void        stats_init(void);
+void        stats_add(int32_t potential_mv);
+void        stats_tick(uint32_t now_ms);
+void        stats_reset(void);
+void        stats_set_window(StatsWindow window);
+StatsWindow stats_window(void);
+uint32_t    stats_window_seconds(StatsWindow window);
+void        stats_get(StatsSummary *rolling, StatsSummary *total);
+uint32_t    stats_seq(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
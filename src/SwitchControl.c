@@ -6,7 +6,7 @@
 //=============================================================================
 //include
 //=============================================================================
-#include "hardware/gpio.h"
+#include "Hal.h"
 #include "SwitchControl.h"
 
 //=============================================================================
@@ -45,11 +45,11 @@ void switch_init(void) {
 unsigned int get_sw_now(void) {
     unsigned char sw = 0;
 
-    sw = gpio_get(14);           // SW_0 (SWITCH_PIN_5)
-    sw |= (gpio_get(13) << 1);   // SW_1 (SWITCH_PIN_4)
-    sw |= (gpio_get(12) << 2);   // SW_2 (SWITCH_PIN_3)
-    sw |= (gpio_get(11) << 3);   // SW_3 (SWITCH_PIN_2)
-    sw |= (gpio_get(10) << 4);   // SW_4 (SWITCH_PIN_1)
+    sw = hal_gpio_get(14);           // SW_0 (SWITCH_PIN_5)
+    sw |= (hal_gpio_get(13) << 1);   // SW_1 (SWITCH_PIN_4)
+    sw |= (hal_gpio_get(12) << 2);   // SW_2 (SWITCH_PIN_3)
+    sw |= (hal_gpio_get(11) << 3);   // SW_3 (SWITCH_PIN_2)
+    sw |= (hal_gpio_get(10) << 4);   // SW_4 (SWITCH_PIN_1)
 
     return (~sw) & 0x1f;         // LOWでON、5ビットのみ有効
 }
@@ -0,0 +1,390 @@
+//*****************************************************************************
+// ファイル名       SyncDemod.c
+// 対象マイコン     RP2040
+// ファイル内容     同期検波処理
+//*****************************************************************************
+//=============================================================================
+//include
+//=============================================================================
+#include "SyncDemod.h"
+#include "AdcControl.h"
+
+//=============================================================================
+//プロトタイプ宣言(ローカル)
+//=============================================================================
+static void sync_demod_restart(SyncDemodState *s);
+static void sync_demod_push(SyncDemodState *s);
+static void sync_demod_adapt(SyncDemodState *s);
+static void sync_demod_track_dc(SyncDemodState *s);
+static int64_t sync_demod_zero(const SyncDemodState *s, int64_t sum, int32_t bal);
+static void sync_demod_result(SyncDemodState *s, DemodResult *result);
+static uint16_t sync_demod_phase(int32_t i, int32_t q);
+
+//*****************************************************************************
+// 同期検波 状態初期化
+//*****************************************************************************
+void sync_demod_init(SyncDemodState *s) {
+    uint32_t n;
+
+    for (n = 0; n < DEMOD_PART_RING_SIZE; n++) {
+        s->part[n].i_sum = 0;
+        s->part[n].q_sum = 0;
+        s->part[n].dc_sum = 0;
+        s->part[n].i_bal = 0;
+        s->part[n].q_bal = 0;
+        s->part[n].sample_count = 0;
+    }
+    s->cur = s->part[0];
+    s->part_head = 0;
+    s->part_valid = false;
+    s->rise_valid = false;
+    s->gap = false;
+    s->shutter_count = 0;
+    s->sample_count = 0;
+    s->i_sum = 0;
+    s->q_sum = 0;
+    s->i_bal = 0;
+    s->q_bal = 0;
+    s->dc_base = 0;
+    s->dc_count = 0;
+    s->phase = 0;
+    s->phase_step = 0;
+    s->rise_interval = 0;
+    s->rise_lag = 0;
+    s->sign = 1;
+    s->prev_shutter_state = false;
+    s->window = SHUTTER_CYCLE_THRESHOLD;
+    s->fixed_window = SHUTTER_CYCLE_THRESHOLD;
+    s->adaptive = false;
+    s->stats_valid = false;
+    s->cycle_mean = 0;
+    s->cycle_var = 0;
+    s->step_count = 0;
+    s->sample_hz = ADC_SAMPLE_FREQ_HZ;
+}
+
+//*****************************************************************************
+// 適応窓の切り替え (固定に戻すと次のエッジで fixed_window まで縮める)
+//*****************************************************************************
+void sync_demod_set_adaptive(SyncDemodState *s, bool adaptive) {
+    if (adaptive == s->adaptive) return;
+
+    s->adaptive = adaptive;
+    s->stats_valid = false;
+    s->step_count = 0;
+    if (!adaptive) s->window = s->fixed_window;
+}
+
+//*****************************************************************************
+// 固定窓の長さ (半周期数, DEMOD_WINDOW_MIN～DEMOD_WINDOW_MAXに制限)
+// 伸ばした時は区間が溜まるまで結果を出さない
+//*****************************************************************************
+void sync_demod_set_window(SyncDemodState *s, uint32_t window) {
+    if (window < DEMOD_WINDOW_MIN) window = DEMOD_WINDOW_MIN;
+    if (window > DEMOD_WINDOW_MAX) window = DEMOD_WINDOW_MAX;
+    if (window == s->fixed_window) return;
+
+    s->fixed_window = window;
+    if (!s->adaptive) s->window = window;
+}
+
+//*****************************************************************************
+// サンプル列の直交(I/Q)同期検波
+// 参照信号はシャッターのエッジ時刻(サンプル未満の精度)で位相を合わせ、
+// エッジ間は実測周期で位相を進める。
+// エッジ間(半周期)ごとの部分和をリングに積み、エッジのたびに直近
+// window 区間の合計から平均を出す (スライディング窓)。
+// 合計は入る区間を足し出る区間を引いて更新するので、1エッジあたりO(1)。
+// 適応窓では窓が育つ途中でも DEMOD_WINDOW_MIN 区間から出力する。
+// 直流オフセットは参照の +1/-1 の数の差だけ残るので、区間ごとにその差を数えておき、
+// 1周期の単純和から追従したオフセットを結果の計算時に差し引く (自動ゼロ)。
+// 取り込みが途切れた印 (ADC_SAMPLE_GAP_BIT) のサンプルは使わず、窓を空にして
+// 次のエッジから積み直す。
+// 結果が出た時点で処理を止めてtrueを返す (consumedに処理済みサンプル数)
+//*****************************************************************************
+bool sync_demod_process(SyncDemodState *s, const uint32_t *samples, uint32_t count,
+                        uint32_t *consumed, DemodResult *result) {
+    uint32_t i, next, p, lag;
+    uint64_t interval;
+    bool ready = false;
+
+    for (i = 0; i < count; i++) {
+        // ADC値とシャッター状態を取得
+        int32_t adc_value = (samples[i] & ADC_SAMPLE_VALUE_MASK) - ADC_MID_VALUE;
+        bool shutter_open = (samples[i] & ADC_SAMPLE_SHUTTER_BIT) != 0;
+
+        // 途切れの間のエッジは分からないので、状態だけ追って次のエッジを待つ
+        if (samples[i] & ADC_SAMPLE_GAP_BIT) {
+            sync_demod_restart(s);
+            s->prev_shutter_state = shutter_open;
+            continue;
+        }
+
+        // シャッター状態変化で参照位相を同期 (エッジからの遅れ分だけ位相を進めておく)
+        s->rise_interval++;
+        if (shutter_open != s->prev_shutter_state) {
+            // 直前の半周期を閉じて窓を1区間進める (起動直後の端数区間は捨てる)
+            if (s->part_valid) {
+                sync_demod_push(s);
+                ready = (s->shutter_count >= (s->adaptive ? DEMOD_WINDOW_MIN : s->window));
+            }
+            s->cur.i_sum = 0;
+            s->cur.q_sum = 0;
+            s->cur.dc_sum = 0;
+            s->cur.i_bal = 0;
+            s->cur.q_bal = 0;
+            s->cur.sample_count = 0;
+            s->part_valid = true;
+            s->prev_shutter_state = shutter_open;
+            lag = (samples[i] & ADC_SAMPLE_EDGE_BIT) ? (samples[i] >> ADC_SAMPLE_LAG_SHIFT) : 0;
+            if (shutter_open) {
+                // 実測1周期 (Q16サンプル) から位相増分を更新
+                interval = ((uint64_t)s->rise_interval << 16) + s->rise_lag - lag;
+                if (s->rise_valid && interval >= ((uint64_t)DEMOD_MIN_PERIOD << 16)) {
+                    s->phase_step = (uint32_t)((1ull << 48) / interval);
+                }
+                s->rise_valid = true;
+                s->rise_interval = 0;
+                s->rise_lag = lag;
+                s->phase = (uint32_t)(((uint64_t)lag * s->phase_step) >> 16);
+            } else {
+                s->phase = DEMOD_PHASE_HALF + (uint32_t)(((uint64_t)lag * s->phase_step) >> 16);
+            }
+        }
+
+        // 矩形参照による同相・直交検波 (加減算のみ)
+        p = s->phase + DEMOD_PHASE_OFFSET;
+        s->cur.dc_sum += adc_value;
+        if (p < DEMOD_PHASE_HALF) {
+            s->cur.i_sum += adc_value;
+            s->cur.i_bal++;
+        } else {
+            s->cur.i_sum -= adc_value;
+            s->cur.i_bal--;
+        }
+        if (p - DEMOD_PHASE_QUARTER < DEMOD_PHASE_HALF) {
+            s->cur.q_sum += adc_value;
+            s->cur.q_bal++;
+        } else {
+            s->cur.q_sum -= adc_value;
+            s->cur.q_bal--;
+        }
+        s->cur.sample_count++;
+
+        // 半周期を越えて進めず、次のエッジを待つ
+        next = s->phase + s->phase_step;
+        if (!((next ^ s->phase) & DEMOD_PHASE_HALF)) s->phase = next;
+
+        // エッジごとに窓内の平均値を出力
+        if (ready) {
+            sync_demod_result(s, result);
+            *consumed = i + 1;
+            return true;
+        }
+    }
+
+    *consumed = count;
+    return false;
+}
+
+//*****************************************************************************
+// 取り込みの途切れ: 窓を空にして、1周期値の統計も取り直す
+// (直流オフセット・位相増分は途切れの前後で変わらないので残す)
+//*****************************************************************************
+static void sync_demod_restart(SyncDemodState *s) {
+    s->part_valid = false;
+    s->rise_valid = false;
+    s->shutter_count = 0;
+    s->sample_count = 0;
+    s->i_sum = 0;
+    s->q_sum = 0;
+    s->i_bal = 0;
+    s->q_bal = 0;
+    s->stats_valid = false;
+    s->step_count = 0;
+    s->gap = true;
+}
+
+//*****************************************************************************
+// 閉じた半周期の部分和をリングに積み、窓の合計を更新する
+//*****************************************************************************
+static void sync_demod_push(SyncDemodState *s) {
+    DemodPartial *old;
+
+    s->part[s->part_head & (DEMOD_PART_RING_SIZE - 1)] = s->cur;
+    s->part_head++;
+    s->i_sum += s->cur.i_sum;
+    s->q_sum += s->cur.q_sum;
+    s->i_bal += s->cur.i_bal;
+    s->q_bal += s->cur.q_bal;
+    s->sample_count += s->cur.sample_count;
+    s->shutter_count++;
+
+    sync_demod_track_dc(s);
+    if (s->adaptive) sync_demod_adapt(s);
+
+    // 窓からはみ出た古い区間を合計から引く (通常1区間, 縮める時だけ複数)
+    while (s->shutter_count > s->window) {
+        old = &s->part[(s->part_head - s->shutter_count) & (DEMOD_PART_RING_SIZE - 1)];
+        s->i_sum -= old->i_sum;
+        s->q_sum -= old->q_sum;
+        s->i_bal -= old->i_bal;
+        s->q_bal -= old->q_bal;
+        s->sample_count -= old->sample_count;
+        s->shutter_count--;
+    }
+}
+
+//*****************************************************************************
+// 適応窓の長さを更新
+// 直近1周期 (半周期2区間) の同相成分を1周期値とし、その平均と分散を追う。
+// 窓平均のばらつき sqrt(2*分散/窓長) が目標 (信号の1/128か0.25 ADC値の大きい方)
+// 以下になる長さへ1区間ずつ近づける。1周期値が平均から DEMOD_STEP_SIGMA 倍の
+// 標準偏差を続けて外れたらステップとみなし、窓を最小まで縮めて追従させる。
+//*****************************************************************************
+static void sync_demod_adapt(SyncDemodState *s) {
+    const DemodPartial *a, *b;
+    int32_t cycle, dev, target;
+    int64_t dev2, limit;
+    uint64_t need;
+
+    if (s->shutter_count < 2) return;
+
+    a = &s->part[(s->part_head - 1) & (DEMOD_PART_RING_SIZE - 1)];
+    b = &s->part[(s->part_head - 2) & (DEMOD_PART_RING_SIZE - 1)];
+    cycle = (int32_t)(sync_demod_zero(s, a->i_sum + b->i_sum, a->i_bal + b->i_bal)
+                      / (int32_t)(a->sample_count + b->sample_count));
+
+    if (!s->stats_valid) {
+        s->cycle_mean = cycle;
+        s->cycle_var = 0;
+        s->stats_valid = true;
+        return;
+    }
+
+    dev = cycle - s->cycle_mean;
+    dev2 = (int64_t)dev * dev;
+    limit = s->cycle_var * (DEMOD_STEP_SIGMA * DEMOD_STEP_SIGMA)
+          + (int64_t)DEMOD_STEP_FLOOR * DEMOD_STEP_FLOOR;
+
+    // 外れ値は上限で抑えて分散へ入れる (初期値0からでも数周期で立ち上がる)
+    if (dev2 > limit) {
+        s->cycle_var += (limit - s->cycle_var) >> DEMOD_STATS_SHIFT;
+        if (++s->step_count >= DEMOD_STEP_COUNT) {
+            s->cycle_mean = cycle;
+            s->step_count = 0;
+            s->window = DEMOD_WINDOW_MIN;
+        }
+        return;
+    }
+    s->step_count = 0;
+    s->cycle_mean += dev / (1 << DEMOD_STATS_SHIFT);
+    s->cycle_var += (dev2 - s->cycle_var) >> DEMOD_STATS_SHIFT;
+
+    // 目標のばらつきに必要な窓長
+    target = (s->cycle_mean < 0 ? -s->cycle_mean : s->cycle_mean) >> DEMOD_NOISE_REL_SHIFT;
+    if (target < DEMOD_NOISE_ABS) target = DEMOD_NOISE_ABS;
+    need = (uint64_t)(2 * s->cycle_var) / ((uint64_t)target * target);
+
+    if (need > s->window && s->window < DEMOD_WINDOW_MAX) {
+        s->window++;
+    } else if (need < s->window && s->window > DEMOD_WINDOW_MIN) {
+        s->window--;
+    }
+}
+
+//*****************************************************************************
+// 直流オフセットの追従
+// 1周期 (直近の半周期2区間) の単純和では信号の交流分が打ち消し合い、
+// 直流分だけが残る。これをゆっくり平均して長期の基準値とする
+// (起動直後は 1/n の単純平均で速く立ち上げ、1/2^DEMOD_DC_SHIFT で止める)。
+//*****************************************************************************
+static void sync_demod_track_dc(SyncDemodState *s) {
+    const DemodPartial *a, *b;
+    int32_t dc;
+
+    if (s->shutter_count < 2) return;
+
+    a = &s->part[(s->part_head - 1) & (DEMOD_PART_RING_SIZE - 1)];
+    b = &s->part[(s->part_head - 2) & (DEMOD_PART_RING_SIZE - 1)];
+    dc = (int32_t)(((a->dc_sum + b->dc_sum) * 65536) / (int32_t)(a->sample_count + b->sample_count));
+
+    if (s->dc_count < (1u << DEMOD_DC_SHIFT)) s->dc_count++;
+    s->dc_base += (dc - s->dc_base) / (int32_t)s->dc_count;
+}
+
+//*****************************************************************************
+// 検波の積算値から直流オフセット分を差し引く (戻り値はQ8)
+//*****************************************************************************
+static int64_t sync_demod_zero(const SyncDemodState *s, int64_t sum, int32_t bal) {
+    return sum * (1 << DEMOD_FRAC_BITS)
+         - (((int64_t)s->dc_base * bal) >> (16 - DEMOD_FRAC_BITS));
+}
+
+//*****************************************************************************
+// 窓内の合計から検波結果を計算
+//*****************************************************************************
+static void sync_demod_result(SyncDemodState *s, DemodResult *result) {
+    int64_t zero_i = sync_demod_zero(s, s->i_sum, s->i_bal);
+    int64_t zero_q = sync_demod_zero(s, s->q_sum, s->q_bal);
+    int32_t ave_i, ave_q;
+
+    ave_i = (int32_t)(zero_i / (int32_t)s->sample_count);
+    ave_q = (int32_t)(zero_q / (int32_t)s->sample_count);
+
+    // 電位の正負判定 (不感帯内では前回の極性を保持)
+    if (ave_i > DEMOD_SIGN_DEADBAND) {
+        s->sign = 1;
+    } else if (ave_i < -DEMOD_SIGN_DEADBAND) {
+        s->sign = -1;
+    }
+
+    result->average = ave_i;
+    result->quadrature = ave_q;
+    result->magnitude = (uint32_t)(ave_i < 0 ? -ave_i : ave_i)
+                      + (uint32_t)(ave_q < 0 ? -ave_q : ave_q);
+    result->phase = sync_demod_phase(ave_i, ave_q);
+    result->sign = s->sign;
+    result->sample_count = s->sample_count;
+    result->shutter_count = s->shutter_count;
+
+    // 窓は半周期の整数個なので、平均周波数は 半周期数 / (2 × サンプル数) サンプリング周波数。
+    // 出力はシャッター周波数に比例するので基準周波数に換算する (サンプル数は約分される)
+    result->shutter_mhz = (uint32_t)(((uint64_t)s->sample_hz * 1000 * s->shutter_count)
+                                     / (2 * (uint64_t)s->sample_count));
+    result->normalized = (int32_t)((zero_i * 2 * DEMOD_REF_FREQ_HZ)
+                                   / ((int64_t)s->shutter_count * s->sample_hz));
+    result->dc_offset = s->dc_base / (1 << (16 - DEMOD_FRAC_BITS));
+    result->gap = s->gap;
+    s->gap = false;
+}
+
+//*****************************************************************************
+// I/Qから位相を求める (Q16)
+// 矩形参照では I, Q が位相に対して直線的に変化するため、|I|+|Q| で正規化した
+// 比がそのまま位相になる (除算1回のみ)
+//*****************************************************************************
+static uint16_t sync_demod_phase(int32_t i, int32_t q) {
+    uint32_t ai = (uint32_t)(i < 0 ? -i : i);
+    uint32_t aq = (uint32_t)(q < 0 ? -q : q);
+    uint32_t sum = ai + aq;
+    uint32_t base, part;
+
+    if (sum == 0) return 0;
+
+    if (i >= 0 && q >= 0) {
+        base = 0x0000; part = aq;
+    } else if (i < 0 && q >= 0) {
+        base = 0x4000; part = ai;
+    } else if (i < 0) {
+        base = 0x8000; part = aq;
+    } else {
+        base = 0xc000; part = ai;
+    }
+
+    return (uint16_t)(base + (uint32_t)(((uint64_t)part << 14) / sum));
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
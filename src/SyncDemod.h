@@ -0,0 +1,109 @@
+//*****************************************************************************
+// ファイル名       SyncDemod.h
+// 対象マイコン     RP2040
+// ファイル内容     同期検波処理
+//*****************************************************************************
+#ifndef SYNCDEMOD_H_
+#define SYNCDEMOD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define ADC_MID_VALUE           2048    // ADCの中間値 (12ビット)
+#define SHUTTER_CYCLE_THRESHOLD 10      // 平均するシャッター変化回数 (固定窓の長さ)
+#define DEMOD_PART_RING_SIZE    64      // 半周期部分和のリング長 (2のべき乗, 窓の最大長より長く)
+
+// 適応窓: 1周期ごとの同相成分のばらつきから窓の長さを決め、ステップで縮める
+#define DEMOD_WINDOW_MIN        2       // 窓の最小長 (半周期数, 1周期)
+#define DEMOD_WINDOW_MAX        (DEMOD_PART_RING_SIZE - 1) // 窓の最大長 (半周期数, 追加してから古い区間を引くため1区間余分に持つ)
+#define DEMOD_STATS_SHIFT       4       // 平均・分散の追従速度 (1/16ずつ)
+#define DEMOD_NOISE_ABS         64      // 窓平均のばらつき目標 (Q8, 0.25 ADC値)
+#define DEMOD_NOISE_REL_SHIFT   7       // 窓平均のばらつき目標 (信号の1/128)
+#define DEMOD_STEP_SIGMA        4       // ステップとみなす偏差 (標準偏差の倍数)
+#define DEMOD_STEP_FLOOR        (1 << DEMOD_FRAC_BITS) // ステップとみなす最小偏差 (Q8, 1 ADC値)
+#define DEMOD_STEP_COUNT        2       // ステップと判定する連続回数
+#define DEMOD_FRAC_BITS         8       // 検波出力の小数部ビット数 (Q8)
+#define DEMOD_PHASE_OFFSET      0x00000000u // 参照位相の補償量 (Q32, 2^32で1周期)
+#define DEMOD_SIGN_DEADBAND     (1 << (DEMOD_FRAC_BITS - 1)) // 極性判定の不感帯 (0.5 ADC値)
+#define DEMOD_REF_FREQ_HZ       200     // 正規化の基準シャッター周波数 [Hz] (出力は周波数に比例するため)
+#define DEMOD_DC_SHIFT          10      // 直流オフセットの追従速度 (エッジ毎に1/1024ずつ, 200Hzで約2.6秒)
+
+// 参照位相 (Q32) : 立ち上がり(シャッター開)で0、立ち下がりで1/2周期
+#define DEMOD_PHASE_HALF        0x80000000u
+#define DEMOD_PHASE_QUARTER     0x40000000u
+#define DEMOD_MIN_PERIOD        2       // 周期として受け付ける最小サンプル数 (チャタリング除去)
+
+//=============================================================================
+// 表面電位計測用構造体定義
+//=============================================================================
+typedef struct {
+    int64_t  i_sum;            // 同相成分の部分和
+    int64_t  q_sum;            // 直交成分の部分和
+    int64_t  dc_sum;           // 参照を掛けない単純和 (直流オフセットの推定用)
+    int32_t  i_bal;            // 同相参照の +1 と -1 のサンプル数の差
+    int32_t  q_bal;            // 直交参照の +1 と -1 のサンプル数の差
+    uint32_t sample_count;     // サンプル数
+} DemodPartial;
+
+typedef struct {
+    DemodPartial part[DEMOD_PART_RING_SIZE]; // 半周期ごとの部分和 (エッジ間1区間で1個)
+    DemodPartial cur;          // 積算中の半周期
+    uint32_t part_head;        // 次に書き込むリング位置
+    uint32_t shutter_count;    // 窓内の半周期数
+    uint32_t sample_count;     // 窓内のサンプル数
+    int64_t i_sum;             // 窓内の同相成分積算値
+    int64_t q_sum;             // 窓内の直交成分積算値
+    int32_t i_bal;             // 窓内の同相参照の +1/-1 サンプル数の差
+    int32_t q_bal;             // 窓内の直交参照の +1/-1 サンプル数の差
+    int32_t dc_base;           // 直流オフセット (Q16 ADC値, ADC_MID_VALUEから)
+    uint32_t dc_count;         // 直流オフセットの平均回数 (起動直後は単純平均)
+    bool part_valid;           // 積算中の半周期がエッジから始まっているか
+    bool rise_valid;           // 前回の立ち上がりから途切れずに数えているか
+    bool gap;                  // 取り込みが途切れた後、まだ結果を出していない
+    uint32_t window;           // 窓の長さ (半周期数)
+    bool adaptive;             // 適応窓を使うか (falseなら fixed_window 固定)
+    uint32_t fixed_window;     // 固定窓の長さ (半周期数, 初期値 SHUTTER_CYCLE_THRESHOLD)
+    bool stats_valid;          // 1周期値の統計が初期化済みか
+    int32_t cycle_mean;        // 1周期ごとの同相成分の平均 (Q8)
+    int64_t cycle_var;         // 1周期ごとの同相成分の分散 (Q16)
+    uint32_t step_count;       // ステップ候補の連続回数
+    uint32_t sample_hz;        // サンプリング周波数 [Hz] (シャッター周波数の計算用)
+    uint32_t phase;            // 参照位相 (Q32)
+    uint32_t phase_step;       // 1サンプルあたりの位相増分 (Q32)
+    uint32_t rise_interval;    // 前回の立ち上がりからのサンプル数
+    uint32_t rise_lag;         // 前回の立ち上がりエッジからサンプルまでの遅れ (Q16サンプル)
+    int16_t sign;              // 現在の極性判定
+    bool prev_shutter_state;   // 前回のシャッター状態
+} SyncDemodState;
+
+typedef struct {
+    int32_t  average;          // 位相補償済み同相成分 (符号付き, Q8 ADC値)
+    int32_t  quadrature;       // 直交成分 (Q8 ADC値)
+    uint32_t magnitude;        // 振幅 |I|+|Q| (Q8 ADC値)
+    uint16_t phase;            // 位相 (Q16, 65536で1周期)
+    int16_t  sign;             // 表面電位の符号 (1:正, -1:負)
+    uint32_t sample_count;     // 積分したサンプル数
+    uint32_t shutter_count;    // 積分したシャッター変化回数 (窓の長さ)
+    uint32_t shutter_mhz;      // 窓内の平均シャッター周波数 [mHz]
+    int32_t  normalized;       // 基準シャッター周波数に換算した同相成分 (Q8 ADC値)
+    int32_t  dc_offset;        // 追従中の直流オフセット (Q8 ADC値, ADC_MID_VALUEから)
+    bool     gap;              // 取り込みが途切れた後の最初の結果 (窓は途切れの後だけ)
+    uint32_t timestamp_us;     // 結果が確定した時刻 [us] (コア1で設定)
+} DemodResult;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void sync_demod_init(SyncDemodState *s);
+void sync_demod_set_adaptive(SyncDemodState *s, bool adaptive);
+void sync_demod_set_window(SyncDemodState *s, uint32_t window);
+bool sync_demod_process(SyncDemodState *s, const uint32_t *samples, uint32_t count,
+                        uint32_t *consumed, DemodResult *result);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
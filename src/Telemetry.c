@@ -0,0 +1,98 @@
+//*****************************************************************************
+// ファイル名       Telemetry.c
+// 対象マイコン     RP2040
+// ファイル内容     USB CDC テレメトリ送信 (ノンブロッキング)
+//*****************************************************************************
+// フレームは送信リングバッファに積むだけで、USBへはCDCの空き分だけ送る。
+// ホストが読まない・遅い場合はリングが満杯になった時点でフレームを捨てる。
+//=============================================================================
+//include
+//=============================================================================
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+#include "Telemetry.h"
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+uint8_t     telemetry_buff[TELEMETRY_BUFF_SIZE];    // 送信リングバッファ
+uint32_t    telemetry_wr;                           // 書き込み位置
+uint32_t    telemetry_rd;                           // 読み出し位置
+uint16_t    telemetry_seq;                          // 次のシーケンス番号
+uint32_t    telemetry_drop_count;                   // 捨てたフレーム数
+
+//*****************************************************************************
+// テレメトリ 初期化
+//*****************************************************************************
+void telemetry_init(void) {
+    telemetry_wr = 0;
+    telemetry_rd = 0;
+    telemetry_seq = 0;
+    telemetry_drop_count = 0;
+}
+
+//*****************************************************************************
+// フレーム送信要求 (リングに空きが無ければ捨ててfalse)
+//*****************************************************************************
+bool telemetry_send(uint8_t type, const uint8_t *payload, uint8_t len) {
+    uint8_t  frame[TELEMETRY_MAX_FRAME];
+    uint32_t size, i;
+
+    // 捨てたフレームも番号を進め、ホスト側で欠落が分かるようにする
+    size = telemetry_build_frame(frame, type, telemetry_seq++, time_us_32(), payload, len);
+
+    if (TELEMETRY_BUFF_SIZE - (telemetry_wr - telemetry_rd) < size) {
+        telemetry_drop_count++;
+        return false;
+    }
+
+    for (i = 0; i < size; i++) {
+        telemetry_buff[(telemetry_wr + i) & (TELEMETRY_BUFF_SIZE - 1)] = frame[i];
+    }
+    telemetry_wr += size;
+    return true;
+}
+
+//*****************************************************************************
+// USBへ送信 (メインループから呼ぶ, CDCの空き分だけ書いて戻る)
+//*****************************************************************************
+void telemetry_process(void) {
+    uint32_t count, space, offset;
+
+    if (telemetry_wr == telemetry_rd) return;
+
+    // 接続されていなければ溜めておく (満杯になれば新しいフレームを捨てる)
+    if (!stdio_usb_connected()) return;
+
+    space = tud_cdc_write_available();
+    count = telemetry_wr - telemetry_rd;
+    if (count > space) count = space;
+
+    // リングの折り返しまでを1回で送る
+    offset = telemetry_rd & (TELEMETRY_BUFF_SIZE - 1);
+    if (count > TELEMETRY_BUFF_SIZE - offset) count = TELEMETRY_BUFF_SIZE - offset;
+    if (count == 0) return;
+
+    // 改行変換を通さないようUSBドライバへ直接渡す
+    stdio_usb.out_chars((const char *)&telemetry_buff[offset], (int)count);
+    telemetry_rd += count;
+}
+
+//*****************************************************************************
+// 捨てたフレーム数
+//*****************************************************************************
+uint32_t telemetry_dropped(void) {
+    return telemetry_drop_count;
+}
+
+//*****************************************************************************
+// 送信リングの空き [バイト] (大量に送る側が溢れないよう確認に使う)
+//*****************************************************************************
+uint32_t telemetry_free(void) {
+    return TELEMETRY_BUFF_SIZE - (telemetry_wr - telemetry_rd);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
@@ -0,0 +1,30 @@
+//*****************************************************************************
+// ファイル名       Telemetry.h
+// 対象マイコン     RP2040
+// ファイル内容     USB CDC テレメトリ送信 (ノンブロッキング)
+//*****************************************************************************
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "TelemetryProtocol.h"
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define TELEMETRY_BUFF_SIZE     4096        // 送信リングバッファ (2のべき乗)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void     telemetry_init(void);
+bool     telemetry_send(uint8_t type, const uint8_t *payload, uint8_t len);
+void     telemetry_process(void);
+uint32_t telemetry_dropped(void);
+uint32_t telemetry_free(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
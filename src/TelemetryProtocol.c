@@ -0,0 +1,296 @@
+//*****************************************************************************
+// ファイル名       TelemetryProtocol.c
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     USBテレメトリ フレーム生成・ペイロード変換
+//*****************************************************************************
+//=============================================================================
+//include
+//=============================================================================
+#include "TelemetryProtocol.h"
+#include "AdcControl.h"
+
+//*****************************************************************************
+// CRC16-CCITT (多項式0x1021, 初期値は呼び出し側で0xFFFF)
+//*****************************************************************************
+uint16_t telemetry_crc16(const uint8_t *data, size_t len, uint16_t crc) {
+    int i;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+//*****************************************************************************
+// フレーム生成 (フレーム長を返す)
+//*****************************************************************************
+size_t telemetry_build_frame(uint8_t *frame, uint8_t type, uint16_t seq, uint32_t timestamp,
+                             const uint8_t *payload, uint8_t len) {
+    uint8_t i;
+
+    frame[0] = TELEMETRY_SYNC0;
+    frame[1] = TELEMETRY_SYNC1;
+    frame[2] = type;
+    frame[3] = len;
+    telemetry_put_u16(&frame[4], seq);
+    telemetry_put_u32(&frame[6], timestamp);
+    for (i = 0; i < len; i++) {
+        frame[TELEMETRY_HEADER_SIZE + i] = payload[i];
+    }
+    telemetry_put_u16(&frame[TELEMETRY_HEADER_SIZE + len],
+                      telemetry_crc16(&frame[2], TELEMETRY_HEADER_SIZE - 2 + len, 0xFFFF));
+
+    return TELEMETRY_HEADER_SIZE + len + TELEMETRY_CRC_SIZE;
+}
+
+//*****************************************************************************
+// 計測結果ペイロード変換
+//*****************************************************************************
+void telemetry_pack_measurement(uint8_t *buf, const TelemetryMeasurement *m) {
+    telemetry_put_u32(&buf[0], (uint32_t)m->potential_mv);
+    telemetry_put_u32(&buf[4], (uint32_t)m->average_q8);
+    telemetry_put_u32(&buf[8], (uint32_t)m->quadrature_q8);
+    telemetry_put_u16(&buf[12], m->phase_q16);
+    buf[14] = (uint8_t)m->sign;
+    buf[15] = m->dht11_status;
+    telemetry_put_u32(&buf[16], m->sample_count);
+    telemetry_put_u16(&buf[20], m->shutter_count);
+    telemetry_put_u16(&buf[22], (uint16_t)m->temperature);
+    telemetry_put_u16(&buf[24], m->humidity);
+    telemetry_put_u32(&buf[26], m->shutter_mhz);
+    telemetry_put_u32(&buf[30], (uint32_t)m->dc_offset_q8);
+    telemetry_put_u16(&buf[34], m->stats_window_s);
+    telemetry_put_u32(&buf[36], (uint32_t)m->stats_mean_mv);
+    telemetry_put_u32(&buf[40], m->stats_stddev_mv);
+    telemetry_put_u32(&buf[44], (uint32_t)m->stats_min_mv);
+    telemetry_put_u32(&buf[48], (uint32_t)m->stats_max_mv);
+    telemetry_put_u32(&buf[52], (uint32_t)m->total_mean_mv);
+    telemetry_put_u32(&buf[56], m->total_stddev_mv);
+    telemetry_put_u32(&buf[60], (uint32_t)m->total_min_mv);
+    telemetry_put_u32(&buf[64], (uint32_t)m->total_max_mv);
+    buf[68] = m->flags;
+}
+
+void telemetry_unpack_measurement(const uint8_t *buf, TelemetryMeasurement *m) {
+    m->potential_mv = (int32_t)telemetry_get_u32(&buf[0]);
+    m->average_q8 = (int32_t)telemetry_get_u32(&buf[4]);
+    m->quadrature_q8 = (int32_t)telemetry_get_u32(&buf[8]);
+    m->phase_q16 = telemetry_get_u16(&buf[12]);
+    m->sign = (int8_t)buf[14];
+    m->dht11_status = buf[15];
+    m->sample_count = telemetry_get_u32(&buf[16]);
+    m->shutter_count = telemetry_get_u16(&buf[20]);
+    m->temperature = (int16_t)telemetry_get_u16(&buf[22]);
+    m->humidity = telemetry_get_u16(&buf[24]);
+    m->shutter_mhz = telemetry_get_u32(&buf[26]);
+    m->dc_offset_q8 = (int32_t)telemetry_get_u32(&buf[30]);
+    m->stats_window_s = telemetry_get_u16(&buf[34]);
+    m->stats_mean_mv = (int32_t)telemetry_get_u32(&buf[36]);
+    m->stats_stddev_mv = telemetry_get_u32(&buf[40]);
+    m->stats_min_mv = (int32_t)telemetry_get_u32(&buf[44]);
+    m->stats_max_mv = (int32_t)telemetry_get_u32(&buf[48]);
+    m->total_mean_mv = (int32_t)telemetry_get_u32(&buf[52]);
+    m->total_stddev_mv = telemetry_get_u32(&buf[56]);
+    m->total_min_mv = (int32_t)telemetry_get_u32(&buf[60]);
+    m->total_max_mv = (int32_t)telemetry_get_u32(&buf[64]);
+    m->flags = buf[68];
+}
+
+//*****************************************************************************
+// 動作状況ペイロード変換
+//*****************************************************************************
+void telemetry_pack_diag(uint8_t *buf, const TelemetryDiagnostics *d) {
+    int i;
+
+    for (i = 0; i < TELEMETRY_DIAG_ISR_NUM; i++) {
+        telemetry_put_u32(buf, d->isr_count[i]);
+        telemetry_put_u16(buf + 4, d->isr_max_us[i]);
+        telemetry_put_u16(buf + 6, d->isr_load[i]);
+        buf += 8;
+    }
+    telemetry_put_u32(buf, d->adc_overrun);
+    telemetry_put_u32(buf + 4, d->adc_error);
+    telemetry_put_u32(buf + 8, d->adc_late);
+    buf += 12;
+    for (i = 0; i < TELEMETRY_DIAG_LATE_BINS; i++) {
+        telemetry_put_u32(buf, d->timer_late[i]);
+        buf += 4;
+    }
+    telemetry_put_u16(buf, d->timer_late_max_us);
+    telemetry_put_u16(buf + 2, d->idle);
+    telemetry_put_u32(buf + 4, d->loop_rate);
+    telemetry_put_u16(buf + 8, d->sample_queue_max);
+    telemetry_put_u32(buf + 10, d->sample_queue_dropped);
+    telemetry_put_u32(buf + 14, d->telemetry_dropped);
+}
+
+void telemetry_unpack_diag(const uint8_t *buf, TelemetryDiagnostics *d) {
+    int i;
+
+    for (i = 0; i < TELEMETRY_DIAG_ISR_NUM; i++) {
+        d->isr_count[i] = telemetry_get_u32(buf);
+        d->isr_max_us[i] = telemetry_get_u16(buf + 4);
+        d->isr_load[i] = telemetry_get_u16(buf + 6);
+        buf += 8;
+    }
+    d->adc_overrun = telemetry_get_u32(buf);
+    d->adc_error = telemetry_get_u32(buf + 4);
+    d->adc_late = telemetry_get_u32(buf + 8);
+    buf += 12;
+    for (i = 0; i < TELEMETRY_DIAG_LATE_BINS; i++) {
+        d->timer_late[i] = telemetry_get_u32(buf);
+        buf += 4;
+    }
+    d->timer_late_max_us = telemetry_get_u16(buf);
+    d->idle = telemetry_get_u16(buf + 2);
+    d->loop_rate = telemetry_get_u32(buf + 4);
+    d->sample_queue_max = telemetry_get_u16(buf + 8);
+    d->sample_queue_dropped = telemetry_get_u32(buf + 10);
+    d->telemetry_dropped = telemetry_get_u32(buf + 14);
+}
+
+//*****************************************************************************
+// 生サンプルペイロード変換 (samplesはADCサンプルデータ, countは8の倍数, ペイロード長を返す)
+//*****************************************************************************
+size_t telemetry_pack_raw(uint8_t *buf, const TelemetryRawHeader *h, const uint32_t *samples) {
+    uint8_t *shutter = &buf[TELEMETRY_RAW_HEADER_SIZE];
+    uint8_t *p = &shutter[h->count / 8];
+    uint32_t i, a, b;
+
+    telemetry_put_u32(&buf[0], h->first_index);
+    telemetry_put_u32(&buf[4], h->dropped);
+    telemetry_put_u32(&buf[8], h->sample_rate_hz);
+    buf[12] = h->count;
+
+    for (i = 0; i < h->count / 8U; i++) shutter[i] = 0;
+
+    for (i = 0; i < h->count; i += 2) {
+        a = samples[i];
+        b = samples[i + 1];
+        if (a & ADC_SAMPLE_SHUTTER_BIT) shutter[i >> 3] |= (uint8_t)(1 << (i & 7));
+        if (b & ADC_SAMPLE_SHUTTER_BIT) shutter[i >> 3] |= (uint8_t)(1 << ((i + 1) & 7));
+        a &= ADC_SAMPLE_VALUE_MASK;
+        b &= ADC_SAMPLE_VALUE_MASK;
+        *p++ = (uint8_t)a;
+        *p++ = (uint8_t)((a >> 8) | (b << 4));
+        *p++ = (uint8_t)(b >> 4);
+    }
+
+    return TELEMETRY_RAW_SIZE(h->count);
+}
+
+// 値とシャッター状態(0/1)に展開 (サンプル数を返す, 長さ不正なら-1)
+int telemetry_unpack_raw(const uint8_t *buf, size_t len, TelemetryRawHeader *h,
+                         uint16_t *values, uint8_t *shutter) {
+    const uint8_t *p;
+    uint32_t i;
+
+    if (len < TELEMETRY_RAW_HEADER_SIZE) return -1;
+    h->first_index = telemetry_get_u32(&buf[0]);
+    h->dropped = telemetry_get_u32(&buf[4]);
+    h->sample_rate_hz = telemetry_get_u32(&buf[8]);
+    h->count = buf[12];
+    if (h->count % 8 != 0 || h->count > TELEMETRY_RAW_MAX_SAMPLES) return -1;
+    if (len < (size_t)TELEMETRY_RAW_SIZE(h->count)) return -1;
+
+    p = &buf[TELEMETRY_RAW_HEADER_SIZE + h->count / 8];
+    for (i = 0; i < h->count; i += 2) {
+        values[i] = (uint16_t)(p[0] | ((p[1] & 0x0f) << 8));
+        values[i + 1] = (uint16_t)((p[1] >> 4) | (p[2] << 4));
+        p += 3;
+    }
+    for (i = 0; i < h->count; i++) {
+        shutter[i] = (buf[TELEMETRY_RAW_HEADER_SIZE + i / 8] >> (i % 8)) & 1;
+    }
+    return h->count;
+}
+
+//*****************************************************************************
+// ログ記録変換
+//*****************************************************************************
+void telemetry_pack_log_record(uint8_t *buf, const TelemetryLogRecord *r) {
+    telemetry_put_u32(&buf[0], r->time_ms);
+    telemetry_put_u32(&buf[4], (uint32_t)r->potential_mv);
+    telemetry_put_u16(&buf[8], (uint16_t)r->temperature);
+    telemetry_put_u16(&buf[10], r->humidity);
+    buf[12] = (uint8_t)r->sign;
+    buf[13] = r->flags;
+}
+
+void telemetry_unpack_log_record(const uint8_t *buf, TelemetryLogRecord *r) {
+    r->time_ms = telemetry_get_u32(&buf[0]);
+    r->potential_mv = (int32_t)telemetry_get_u32(&buf[4]);
+    r->temperature = (int16_t)telemetry_get_u16(&buf[8]);
+    r->humidity = telemetry_get_u16(&buf[10]);
+    r->sign = (int8_t)buf[12];
+    r->flags = buf[13];
+}
+
+//*****************************************************************************
+// ログページのヘッダー書き込み (記録は書き込み済みのこと, CRCもここで計算)
+//*****************************************************************************
+void telemetry_seal_log_page(uint8_t *page, const TelemetryLogPage *h) {
+    uint16_t crc;
+
+    telemetry_put_u32(&page[0], h->magic);
+    telemetry_put_u32(&page[4], h->page_seq);
+    telemetry_put_u16(&page[8], h->boot);
+    page[10] = h->count;
+    page[11] = h->version;
+    crc = telemetry_crc16(page, 12, 0xFFFF);
+    crc = telemetry_crc16(&page[TELEMETRY_LOG_HEADER_SIZE], (size_t)h->count * TELEMETRY_LOG_RECORD_SIZE, crc);
+    telemetry_put_u16(&page[12], crc);
+    telemetry_put_u16(&page[14], 0xFFFF);
+}
+
+//*****************************************************************************
+// ログページの確認 (記録数を返す, 消去済みは0, 壊れていれば-1)
+//*****************************************************************************
+int telemetry_check_log_page(const uint8_t *page, TelemetryLogPage *h) {
+    uint16_t crc;
+
+    h->magic = telemetry_get_u32(&page[0]);
+    h->page_seq = telemetry_get_u32(&page[4]);
+    h->boot = telemetry_get_u16(&page[8]);
+    h->count = page[10];
+    h->version = page[11];
+
+    if (h->magic == 0xFFFFFFFFu) return 0;
+    if (h->magic != TELEMETRY_LOG_MAGIC || h->version != TELEMETRY_LOG_VERSION ||
+        h->count == 0 || h->count > TELEMETRY_LOG_RECORDS) return -1;
+
+    crc = telemetry_crc16(page, 12, 0xFFFF);
+    crc = telemetry_crc16(&page[TELEMETRY_LOG_HEADER_SIZE], (size_t)h->count * TELEMETRY_LOG_RECORD_SIZE, crc);
+    if (crc != telemetry_get_u16(&page[12])) return -1;
+    return h->count;
+}
+
+//*****************************************************************************
+// リトルエンディアン読み書き
+//*****************************************************************************
+void telemetry_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void telemetry_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+uint16_t telemetry_get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t telemetry_get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
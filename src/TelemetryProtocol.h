@@ -0,0 +1,224 @@
+//*****************************************************************************
+// ファイル名       TelemetryProtocol.h
+// 対象マイコン     RP2040 / ホストPC 共通
+// ファイル内容     USBテレメトリ フレーム定義
+//*****************************************************************************
+#ifndef TELEMETRYPROTOCOL_H_
+#define TELEMETRYPROTOCOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+/*
+フレーム構成 (数値は全てリトルエンディアン)
+    +0  同期バイト0  0xA5
+    +1  同期バイト1  0x5A
+    +2  種別
+    +3  ペイロード長 N
+    +4  シーケンス番号 (u16, フレーム毎に+1, 送れなかったフレームも数える)
+    +6  タイムスタンプ (u32, 起動からの[us])
+    +10 ペイロード (Nバイト)
+    +10+N CRC16-CCITT (u16, 種別からペイロード末尾まで)
+*/
+#define TELEMETRY_SYNC0         0xA5
+#define TELEMETRY_SYNC1         0x5A
+#define TELEMETRY_HEADER_SIZE   10
+#define TELEMETRY_CRC_SIZE      2
+#define TELEMETRY_MAX_PAYLOAD   255
+#define TELEMETRY_MAX_FRAME     (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE)
+
+// フレーム種別
+#define TELEMETRY_TYPE_MEASUREMENT  0x01    // 同期検波結果 1回分
+#define TELEMETRY_TYPE_RAW          0x02    // 生サンプル (キャプチャモード時)
+#define TELEMETRY_TYPE_DIAG         0x03    // 動作状況 (USBからの問い合わせに応答)
+#define TELEMETRY_TYPE_LOG          0x04    // フラッシュのログ (USBからの読み出し要求に応答)
+#define TELEMETRY_TYPE_EVENT        0x05    // トリガーで記録した波形 (USBからの読み出し要求に応答)
+#define TELEMETRY_TYPE_RESPONSE     0x06    // USBコマンドの応答 (ASCII 1行, 改行なし)
+
+//=============================================================================
+// 計測結果ペイロード
+//=============================================================================
+typedef struct {
+    int32_t  potential_mv;      // 表面電位 [mV] (基準シャッター周波数に換算済み)
+    int32_t  average_q8;        // 位相補償済み同相成分 (Q8 ADC値)
+    int32_t  quadrature_q8;     // 直交成分 (Q8 ADC値)
+    uint16_t phase_q16;         // 位相 (Q16)
+    int8_t   sign;              // 極性 (1:正, -1:負)
+    uint8_t  dht11_status;      // DHT11の直近の読み取り結果
+    uint32_t sample_count;      // 積分したサンプル数
+    uint16_t shutter_count;     // 積分したシャッター変化回数 (検波の窓の長さ)
+    int16_t  temperature;       // 温度 [0.1℃]
+    uint16_t humidity;          // 湿度 [0.1%RH]
+    uint32_t shutter_mhz;       // 窓内の平均シャッター周波数 [mHz]
+    int32_t  dc_offset_q8;      // 追従中の直流オフセット (Q8 ADC値, 2048から)
+    uint16_t stats_window_s;    // 統計の移動区間 [s]
+    int32_t  stats_mean_mv;     // 移動区間の平均 [mV] (統計は1秒毎に更新)
+    uint32_t stats_stddev_mv;   // 移動区間の標準偏差 [mV]
+    int32_t  stats_min_mv;      // 移動区間の最小 [mV]
+    int32_t  stats_max_mv;      // 移動区間の最大 [mV]
+    int32_t  total_mean_mv;     // リセット後の平均 [mV]
+    uint32_t total_stddev_mv;   // リセット後の標準偏差 [mV]
+    int32_t  total_min_mv;      // リセット後の最小 [mV]
+    int32_t  total_max_mv;      // リセット後の最大 [mV]
+    uint8_t  flags;             // 状態 (TELEMETRY_MEAS_FLAG_*)
+} TelemetryMeasurement;
+
+#define TELEMETRY_MEASUREMENT_SIZE  69
+
+// 計測結果の状態
+#define TELEMETRY_MEAS_FLAG_GAP     0x01    // ADCの取り込みが途切れた後の最初の結果 (フラッシュ書き換え)
+
+//=============================================================================
+// 生サンプルペイロード
+//=============================================================================
+/*
+    +0  先頭サンプル番号 (u32, ADC開始からの通し番号)
+    +4  捨てたサンプル数 (u32, キャプチャ開始からの累計)
+    +8  サンプリング周波数 (u32, [Hz])
+    +12 サンプル数 N
+    +13 シャッター状態 (N/8バイト, サンプルiはバイトi/8のビットi%8)
+    +13+N/8 ADC値 (12ビット詰め, 2サンプル3バイト)
+            b0 = s0[7:0], b1 = s0[11:8] | s1[3:0]<<4, b2 = s1[11:4]
+*/
+#define TELEMETRY_RAW_HEADER_SIZE   13
+#define TELEMETRY_RAW_MAX_SAMPLES   128     // 1フレームの最大サンプル数 (8の倍数)
+#define TELEMETRY_RAW_SIZE(n)       (TELEMETRY_RAW_HEADER_SIZE + (n) / 8 + (n) * 3 / 2)
+
+typedef struct {
+    uint32_t first_index;       // 先頭サンプル番号
+    uint32_t dropped;           // 捨てたサンプル数 (累計)
+    uint32_t sample_rate_hz;    // サンプリング周波数 [Hz]
+    uint8_t  count;             // サンプル数
+} TelemetryRawHeader;
+
+//=============================================================================
+// 動作状況ペイロード (率・最大値は直近1秒, 回数は起動からの累計)
+//=============================================================================
+#define TELEMETRY_DIAG_ISR_NUM      3       // タイマー, ADC DMA, GPIO
+#define TELEMETRY_DIAG_LATE_BINS    6       // <10, <50, <100, <250, <1000, それ以上 [us]
+
+typedef struct {
+    uint32_t isr_count[TELEMETRY_DIAG_ISR_NUM];     // 割り込み回数
+    uint16_t isr_max_us[TELEMETRY_DIAG_ISR_NUM];    // 割り込み処理時間の最大 [us]
+    uint16_t isr_load[TELEMETRY_DIAG_ISR_NUM];      // 割り込み処理の占有率 [0.1%]
+    uint32_t adc_overrun;                           // ADC FIFOの溢れ
+    uint32_t adc_error;                             // ADC変換エラー
+    uint32_t adc_late;                              // DMA割り込みの遅れ (2ブロック溜まった回数)
+    uint32_t timer_late[TELEMETRY_DIAG_LATE_BINS];  // 1msタイマーの遅れのヒストグラム
+    uint16_t timer_late_max_us;                     // 1msタイマーの遅れの最大 [us]
+    uint16_t idle;                                  // コア0のアイドル率 [0.1%]
+    uint32_t loop_rate;                             // メインループの回転数 [回/s]
+    uint16_t sample_queue_max;                      // サンプルキューの最大使用量
+    uint32_t sample_queue_dropped;                  // サンプルキューで捨てたサンプル数
+    uint32_t telemetry_dropped;                     // 送れなかったフレーム数
+} TelemetryDiagnostics;
+
+#define TELEMETRY_DIAG_SIZE         (TELEMETRY_DIAG_ISR_NUM * 8 + 12 + TELEMETRY_DIAG_LATE_BINS * 4 + 18)
+
+//=============================================================================
+// ログ (フラッシュにページ単位で保存, 読み出しはページをそのまま送る)
+//=============================================================================
+/*
+ログページ (フラッシュの1ページ, 256バイト)
+    +0  識別子 (u32, 'EFML')
+    +4  ページ番号 (u32, 書いた順の通し番号, 一周しても戻らない)
+    +8  起動回数 (u16, 記録の時刻はこの起動からの経過)
+    +10 記録数 N (u8)
+    +11 版数 (u8)
+    +12 CRC16-CCITT (u16, +0～+11 と記録 N 個)
+    +14 予約 (u16)
+    +16 記録 (TELEMETRY_LOG_RECORD_SIZE バイト × N)
+記録
+    +0  時刻 (u32, 起動からの[ms])
+    +4  表面電位 (i32, [mV], 記録間隔の平均)
+    +8  温度 (i16, [0.1℃])
+    +10 湿度 (u16, [0.1%RH])
+    +12 極性 (i8)
+    +13 状態 (u8, TELEMETRY_LOG_FLAG_*)
+ログ読み出しペイロード (1ページを2フレームに分けて古い順に送る)
+    +0  フレームの順番 (u16, 0から)
+    +2  フレーム数 (u16, 読み出し開始時点, 0ならログは空)
+    +4  ページの半分 (TELEMETRY_LOG_CHUNK_SIZE バイト)
+*/
+#define TELEMETRY_LOG_MAGIC         0x4c4d4645u // 'EFML'
+#define TELEMETRY_LOG_VERSION       1
+#define TELEMETRY_LOG_PAGE_SIZE     256
+#define TELEMETRY_LOG_HEADER_SIZE   16
+#define TELEMETRY_LOG_RECORD_SIZE   14
+#define TELEMETRY_LOG_RECORDS       ((TELEMETRY_LOG_PAGE_SIZE - TELEMETRY_LOG_HEADER_SIZE) / TELEMETRY_LOG_RECORD_SIZE)
+#define TELEMETRY_LOG_CHUNK_SIZE    (TELEMETRY_LOG_PAGE_SIZE / 2)
+#define TELEMETRY_LOG_SIZE          (4 + TELEMETRY_LOG_CHUNK_SIZE)
+
+// 記録の状態
+#define TELEMETRY_LOG_FLAG_DHT11_OK 0x01    // 温湿度は直近の読み取りで正常
+#define TELEMETRY_LOG_FLAG_MOTOR    0x02    // モーター定速制御中
+#define TELEMETRY_LOG_FLAG_CAL      0x04    // フラッシュの校正を使用 (0は既定値)
+#define TELEMETRY_LOG_FLAG_ADC      0x08    // 記録間隔内にADCの異常あり
+#define TELEMETRY_LOG_FLAG_GAP      0x10    // 前の記録からの間にADCの取り込みが途切れた (フラッシュ書き換え)
+#define TELEMETRY_LOG_FLAG_NO_DATA  0x20    // 記録間隔内に計測結果なし (電位は0)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t page_seq;          // ページ番号
+    uint16_t boot;              // 起動回数
+    uint8_t  count;             // 記録数
+    uint8_t  version;
+} TelemetryLogPage;
+
+typedef struct {
+    uint32_t time_ms;           // 起動からの時刻 [ms]
+    int32_t  potential_mv;      // 表面電位 [mV]
+    int16_t  temperature;       // 温度 [0.1℃]
+    uint16_t humidity;          // 湿度 [0.1%RH]
+    int8_t   sign;              // 極性
+    uint8_t  flags;             // 状態
+} TelemetryLogRecord;
+
+//=============================================================================
+// トリガー記録ペイロード (記録を古い順に分けて送る)
+//=============================================================================
+/*
+    +0  先頭の記録の順番 (u16, 0から)
+    +2  記録数 (u16, 全体, 0なら記録なし)
+    +4  トリガーの位置 (u16, トリガーになった記録の順番)
+    +6  トリガー条件 (u8, TrigMode)
+    +7  このフレームの記録数 N (u8)
+    +8  しきい値 (i32, [mV])
+    +12 記録 N 個 (u32 時刻 [us], i32 表面電位 [mV])
+*/
+#define TELEMETRY_EVENT_HEADER_SIZE 12
+#define TELEMETRY_EVENT_MAX_SAMPLES 30      // 1フレームの最大記録数
+#define TELEMETRY_EVENT_SIZE(n)     (TELEMETRY_EVENT_HEADER_SIZE + (n) * 8)
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+uint16_t telemetry_crc16(const uint8_t *data, size_t len, uint16_t crc);
+size_t   telemetry_build_frame(uint8_t *frame, uint8_t type, uint16_t seq, uint32_t timestamp,
+                               const uint8_t *payload, uint8_t len);
+void     telemetry_pack_measurement(uint8_t *buf, const TelemetryMeasurement *m);
+void     telemetry_unpack_measurement(const uint8_t *buf, TelemetryMeasurement *m);
+void     telemetry_pack_diag(uint8_t *buf, const TelemetryDiagnostics *d);
+void     telemetry_unpack_diag(const uint8_t *buf, TelemetryDiagnostics *d);
+size_t   telemetry_pack_raw(uint8_t *buf, const TelemetryRawHeader *h, const uint32_t *samples);
+int      telemetry_unpack_raw(const uint8_t *buf, size_t len, TelemetryRawHeader *h,
+                              uint16_t *values, uint8_t *shutter);
+
+void     telemetry_pack_log_record(uint8_t *buf, const TelemetryLogRecord *r);
+void     telemetry_unpack_log_record(const uint8_t *buf, TelemetryLogRecord *r);
+void     telemetry_seal_log_page(uint8_t *page, const TelemetryLogPage *h);
+int      telemetry_check_log_page(const uint8_t *page, TelemetryLogPage *h);
+
+// リトルエンディアン読み書き
+void     telemetry_put_u16(uint8_t *p, uint16_t v);
+void     telemetry_put_u32(uint8_t *p, uint32_t v);
+uint16_t telemetry_get_u16(const uint8_t *p);
+uint32_t telemetry_get_u32(const uint8_t *p);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
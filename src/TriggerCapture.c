@@ -0,0 +1,262 @@
+//*****************************************************************************
+// ファイル名       TriggerCapture.c
+// 対象マイコン     RP2040
+// ファイル内容     表面電位のトリガー付き波形記録・ピークホールド
+//*****************************************************************************
+// 計測結果 (シャッターエッジ毎の表面電位) をリングバッファへ記録し続け、
+// トリガー条件が成立したらトリガー後の分を記録して止める。トリガー前の分は
+// リングに残っている直近の記録を使う。計測毎の処理は比較と書き込みだけで、
+// アームしたままにしておける。記録は再度アームするまで保持し、LCDとUSBから
+// 読み出す。ピークホールド (最大・最小) はトリガーと関係なく常に更新する。
+//=============================================================================
+//include
+//=============================================================================
+#include "Telemetry.h"
+#include "TriggerCapture.h"
+
+_Static_assert((TRIG_BUFFER_SIZE & (TRIG_BUFFER_SIZE - 1)) == 0, "TRIG_BUFFER_SIZE must be a power of 2");
+
+//=============================================================================
+//シンボル定義(ローカル)
+//=============================================================================
+#define TRIG_MASK       (TRIG_BUFFER_SIZE - 1)
+#define TRIG_FRAME_SIZE (TELEMETRY_HEADER_SIZE + TELEMETRY_EVENT_SIZE(TELEMETRY_EVENT_MAX_SAMPLES) + TELEMETRY_CRC_SIZE)
+
+//=============================================================================
+//グローバル変数の宣言
+//=============================================================================
+int32_t     trig_values[TRIG_BUFFER_SIZE];  // 表面電位 [mV]
+uint32_t    trig_times[TRIG_BUFFER_SIZE];   // 時刻 [us]
+uint32_t    trig_wr;                        // 次に書く位置 (通し番号, 下位ビットがリングの位置)
+uint32_t    trig_filled;                    // アームしてからの記録数 (TRIG_BUFFER_SIZEで頭打ち)
+
+// 設定
+TrigMode    trig_mode_now = TRIG_SLOPE_ANY;
+int32_t     trig_level_mv = TRIG_DEFAULT_LEVEL_MV;
+uint32_t    trig_pre = TRIG_DEFAULT_PRE;
+uint32_t    trig_post = TRIG_DEFAULT_POST;
+
+// 状態
+TrigState   trig_now;
+int32_t     trig_prev;                      // 前回の表面電位
+bool        trig_prev_valid;
+uint32_t    trig_start;                     // 記録の先頭 (通し番号)
+uint32_t    trig_pos;                       // トリガーの位置 (記録の先頭から)
+uint32_t    trig_total;                     // 記録数 (保持中のみ有効)
+uint32_t    trig_post_left;                 // トリガー後の残り
+
+// ピークホールド
+bool        trig_peak_valid;
+int32_t     trig_max;
+int32_t     trig_min;
+
+// 読み出し
+bool        trig_dump_active;
+uint32_t    trig_dump_index;                // 次に送る記録の順番
+
+//*****************************************************************************
+// トリガー記録 初期化 (停止状態, ピークホールドは空)
+//*****************************************************************************
+void trig_init(void) {
+    trig_now = TRIG_OFF;
+    trig_prev_valid = false;
+    trig_peak_valid = false;
+    trig_dump_active = false;
+    trig_total = 0;
+}
+
+//*****************************************************************************
+// トリガー条件の設定 (前後の記録数の合計がバッファを超える・条件が無効ならfalse)
+// アーム中なら設定し直してアームし直す
+//*****************************************************************************
+bool trig_config(TrigMode mode, int32_t level_mv, uint32_t pre, uint32_t post) {
+    if ((unsigned int)mode >= TRIG_MODE_NUM || pre + post + 1 > TRIG_BUFFER_SIZE) return false;
+    if (mode >= TRIG_SLOPE_RISE && level_mv <= 0) return false;
+
+    trig_mode_now = mode;
+    trig_level_mv = level_mv;
+    trig_pre = pre;
+    trig_post = post;
+    if (trig_now == TRIG_ARMED || trig_now == TRIG_POST) trig_arm();
+    return true;
+}
+
+//*****************************************************************************
+// アーム (前の記録は捨てる)
+//*****************************************************************************
+void trig_arm(void) {
+    trig_filled = 0;
+    trig_total = 0;
+    trig_prev_valid = false;
+    trig_dump_active = false;
+    trig_now = TRIG_ARMED;
+}
+
+//*****************************************************************************
+// 停止 (記録済みなら保持したまま)
+//*****************************************************************************
+void trig_disarm(void) {
+    if (trig_now != TRIG_HOLD) trig_now = TRIG_OFF;
+}
+
+//*****************************************************************************
+// 計測結果を渡す (計測毎)
+// gap: ADCの取り込みが途切れた後の最初の結果。記録はするが、途切れをまたいだ
+//      変化でトリガーしないよう前回との比較はしない
+//*****************************************************************************
+void trig_process(int32_t potential_mv, uint32_t timestamp_us, bool gap) {
+    int32_t prev = trig_prev;
+    bool    fire = false;
+
+    // ピークホールド
+    if (!trig_peak_valid || potential_mv > trig_max) trig_max = potential_mv;
+    if (!trig_peak_valid || potential_mv < trig_min) trig_min = potential_mv;
+    trig_peak_valid = true;
+
+    if (trig_now != TRIG_ARMED && trig_now != TRIG_POST) return;
+
+    trig_values[trig_wr & TRIG_MASK] = potential_mv;
+    trig_times[trig_wr & TRIG_MASK] = timestamp_us;
+    trig_wr++;
+    if (trig_filled < TRIG_BUFFER_SIZE) trig_filled++;
+
+    if (trig_now == TRIG_POST) {
+        if (--trig_post_left == 0) {
+            trig_total = trig_wr - trig_start;
+            trig_now = TRIG_HOLD;
+        }
+        return;
+    }
+
+    // トリガー判定 (前回の値と比べる)
+    trig_prev = potential_mv;
+    if (!trig_prev_valid || gap) {
+        trig_prev_valid = true;
+        return;
+    }
+    switch (trig_mode_now) {
+        case TRIG_LEVEL_RISE: fire = prev < trig_level_mv && potential_mv >= trig_level_mv; break;
+        case TRIG_LEVEL_FALL: fire = prev > trig_level_mv && potential_mv <= trig_level_mv; break;
+        case TRIG_SLOPE_RISE: fire = (int64_t)potential_mv - prev >= trig_level_mv; break;
+        case TRIG_SLOPE_FALL: fire = (int64_t)prev - potential_mv >= trig_level_mv; break;
+        case TRIG_SLOPE_ANY:
+            fire = (int64_t)potential_mv - prev >= trig_level_mv || (int64_t)prev - potential_mv >= trig_level_mv;
+            break;
+        default: break;
+    }
+    if (!fire) return;
+
+    // トリガー前はリングに残っている分だけ (アーム直後は少ない)
+    trig_pos = trig_filled - 1 < trig_pre ? trig_filled - 1 : trig_pre;
+    trig_start = trig_wr - 1 - trig_pos;
+    trig_post_left = trig_post;
+    if (trig_post_left == 0) {
+        trig_total = trig_pos + 1;
+        trig_now = TRIG_HOLD;
+    } else {
+        trig_now = TRIG_POST;
+    }
+}
+
+//*****************************************************************************
+// ピークホールドをやり直す
+//*****************************************************************************
+void trig_peak_reset(void) {
+    trig_peak_valid = false;
+    trig_max = 0;
+    trig_min = 0;
+}
+
+//*****************************************************************************
+// 状態・設定・ピークホールド
+//*****************************************************************************
+TrigState trig_state(void) {
+    return trig_now;
+}
+
+TrigMode trig_mode(void) {
+    return trig_mode_now;
+}
+
+int32_t trig_level(void) {
+    return trig_level_mv;
+}
+
+uint32_t trig_pre_length(void) {
+    return trig_pre;
+}
+
+uint32_t trig_post_length(void) {
+    return trig_post;
+}
+
+int32_t trig_peak_max(void) {
+    return trig_max;
+}
+
+int32_t trig_peak_min(void) {
+    return trig_min;
+}
+
+//*****************************************************************************
+// 保持中の記録 (記録数, トリガーの位置, 古い順に index 番目)
+//*****************************************************************************
+uint32_t trig_count(void) {
+    return trig_now == TRIG_HOLD ? trig_total : 0;
+}
+
+uint32_t trig_position(void) {
+    return trig_pos;
+}
+
+bool trig_sample(uint32_t index, int32_t *potential_mv, uint32_t *timestamp_us) {
+    uint32_t i = (trig_start + index) & TRIG_MASK;
+
+    if (index >= trig_count()) return false;
+    *potential_mv = trig_values[i];
+    *timestamp_us = trig_times[i];
+    return true;
+}
+
+//*****************************************************************************
+// USBへの読み出し開始 (保持中でなければ記録数0を1つだけ送る)
+//*****************************************************************************
+void trig_dump_start(void) {
+    trig_dump_index = 0;
+    trig_dump_active = true;
+}
+
+//*****************************************************************************
+// USBへの読み出し (テレメトリの送信リングに入るだけ送る)
+//*****************************************************************************
+void trig_dump_process(void) {
+    uint8_t  payload[TELEMETRY_EVENT_SIZE(TELEMETRY_EVENT_MAX_SAMPLES)];
+    uint32_t total, n, i, time;
+    int32_t  value;
+
+    while (trig_dump_active && telemetry_free() >= TRIG_FRAME_SIZE) {
+        total = trig_count();
+        n = total - trig_dump_index;
+        if (n > TELEMETRY_EVENT_MAX_SAMPLES) n = TELEMETRY_EVENT_MAX_SAMPLES;
+
+        telemetry_put_u16(&payload[0], (uint16_t)trig_dump_index);
+        telemetry_put_u16(&payload[2], (uint16_t)total);
+        telemetry_put_u16(&payload[4], (uint16_t)trig_pos);
+        payload[6] = (uint8_t)trig_mode_now;
+        payload[7] = (uint8_t)n;
+        telemetry_put_u32(&payload[8], (uint32_t)trig_level_mv);
+        for (i = 0; i < n; i++) {
+            trig_sample(trig_dump_index + i, &value, &time);
+            telemetry_put_u32(&payload[TELEMETRY_EVENT_HEADER_SIZE + i * 8], time);
+            telemetry_put_u32(&payload[TELEMETRY_EVENT_HEADER_SIZE + i * 8 + 4], (uint32_t)value);
+        }
+        telemetry_send(TELEMETRY_TYPE_EVENT, payload, (uint8_t)TELEMETRY_EVENT_SIZE(n));
+
+        trig_dump_index += n;
+        if (trig_dump_index >= total) trig_dump_active = false;
+    }
+}
+
+//*****************************************************************************
+// 終わり
+//*****************************************************************************
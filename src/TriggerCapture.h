@@ -0,0 +1,66 @@
+//*****************************************************************************
+// ファイル名       TriggerCapture.h
+// 対象マイコン     RP2040
+// ファイル内容     表面電位のトリガー付き波形記録・ピークホールド
+//*****************************************************************************
+#ifndef TRIGGERCAPTURE_H_
+#define TRIGGERCAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//=============================================================================
+//シンボル定義
+//=============================================================================
+#define TRIG_BUFFER_SIZE        512         // 記録できる計測結果の数 (トリガー前後の合計)
+#define TRIG_DEFAULT_LEVEL_MV   1000000     // 既定のしきい値 [mV] (1kV)
+#define TRIG_DEFAULT_PRE        128         // 既定のトリガー前の記録数
+#define TRIG_DEFAULT_POST       (TRIG_BUFFER_SIZE - TRIG_DEFAULT_PRE - 1)
+
+// トリガー条件 (しきい値は電位 [mV], 傾きは計測結果1回あたりの変化 [mV])
+typedef enum {
+    TRIG_LEVEL_RISE = 0,        // しきい値を下から上へ横切った
+    TRIG_LEVEL_FALL,            // しきい値を上から下へ横切った
+    TRIG_SLOPE_RISE,            // 増加がしきい値以上
+    TRIG_SLOPE_FALL,            // 減少がしきい値以上
+    TRIG_SLOPE_ANY,             // 変化 (どちら向きでも) がしきい値以上
+    TRIG_MODE_NUM
+} TrigMode;
+
+// 状態
+typedef enum {
+    TRIG_OFF = 0,               // 停止 (ピークホールドのみ)
+    TRIG_ARMED,                 // トリガー待ち (トリガー前の分を記録し続ける)
+    TRIG_POST,                  // トリガー後の分を記録中
+    TRIG_HOLD,                  // 記録完了 (再度アームするまで保持)
+} TrigState;
+
+//=============================================================================
+//プロトタイプ宣言
+//=============================================================================
+void      trig_init(void);
+bool      trig_config(TrigMode mode, int32_t level_mv, uint32_t pre, uint32_t post);
+void      trig_arm(void);
+void      trig_disarm(void);
+void      trig_process(int32_t potential_mv, uint32_t timestamp_us, bool gap);
+void      trig_peak_reset(void);
+
+TrigState trig_state(void);
+TrigMode  trig_mode(void);
+int32_t   trig_level(void);
+uint32_t  trig_pre_length(void);
+uint32_t  trig_post_length(void);
+int32_t   trig_peak_max(void);
+int32_t   trig_peak_min(void);
+uint32_t  trig_count(void);
+uint32_t  trig_position(void);
+bool      trig_sample(uint32_t index, int32_t *potential_mv, uint32_t *timestamp_us);
+
+// USBへの読み出し (メインループから trig_dump_process を呼ぶ)
+void      trig_dump_start(void);
+void      trig_dump_process(void);
+
+#endif
+//*****************************************************************************
+// 終わり
+//*****************************************************************************